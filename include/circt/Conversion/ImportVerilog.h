@@ -134,6 +134,17 @@ struct ImportVerilogOptions {
 
   /// A list of library files to include in the compilation.
   std::vector<std::string> libraryFiles;
+
+  //===--------------------------------------------------------------------===//
+  // Caching
+  //===--------------------------------------------------------------------===//
+
+  /// If non-empty, a directory in which the MLIR conversion of module bodies is
+  /// cached across runs. The converted body of a module is reused as long as
+  /// the source file defining it, the files it includes, and the options above
+  /// are unchanged. This only skips the conversion to MLIR: the sources are
+  /// still preprocessed, parsed, and elaborated in full on every run.
+  std::string cacheDir;
 };
 
 /// Parse files in a source manager as Verilog source code and populate the
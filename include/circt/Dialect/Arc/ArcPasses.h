@@ -27,17 +27,20 @@ namespace arc {
 
 std::unique_ptr<mlir::Pass>
 createAddTapsPass(const AddTapsOptions &options = {});
-std::unique_ptr<mlir::Pass> createAllocateStatePass();
+std::unique_ptr<mlir::Pass>
+createAllocateStatePass(const AllocateStateOptions &options = {});
 std::unique_ptr<mlir::Pass> createArcCanonicalizerPass();
 std::unique_ptr<mlir::Pass> createDedupPass();
 std::unique_ptr<mlir::Pass> createFindInitialVectorsPass();
 std::unique_ptr<mlir::Pass>
 createInferMemoriesPass(const InferMemoriesOptions &options = {});
-std::unique_ptr<mlir::Pass> createInlineArcsPass();
+std::unique_ptr<mlir::Pass>
+createInlineArcsPass(const InlineArcsOptions &options = {});
 std::unique_ptr<mlir::Pass> createIsolateClocksPass();
 std::unique_ptr<mlir::Pass> createLatencyRetimingPass();
 std::unique_ptr<mlir::Pass> createLowerArcsToFuncsPass();
-std::unique_ptr<mlir::Pass> createLowerClocksToFuncsPass();
+std::unique_ptr<mlir::Pass>
+createLowerClocksToFuncsPass(const LowerClocksToFuncsOptions &options = {});
 std::unique_ptr<mlir::Pass> createLowerLUTPass();
 std::unique_ptr<mlir::Pass> createLowerVectorizationsPass(
     LowerVectorizationsModeEnum mode = LowerVectorizationsModeEnum::Full);
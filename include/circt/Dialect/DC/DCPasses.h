@@ -26,6 +26,7 @@ std::unique_ptr<mlir::OperationPass<mlir::ModuleOp>> createDCDotPrintPass();
 
 std::unique_ptr<mlir::Pass> createDCMaterializeForksSinksPass();
 std::unique_ptr<mlir::Pass> createDCDematerializeForksSinksPass();
+std::unique_ptr<mlir::Pass> createDCStaticSchedulePass();
 
 #define GEN_PASS_REGISTRATION
 #include "circt/Dialect/DC/DCPasses.h.inc"
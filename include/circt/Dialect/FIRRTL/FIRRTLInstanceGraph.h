@@ -24,6 +24,7 @@ namespace circt {
 namespace firrtl {
 using InstanceRecord = igraph::InstanceRecord;
 using InstanceGraphNode = igraph::InstanceGraphNode;
+using InstanceGraphListener = igraph::InstanceGraphListener;
 using InstancePathCache = igraph::InstancePathCache;
 
 /// This graph tracks modules and where they are instantiated. This is intended
@@ -35,7 +35,10 @@ public:
   void erase(igraph::InstanceGraphNode *node) override;
 
 private:
-  using igraph::InstanceGraph::addModule;
+  /// Adds a module, updating links to entry.
+  igraph::InstanceGraphNode *
+  addModule(igraph::ModuleOpInterface module) override;
+
   igraph::InstanceGraphNode entry;
 };
 
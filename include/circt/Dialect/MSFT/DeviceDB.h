@@ -19,6 +19,8 @@
 #include "mlir/IR/Operation.h"
 #include "llvm/ADT/DenseMap.h"
 
+#include <map>
+
 namespace circt {
 namespace msft {
 
@@ -102,13 +104,18 @@ public:
   DynInstDataOpInterface getInstanceAt(PhysLocationAttr);
 
   /// Find the nearest unoccupied primitive location to 'nearestToY' in
-  /// 'column'.
+  /// 'column'. Rows are probed outwards from 'nearestToY', so the cost depends
+  /// on the distance to the nearest free location rather than the column size.
+  /// Ties are broken in favor of the lower row.
   PhysLocationAttr getNearestFreeInColumn(PrimitiveType prim, uint64_t column,
                                           uint64_t nearestToY);
 
   /// Walk the placement information in some sort of reasonable order. Bounds
   /// restricts the walk to a rectangle of [xmin, xmax, ymin, ymax] (inclusive),
-  /// with -1 meaning unbounded.
+  /// with -1 meaning unbounded. The locations visited and their occupants are
+  /// fixed when the walk starts, so the callback may add and move placements.
+  /// A placement removed by the callback is erased, and must not be used by
+  /// the calls for the locations it occupied.
   void
   walkPlacements(function_ref<void(PhysLocationAttr, DynInstDataOpInterface)>,
                  std::tuple<int64_t, int64_t, int64_t, int64_t> bounds =
@@ -129,15 +136,24 @@ private:
   MLIRContext *ctxt;
   mlir::ModuleOp topMod;
 
+  // Columns and rows are kept sorted so that rectangle queries only visit the
+  // cells inside the rectangle and nearest-row searches are logarithmic. The
+  // number of slots and primitive types per cell is small, so those stay
+  // hashed.
   using DimDevType = DenseMap<PrimitiveType, PlacementCell>;
   using DimNumMap = DenseMap<size_t, DimDevType>;
-  using DimYMap = DenseMap<size_t, DimNumMap>;
-  using DimXMap = DenseMap<size_t, DimYMap>;
+  using DimYMap = std::map<size_t, DimNumMap>;
+  using DimXMap = std::map<size_t, DimYMap>;
   using RegionPlacements = SmallVector<PDPhysRegionOp>;
 
   /// Get the leaf node. Abstract this out to make it easier to change the
-  /// underlying data structure.
+  /// underlying data structure. Creates the leaf if the DB isn't seeded.
   PlacementCell *getLeaf(PhysLocationAttr);
+  /// Get the leaf node if it exists. Never creates a leaf.
+  PlacementCell *findLeaf(PhysLocationAttr);
+
+  /// Bulk-load the locations of all the primitives in 'seed'.
+  void addSeedPrimitives(const PrimitiveDB &seed);
 
   DimXMap placements;
   RegionPlacements regionPlacements;
@@ -15,6 +15,8 @@
 
 #include "circt/Scheduling/Problems.h"
 
+#include <memory>
+
 namespace circt {
 namespace scheduling {
 
@@ -30,6 +32,29 @@ LogicalResult scheduleASAP(Problem &prob);
 /// cycles, or \p prob does not include \p lastOp.
 LogicalResult scheduleSimplex(Problem &prob, Operation *lastOp);
 
+/// Solve the basic problem like `scheduleSimplex`, but keep the solver state
+/// between invocations of `schedule()`. Dependences added to or removed from
+/// the problem, as well as changed operator latencies, are applied to the
+/// previous optimal tableau, which is then re-optimized starting from the
+/// previous basis. This is considerably cheaper than scheduling from scratch
+/// when a problem is re-scheduled after small edits. Adding or removing
+/// operations causes the tableau to be rebuilt. The objective is to minimize
+/// the start time of the given \p lastOp.
+class IncrementalSimplexScheduler {
+public:
+  IncrementalSimplexScheduler(Problem &prob, Operation *lastOp);
+  ~IncrementalSimplexScheduler();
+
+  /// Compute the start times for all operations in the problem. Fails if the
+  /// dependence graph contains cycles, or the problem does not include the
+  /// last operation.
+  LogicalResult schedule();
+
+private:
+  class Impl;
+  std::unique_ptr<Impl> impl;
+};
+
 /// Solve the resource-free cyclic problem using linear programming and a
 /// handwritten implementation of the simplex algorithm. The objectives are to
 /// determine the smallest feasible initiation interval, and to minimize the
@@ -15,8 +15,10 @@
 
 #include "circt/Support/LLVM.h"
 #include "mlir/IR/OpDefinition.h"
+#include "mlir/IR/PatternMatch.h"
 #include "llvm/ADT/GraphTraits.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/iterator.h"
 #include "llvm/Support/DOTGraphTraits.h"
 
@@ -176,6 +178,11 @@ private:
   /// lists.
   InstanceList instances;
 
+  /// The first record of each instance operation in `instances`. The records
+  /// of an instance referring to several modules are kept next to each other,
+  /// such that they can all be found without scanning the list.
+  llvm::DenseMap<Operation *, InstanceRecord *> instanceIndex;
+
   /// List of instances which instantiate this module.
   InstanceRecord *firstUse = nullptr;
 
@@ -203,6 +210,10 @@ public:
   /// Look up an InstanceGraphNode for a module.
   InstanceGraphNode *lookup(ModuleOpInterface op);
 
+  /// Look up an InstanceGraphNode for a module. Returns null if the module is
+  /// not part of the graph.
+  InstanceGraphNode *lookupOrNull(ModuleOpInterface op);
+
   /// Lookup an module by name.
   InstanceGraphNode *lookup(StringAttr name);
 
@@ -256,7 +267,20 @@ public:
   virtual void replaceInstance(InstanceOpInterface inst,
                                InstanceOpInterface newInst);
 
+  /// Add a newly created instance to the instance graph. Does nothing if the
+  /// module containing the instance is not part of the graph.
+  void addInstance(InstanceOpInterface inst);
+
+  /// Remove an instance contained in the given module from the instance graph.
+  void removeInstance(InstanceOpInterface inst, ModuleOpInterface module);
+
+  /// Update the instance graph after a module in it has been renamed. Records
+  /// of instances already referring to the new name are moved to the module.
+  void renameModule(ModuleOpInterface module);
+
 protected:
+  friend class InstanceGraphListener;
+
   ModuleOpInterface getReferencedModuleImpl(InstanceOpInterface op);
 
   /// Get the node corresponding to the module.  If the node has does not exist
@@ -272,10 +296,41 @@ protected:
   /// This maps each operation to its graph node.
   llvm::DenseMap<Attribute, InstanceGraphNode *> nodeMap;
 
+  /// The name under which each module is registered in `nodeMap`.
+  llvm::DenseMap<Operation *, StringAttr> moduleNames;
+
   /// A caching of the inferred top level module(s).
   llvm::SmallVector<InstanceGraphNode *> inferredTopLevelNodes;
 };
 
+/// A listener that keeps an instance graph up to date as builders and
+/// rewriters create, move, modify, and erase instances and modules. A pass
+/// which makes all such changes through a builder or rewriter with this
+/// listener attached leaves the instance graph valid, and should mark it as
+/// preserved to spare later passes from rebuilding it. Modules must be renamed
+/// through the rewriter as well, for example in `modifyOpInPlace`. A cloned
+/// module that still carries the name of its original is added to the graph
+/// once it is renamed.
+class InstanceGraphListener : public mlir::RewriterBase::Listener {
+public:
+  explicit InstanceGraphListener(InstanceGraph &instanceGraph)
+      : instanceGraph(instanceGraph) {}
+
+  void notifyOperationInserted(Operation *op,
+                               mlir::OpBuilder::InsertPoint previous) override;
+  void notifyOperationModified(Operation *op) override;
+  void notifyOperationErased(Operation *op) override;
+
+private:
+  /// Add a module and the instances within it to the instance graph.
+  void addModule(ModuleOpInterface module);
+
+  InstanceGraph &instanceGraph;
+
+  /// Cloned modules waiting for a name of their own.
+  llvm::SmallPtrSet<Operation *, 4> unnamedClones;
+};
+
 struct InstancePathCache;
 
 /**
@@ -339,18 +394,43 @@ struct InstancePathCache {
   /// Replace an InstanceOp. This is required to keep the cache updated.
   void replaceInstance(InstanceOpInterface oldOp, InstanceOpInterface newOp);
 
-  /// Append an instance to a path.
+  /// Append an instance to a path. The result shares the storage of the path
+  /// if there is room next to it, and is allocated tightly otherwise.
   InstancePath appendInstance(InstancePath path, InstanceOpInterface inst);
 
-  /// Prepend an instance to a path.
+  /// Prepend an instance to a path. The result shares the storage of the path
+  /// if there is room next to it, and is allocated tightly otherwise.
   InstancePath prependInstance(InstanceOpInterface inst, InstancePath path);
 
 private:
+  /// Extend a path by one instance at its front or back. If the storage of the
+  /// path has a free slot next to it, the new path is created in place and
+  /// shares the storage of the old one. Otherwise the path is copied, and if
+  /// `reserve` is set, room to extend the copy in place is left next to it.
+  /// Only `getAbsolutePaths` reserves room, and only for the paths to modules
+  /// that instantiate others, since those are certain to be extended.
+  ///
+  /// Only the first extension of a path shares its storage, since paths are
+  /// contiguous arrays. This avoids the quadratic cost of long chains of single
+  /// instances, but siblings, i.e. extensions of the same path by different
+  /// instances, each copy the common prefix. A module instantiated N times
+  /// below a path of depth D still costs O(N * D) memory.
+  InstancePath extendPath(InstancePath path, InstanceOpInterface inst,
+                          bool atFront, bool reserve);
+
   /// An allocator for individual instance paths and entire path lists.
   llvm::BumpPtrAllocator allocator;
 
   /// Cached absolute instance paths.
   DenseMap<Operation *, ArrayRef<InstancePath>> absolutePathsCache;
+
+  /// The number of free slots after path storages that can still be extended
+  /// in place, keyed by the end of the slots in use.
+  DenseMap<const InstanceOpInterface *, size_t> spaceAfter;
+
+  /// The number of free slots before path storages that can still be extended
+  /// in place, keyed by the start of the slots in use.
+  DenseMap<const InstanceOpInterface *, size_t> spaceBefore;
 };
 
 } // namespace igraph
@@ -0,0 +1,35 @@
+//===- CirctLspServerMain.h - CIRCT Language Server main --------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Main entry point for the incremental CIRCT language server. Unlike the
+// upstream MLIR language server, which reparses an entire document on every
+// edit, this server splits documents into their top-level symbol operations
+// (`hw.module`, `firrtl.module`, and similar) and only reparses the ones that
+// changed.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CIRCT_TOOLS_CIRCT_LSP_SERVER_CIRCTLSPSERVERMAIN_H
+#define CIRCT_TOOLS_CIRCT_LSP_SERVER_CIRCTLSPSERVERMAIN_H
+
+#include "mlir/Support/LogicalResult.h"
+
+namespace mlir {
+class DialectRegistry;
+} // namespace mlir
+
+namespace circt {
+
+/// Implementation for tools like `circt-lsp-server --incremental`. The dialects
+/// in `registry` are available to parse the documents opened by the client.
+mlir::LogicalResult CirctLspServerMain(int argc, char **argv,
+                                       mlir::DialectRegistry &registry);
+
+} // namespace circt
+
+#endif // CIRCT_TOOLS_CIRCT_LSP_SERVER_CIRCTLSPSERVERMAIN_H
@@ -145,6 +145,97 @@ with ir.Context() as ctx, ir.Location.unknown():
   seeded_pdb.walk_placements(print_placement, bounds=(6, 6, None, None))
   # CHECK-LABEL: === Placements (col 6):
 
+  print("=== Nearest free (col 7):")
+  # CHECK-LABEL: === Nearest free (col 7):
+  probe_devdb = msft.PrimitiveDB()
+  for y in [10, 12, 16, 20]:
+    for num in [0, 1]:
+      probe_devdb.add_primitive(
+          msft.PhysLocationAttr.get(msft.M20K, x=7, y=y, num=num))
+  probe_devdb.add_primitive(
+      msft.PhysLocationAttr.get(msft.DSP, x=7, y=13, num=0))
+  probe_pdb = msft.PlacementDB(mod, probe_devdb)
+
+  # Equally distant rows go to the lower one, and a row to its lowest free
+  # slot.
+  print(probe_pdb.get_nearest_free_in_column(msft.M20K, 7, 14))
+  # CHECK-NEXT: #msft.physloc<M20K, 7, 12, 0>
+  probe_ops = [
+      probe_pdb.place(dyn_inst,
+                      msft.PhysLocationAttr.get(msft.M20K, x=7, y=12, num=0),
+                      "|probe0", ir.Location.current)
+  ]
+  print(probe_pdb.get_nearest_free_in_column(msft.M20K, 7, 14))
+  # CHECK-NEXT: #msft.physloc<M20K, 7, 12, 1>
+  probe_ops.append(
+      probe_pdb.place(dyn_inst,
+                      msft.PhysLocationAttr.get(msft.M20K, x=7, y=12, num=1),
+                      "|probe1", ir.Location.current))
+
+  # Full rows and other primitive types are skipped.
+  print(probe_pdb.get_nearest_free_in_column(msft.M20K, 7, 13))
+  # CHECK-NEXT: #msft.physloc<M20K, 7, 10, 0>
+  print(probe_pdb.get_nearest_free_in_column(msft.M20K, 7, 15))
+  # CHECK-NEXT: #msft.physloc<M20K, 7, 16, 0>
+  print(probe_pdb.get_nearest_free_in_column(msft.DSP, 7, 0))
+  # CHECK-NEXT: #msft.physloc<DSP, 7, 13, 0>
+
+  # Probing continues past either end of the column.
+  print(probe_pdb.get_nearest_free_in_column(msft.M20K, 7, 100))
+  # CHECK-NEXT: #msft.physloc<M20K, 7, 20, 0>
+  print(probe_pdb.get_nearest_free_in_column(msft.M20K, 7, 0))
+  # CHECK-NEXT: #msft.physloc<M20K, 7, 10, 0>
+  print(probe_pdb.get_nearest_free_in_column(msft.M20K, 8, 0))
+  # CHECK-NEXT: None
+  for probe_op in probe_ops:
+    probe_pdb.remove_placement(probe_op)
+
+  print("=== Place while walking (col 9):")
+  # CHECK-LABEL: === Place while walking (col 9):
+  grow_pdb = msft.PlacementDB(mod)
+  grow_ops = [
+      grow_pdb.place(dyn_inst,
+                     msft.PhysLocationAttr.get(msft.M20K, x=9, y=0, num=num),
+                     f"|grow{num}", ir.Location.current) for num in range(4)
+  ]
+
+  # The walk only visits the placements present when it starts.
+  def grow(loc, locOp):
+    print(loc)
+    grow_ops.append(
+        grow_pdb.place(
+            dyn_inst,
+            msft.PhysLocationAttr.get(msft.M20K, x=9, y=0, num=loc.num + 4),
+            f"|grow{loc.num + 4}", ir.Location.current))
+
+  grow_pdb.walk_placements(grow, bounds=(9, 9, None, None))
+  # CHECK-COUNT-4: #msft.physloc<M20K, 9, 0
+  # CHECK-NOT: #msft.physloc
+  print("=== Move while walking (col 9):")
+  # CHECK-LABEL: === Move while walking (col 9):
+
+  # Each location is passed with its occupant when the walk started, even if
+  # an earlier callback moved it elsewhere.
+  seen = []
+
+  def move(loc, locOp):
+    if not seen:
+      for num, grow_op in enumerate(grow_ops):
+        grow_pdb.move_placement(
+            grow_op, msft.PhysLocationAttr.get(msft.M20K, x=10, y=0, num=num))
+    seen.append(locOp)
+
+  grow_pdb.walk_placements(move, bounds=(9, 9, None, None))
+  print(len(seen), sum(locOp is None for locOp in seen),
+        all(locOp in grow_ops for locOp in seen))
+  # CHECK-NEXT: 8 0 True
+  grow_pdb.walk_placements(print_placement, bounds=(9, 9, None, None))
+  # CHECK-COUNT-8: #msft.physloc<M20K, 9, 0, {{[0-7]}}>, (unoccupied)
+  grow_pdb.walk_placements(print_placement, bounds=(10, 10, None, None))
+  # CHECK-COUNT-8: #msft.physloc<M20K, 10, 0, {{[0-7]}}>, [#hw.innerNameRef
+  for grow_op in grow_ops:
+    grow_pdb.remove_placement(grow_op)
+
   devdb = msft.PrimitiveDB()
   devdb.add_primitive(msft.PhysLocationAttr.get(msft.M20K, x=0, y=0, num=0))
   devdb.add_primitive(msft.PhysLocationAttr.get(msft.M20K, x=1, y=0, num=1))
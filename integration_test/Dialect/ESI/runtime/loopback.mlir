@@ -9,6 +9,12 @@
 // Test ESI utils
 // RUN: esiquery trace w:%t6/hw/esi_system_manifest.json info | FileCheck %s --check-prefix=QUERY-INFO
 // RUN: esiquery trace w:%t6/hw/esi_system_manifest.json hier | FileCheck %s --check-prefix=QUERY-HIER
+// RUN: esiquery trace w:%t6/hw/esi_system_manifest.json telemetry 10 | FileCheck %s --check-prefix=QUERY-TELEMETRY
+// RUN: esiquery trace b:%t6/hw/esi_system_manifest.json:%t6/trace.bin info | FileCheck %s --check-prefix=QUERY-INFO
+// RUN: esiquery trace r:%t6/hw/esi_system_manifest.json:%t6/trace.bin info | FileCheck %s --check-prefix=QUERY-INFO
+// RUN: %python %s.replay.py %t6/hw/esi_system_manifest.json %t6/replay.bin | FileCheck %s --check-prefix=REPLAY
+// RUN: esitester trace w:%t6/hw/esi_system_manifest.json readtest | FileCheck %s --check-prefix=READTEST
+// RUN: esitester trace w:%t6/hw/esi_system_manifest.json buffertest | FileCheck %s --check-prefix=BUFFERTEST
 
 // Test cosimulation
 // RUN: esi-cosim.py --source %t6/hw --top top -- %python %s.py cosim env
@@ -127,6 +133,37 @@ hw.module @top(in %clk: !seq.clock, in %rst: i1) {
 
 // CPP-TEST: depth: 0x5
 
+// REPLAY: recorded: [[DATA:.+]]
+// REPLAY-NEXT: replayed: [[DATA]]
+// REPLAY-NEXT: replay: more messages sent on '{{.+}}' than were recorded
+// REPLAY-NEXT: replay: message 0 sent on '{{.+}}' differs from the recorded one
+// REPLAY-NEXT: PASS
+
+// READTEST: poll empty: 0
+// READTEST: wait timeout: 0 after the timeout
+// READTEST: deliver: 1 1 0
+// READTEST: poll one: 1 a:1
+// READTEST: deliver: 1
+// READTEST: wait: 2 b:2 b:4
+// READTEST: wait for thread: 1 a:5
+// READTEST: a: messages 2, rejected 1
+// READTEST: co1: 2
+// READTEST: co2: 4
+// READTEST: f1: 1
+// READTEST: f2: 3
+// READTEST: co3: 5
+// READTEST: co4: Channel disconnected
+// READTEST: f3: Channel disconnected
+// READTEST: co5: Cannot read from a disconnected channel.
+
+// BUFFERTEST: message: 1 2, reference 1, shares buffer 1
+// BUFFERTEST: after buffer write: 255 2
+// BUFFERTEST: copy: 255 2, shares buffer 1, in use 1
+// BUFFERTEST: released: in use 0, free 1
+// BUFFERTEST: recycled 1, second 1, over the cap 0
+// BUFFERTEST: oversized message: message size 5 exceeds buffer size 4
+// BUFFERTEST: buffers released after the pool
+
 // QUERY-INFO: API version: 0
 // QUERY-INFO: ********************************
 // QUERY-INFO: * Module information
@@ -137,6 +174,18 @@ hw.module @top(in %clk: !seq.clock, in %rst: i1) {
 // QUERY-INFO:   Extra metadata:
 // QUERY-INFO:     foo: 1
 
+// QUERY-TELEMETRY: ********************************
+// QUERY-TELEMETRY: * Channel telemetry
+// QUERY-TELEMETRY: ********************************
+// QUERY-TELEMETRY: * Instance:top
+// QUERY-TELEMETRY:     internal_write:
+// QUERY-TELEMETRY:       ack: messages: {{[1-9][0-9]*}}, bytes: 0, rejected: 0, poll misses: 0, queue depth: {{[01]}} (max {{[01]}}), latency: {{<[0-9]+us:[1-9][0-9]*}}
+// QUERY-TELEMETRY:   * Instance:loopback_inst[0]
+// QUERY-TELEMETRY:       loopback_tohw:
+// QUERY-TELEMETRY:         recv: messages: 0, bytes: 0, rejected: 0, poll misses: 0, queue depth: 0 (max 0){{$}}
+// QUERY-TELEMETRY:       loopback_fromhw:
+// QUERY-TELEMETRY:         send: messages: [[MSGS:[1-9][0-9]*]], bytes: [[MSGS]], rejected: 0, poll misses: 0, queue depth: {{[01]}} (max {{[01]}}), latency: {{<[0-9]+us:[1-9][0-9]*}}
+
 // QUERY-HIER: ********************************
 // QUERY-HIER: * Design hierarchy
 // QUERY-HIER: ********************************
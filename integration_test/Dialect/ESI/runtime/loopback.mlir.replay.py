@@ -0,0 +1,56 @@
+# Record the messages of a loopback session with the trace backend and replay
+# them, checking that the replayed session matches the recorded one.
+import esiaccel
+import gc
+import sys
+
+manifest = sys.argv[1]
+trace = sys.argv[2]
+
+
+def run(mode: str, data: list):
+  acc = esiaccel.AcceleratorConnection("trace", f"{mode}:{manifest}:{trace}")
+  d = acc.build_accelerator()
+  loopback = d.children[esiaccel.AppID("loopback_inst", 0)]
+  recv = loopback.ports[esiaccel.AppID("loopback_tohw")].write_port("recv")
+  recv.connect()
+  send = loopback.ports[esiaccel.AppID("loopback_fromhw")].read_port("send")
+  send.connect()
+
+  resps = []
+  for value in data:
+    recv.write(int.to_bytes(value, 1, "little"))
+    resps.append(int.from_bytes(send.read(), "little"))
+  return acc, recv, resps
+
+
+# Record a session. The trace backend answers with random data, which the trace
+# captures. The trace is only complete once the connection is closed.
+acc, recv, recorded = run("b", [1, 2, 3])
+print("recorded:", *recorded)
+acc = recv = None
+gc.collect()
+
+# Replaying the same messages produces the recorded responses.
+acc, recv, replayed = run("R", [1, 2, 3])
+print("replayed:", *replayed)
+assert replayed == recorded
+
+# Messages which were not recorded are rejected.
+try:
+  recv.write(int.to_bytes(4, 1, "little"))
+  assert False, "a message beyond the end of the trace was accepted"
+except RuntimeError as e:
+  print(e)
+acc = recv = None
+gc.collect()
+
+acc, recv, _ = run("R", [])
+try:
+  recv.write(int.to_bytes(7, 1, "little"))
+  assert False, "a message differing from the trace was accepted"
+except RuntimeError as e:
+  print(e)
+acc = recv = None
+
+print("PASS")
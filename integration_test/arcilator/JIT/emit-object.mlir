@@ -0,0 +1,80 @@
+// RUN: split-file %s %t
+// RUN: arcilator %t/model.mlir --emit-object -o %t/model.o
+// RUN: %host_cc %t/driver.c %t/model.o -o %t/single
+// RUN: %t/single | FileCheck %s
+// RUN: arcilator %t/model.mlir --emit-object --codegen-partitions=3 -o %t/model.a
+// RUN: %host_cc %t/driver.c %t/model.a -o %t/archive
+// RUN: %t/archive | FileCheck %s
+// REQUIRES: arcilator-jit
+
+// The objects link into an executable, which runs their static constructors
+// and destructors.
+// CHECK: constructed
+// CHECK-NEXT: counter_value = 0
+// CHECK-NEXT: counter_value = 1
+// CHECK-NEXT: counter_value = 2
+// CHECK-NEXT: counter_value = 3
+// CHECK-NEXT: destructed
+
+//--- driver.c
+void simulate(void);
+int main(void) {
+  simulate();
+  return 0;
+}
+
+//--- model.mlir
+llvm.func @printf(!llvm.ptr, ...) -> i32
+llvm.mlir.global internal constant @constructed("constructed\0A\00") {addr_space = 0 : i32}
+llvm.mlir.global internal constant @destructed("destructed\0A\00") {addr_space = 0 : i32}
+
+llvm.func @construct() {
+  %0 = llvm.mlir.addressof @constructed : !llvm.ptr
+  %1 = llvm.call @printf(%0) vararg(!llvm.func<i32 (ptr, ...)>) : (!llvm.ptr) -> i32
+  llvm.return
+}
+
+llvm.func @destruct() {
+  %0 = llvm.mlir.addressof @destructed : !llvm.ptr
+  %1 = llvm.call @printf(%0) vararg(!llvm.func<i32 (ptr, ...)>) : (!llvm.ptr) -> i32
+  llvm.return
+}
+
+llvm.mlir.global_ctors {ctors = [@construct], priorities = [65535 : i32]}
+llvm.mlir.global_dtors {dtors = [@destruct], priorities = [65535 : i32]}
+
+hw.module @counter(in %clk: i1, out o: i8) {
+  %seq_clk = seq.to_clock %clk
+
+  %reg = seq.compreg %added, %seq_clk : i8
+
+  %one = hw.constant 1 : i8
+  %added = comb.add %reg, %one : i8
+
+  hw.output %reg : i8
+}
+
+func.func @simulate() {
+  %zero = arith.constant 0 : i1
+  %one = arith.constant 1 : i1
+  %lb = arith.constant 0 : index
+  %ub = arith.constant 3 : index
+  %step = arith.constant 1 : index
+
+  arc.sim.instantiate @counter as %model {
+    %init_val = arc.sim.get_port %model, "o" : i8, !arc.sim.instance<@counter>
+    arc.sim.emit "counter_value", %init_val : i8
+
+    scf.for %i = %lb to %ub step %step {
+      arc.sim.set_input %model, "clk" = %one : i1, !arc.sim.instance<@counter>
+      arc.sim.step %model : !arc.sim.instance<@counter>
+      arc.sim.set_input %model, "clk" = %zero : i1, !arc.sim.instance<@counter>
+      arc.sim.step %model : !arc.sim.instance<@counter>
+
+      %counter_val = arc.sim.get_port %model, "o" : i8, !arc.sim.instance<@counter>
+      arc.sim.emit "counter_value", %counter_val : i8
+    }
+  }
+
+  return
+}
@@ -0,0 +1,77 @@
+// RUN: rm -rf %t
+// RUN: arcilator %s --run --jit-entry=main --codegen-partitions=4 --object-cache-dir=%t --verbose-pass-executions 2> %t.log | FileCheck %s
+// RUN: FileCheck %s --check-prefix=MISS --input-file=%t.log
+// RUN: ls %t | FileCheck %s --check-prefix=CACHE
+// RUN: arcilator %s --run --jit-entry=main --codegen-partitions=4 --object-cache-dir=%t --verbose-pass-executions 2> %t.log | FileCheck %s
+// RUN: FileCheck %s --check-prefix=HIT --input-file=%t.log
+// REQUIRES: arcilator-jit
+
+// Static constructors and destructors run around the simulation.
+// CHECK: constructed
+// CHECK-NEXT: counter_value = 0
+// CHECK-NEXT: counter_value = 1
+// CHECK-NEXT: counter_value = 2
+// CHECK-NEXT: counter_value = 3
+// CHECK-NEXT: destructed
+
+// Empty partitions may share a cache entry, so the first run can already hit
+// some of them.
+// MISS: [arcilator] Loaded {{[0-3]}} of 4 objects from the cache
+// HIT: [arcilator] Loaded 4 of 4 objects from the cache
+
+// CACHE: .o
+
+llvm.func @printf(!llvm.ptr, ...) -> i32
+llvm.mlir.global internal constant @constructed("constructed\0A\00") {addr_space = 0 : i32}
+llvm.mlir.global internal constant @destructed("destructed\0A\00") {addr_space = 0 : i32}
+
+llvm.func @construct() {
+  %0 = llvm.mlir.addressof @constructed : !llvm.ptr
+  %1 = llvm.call @printf(%0) vararg(!llvm.func<i32 (ptr, ...)>) : (!llvm.ptr) -> i32
+  llvm.return
+}
+
+llvm.func @destruct() {
+  %0 = llvm.mlir.addressof @destructed : !llvm.ptr
+  %1 = llvm.call @printf(%0) vararg(!llvm.func<i32 (ptr, ...)>) : (!llvm.ptr) -> i32
+  llvm.return
+}
+
+llvm.mlir.global_ctors {ctors = [@construct], priorities = [65535 : i32]}
+llvm.mlir.global_dtors {dtors = [@destruct], priorities = [65535 : i32]}
+
+hw.module @counter(in %clk: i1, out o: i8) {
+  %seq_clk = seq.to_clock %clk
+
+  %reg = seq.compreg %added, %seq_clk : i8
+
+  %one = hw.constant 1 : i8
+  %added = comb.add %reg, %one : i8
+
+  hw.output %reg : i8
+}
+
+func.func @main() {
+  %zero = arith.constant 0 : i1
+  %one = arith.constant 1 : i1
+  %lb = arith.constant 0 : index
+  %ub = arith.constant 3 : index
+  %step = arith.constant 1 : index
+
+  arc.sim.instantiate @counter as %model {
+    %init_val = arc.sim.get_port %model, "o" : i8, !arc.sim.instance<@counter>
+    arc.sim.emit "counter_value", %init_val : i8
+
+    scf.for %i = %lb to %ub step %step {
+      arc.sim.set_input %model, "clk" = %one : i1, !arc.sim.instance<@counter>
+      arc.sim.step %model : !arc.sim.instance<@counter>
+      arc.sim.set_input %model, "clk" = %zero : i1, !arc.sim.instance<@counter>
+      arc.sim.step %model : !arc.sim.instance<@counter>
+
+      %counter_val = arc.sim.get_port %model, "o" : i8, !arc.sim.instance<@counter>
+      arc.sim.emit "counter_value", %counter_val : i8
+    }
+  }
+
+  return
+}
@@ -0,0 +1,136 @@
+// RUN: split-file %s %t
+// RUN: arcilator %t/model.mlir --emit-object --state-file=%t/state.json -o %t/model.o
+// RUN: %PYTHON% %CIRCT_SOURCE%/tools/arcilator/arcilator-header-cpp.py %t/state.json > %t/model.h
+// RUN: %host_cxx -std=c++17 -I %CIRCT_SOURCE%/tools/arcilator -I %t %t/driver.cpp %t/model.o -o %t/driver
+// RUN: %t/driver | FileCheck %s
+// REQUIRES: arcilator-jit
+
+// CHECK:      ticked o = 5
+// CHECK-NEXT: advanced o = 8
+// CHECK-NEXT: restored 1 o = 5 same 1
+// CHECK-NEXT: relative restored 1 same 1
+// CHECK-NEXT: forks o = 6 and o = 7
+// CHECK-NEXT: saved 1
+// CHECK-NEXT: loaded 1 o = 5 same 1
+// CHECK-NEXT: loaded ticked o = 6 same 1
+// CHECK-NEXT: other model 0 same 1
+// CHECK-NEXT: truncated 0 same 1
+// CHECK-NEXT: huge 0 same 1
+// CHECK-NEXT: wrong size 0 same 1
+// CHECK-NEXT: wrong size checkpoint 0 same 1
+
+//--- model.mlir
+hw.module @counter(in %clk: i1, out o: i8) {
+  %seq_clk = seq.to_clock %clk
+
+  %reg = seq.compreg %added, %seq_clk : i8
+
+  %one = hw.constant 1 : i8
+  %added = comb.add %reg, %one : i8
+
+  hw.output %reg : i8
+}
+
+//--- driver.cpp
+#include "model.h"
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+static void tick(counter &model, unsigned n = 1) {
+  for (unsigned i = 0; i < n; ++i) {
+    model.view.clk = 1;
+    model.eval();
+    model.view.clk = 0;
+    model.eval();
+  }
+}
+
+static std::vector<uint8_t> bytes(const counter &model) {
+  return std::vector<uint8_t>(model.storage.data(),
+                              model.storage.data() + model.storage.size());
+}
+
+static bool same(const counter &a, const counter &b) {
+  return bytes(a) == bytes(b);
+}
+
+int main() {
+  counter model;
+  tick(model, 5);
+  std::cout << "ticked o = " << unsigned(model.view.o) << "\n";
+
+  // Restoring a snapshot rewinds the entire storage.
+  auto saved = bytes(model);
+  Snapshot snapshot = model.snapshot();
+  tick(model, 3);
+  std::cout << "advanced o = " << unsigned(model.view.o) << "\n";
+  bool ok = model.restore(snapshot);
+  std::cout << "restored " << ok << " o = " << unsigned(model.view.o)
+            << " same " << (bytes(model) == saved) << "\n";
+
+  // A snapshot relative to an earlier one captures the same state.
+  tick(model, 2);
+  Snapshot relative = model.snapshot(snapshot);
+  counter other;
+  ok = other.restore(relative);
+  std::cout << "relative restored " << ok << " same " << same(model, other)
+            << "\n";
+
+  // Instances forked from the same snapshot evolve independently.
+  counter fork1, fork2;
+  fork1.restore(snapshot);
+  fork2.restore(snapshot);
+  tick(fork1, 1);
+  tick(fork2, 2);
+  std::cout << "forks o = " << unsigned(fork1.view.o)
+            << " and o = " << unsigned(fork2.view.o) << "\n";
+
+  // Checkpoints round-trip through a stream.
+  model.restore(snapshot);
+  std::stringstream checkpoint;
+  std::cout << "saved " << model.saveCheckpoint(checkpoint) << "\n";
+  counter loaded;
+  ok = loaded.loadCheckpoint(checkpoint);
+  std::cout << "loaded " << ok << " o = " << unsigned(loaded.view.o) << " same "
+            << same(model, loaded) << "\n";
+  tick(model);
+  tick(loaded);
+  std::cout << "loaded ticked o = " << unsigned(loaded.view.o) << " same "
+            << same(model, loaded) << "\n";
+
+  // Malformed checkpoints are rejected and leave the storage alone.
+  saved = bytes(loaded);
+  std::stringstream otherModel;
+  snapshot.write(otherModel, "other");
+  ok = loaded.loadCheckpoint(otherModel);
+  std::cout << "other model " << ok << " same " << (bytes(loaded) == saved)
+            << "\n";
+
+  std::string full = checkpoint.str();
+  std::stringstream truncated(full.substr(0, full.size() - 1));
+  ok = loaded.loadCheckpoint(truncated);
+  std::cout << "truncated " << ok << " same " << (bytes(loaded) == saved)
+            << "\n";
+
+  // The storage size follows the magic, version, and model name.
+  std::string huge = full;
+  uint64_t hugeBytes = uint64_t(1) << 60;
+  std::memcpy(&huge[8 + 4 + 4 + strlen(counterLayout::name)], &hugeBytes,
+              sizeof(hugeBytes));
+  std::stringstream hugeCheckpoint(huge);
+  ok = loaded.loadCheckpoint(hugeCheckpoint);
+  std::cout << "huge " << ok << " same " << (bytes(loaded) == saved) << "\n";
+
+  std::vector<uint8_t> larger(loaded.storage.size() + 1, 1);
+  ok = loaded.restore(Snapshot(larger.data(), larger.size()));
+  std::cout << "wrong size " << ok << " same " << (bytes(loaded) == saved)
+            << "\n";
+  std::stringstream largerCheckpoint;
+  Snapshot(larger.data(), larger.size()).write(largerCheckpoint,
+                                               counterLayout::name);
+  ok = loaded.loadCheckpoint(largerCheckpoint);
+  std::cout << "wrong size checkpoint " << ok << " same "
+            << (bytes(loaded) == saved) << "\n";
+  return 0;
+}
@@ -17,6 +17,9 @@
 #include "circt/Analysis/SchedulingAnalysis.h"
 #include "circt/Dialect/FIRRTL/FIRRTLInstanceGraph.h"
 #include "circt/Dialect/HW/HWInstanceGraph.h"
+#include "circt/Dialect/SSP/SSPOps.h"
+#include "circt/Dialect/SSP/Utilities.h"
+#include "circt/Scheduling/Algorithms.h"
 #include "circt/Scheduling/Problems.h"
 #include "mlir/Dialect/Affine/IR/AffineMemoryOpInterfaces.h"
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
@@ -146,6 +149,110 @@ void TestSchedulingAnalysisPass::runOnOperation() {
   });
 }
 
+//===----------------------------------------------------------------------===//
+// IncrementalSimplexScheduler
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct TestIncrementalSimplexSchedulerPass
+    : public PassWrapper<TestIncrementalSimplexSchedulerPass,
+                         OperationPass<mlir::ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(
+      TestIncrementalSimplexSchedulerPass)
+
+  void runOnOperation() override;
+  LogicalResult testInstance(ssp::InstanceOp instOp, OpBuilder &builder);
+  StringRef getArgument() const override {
+    return "test-incremental-simplex-scheduler";
+  }
+  StringRef getDescription() const override {
+    return "Perturb and re-schedule SSP instances of the basic problem with "
+           "the incremental simplex scheduler, and compare every schedule "
+           "against one computed from scratch";
+  }
+};
+} // namespace
+
+void TestIncrementalSimplexSchedulerPass::runOnOperation() {
+  SmallVector<ssp::InstanceOp> instanceOps;
+  OpBuilder builder(&getContext());
+  for (auto instOp : getOperation().getOps<ssp::InstanceOp>()) {
+    if (instOp.getProblemName() != Problem::name)
+      continue;
+    builder.setInsertionPoint(instOp);
+    if (failed(testInstance(instOp, builder)))
+      return signalPassFailure();
+    instanceOps.push_back(instOp);
+  }
+  for (auto instOp : instanceOps)
+    instOp.erase();
+}
+
+/// Schedule the instance, then increase and restore the latency of each
+/// operator type, and remove and re-insert each auxiliary dependence. After
+/// every change, the problem is re-optimized from the previous solution, and
+/// the result is compared against a copy of the problem scheduled from scratch.
+/// The final schedule replaces the instance.
+LogicalResult
+TestIncrementalSimplexSchedulerPass::testInstance(ssp::InstanceOp instOp,
+                                                  OpBuilder &builder) {
+  auto *graphBlock = instOp.getDependenceGraph().getBodyBlock();
+  if (graphBlock->empty())
+    return instOp.emitError("instance has no operations");
+  Operation *lastOp = &graphBlock->back();
+
+  auto prob = ssp::loadProblem<Problem>(instOp);
+  if (failed(prob.check()))
+    return failure();
+
+  IncrementalSimplexScheduler scheduler(prob, lastOp);
+  auto reschedule = [&](const Twine &change) -> LogicalResult {
+    if (failed(scheduler.schedule()) || failed(prob.verify()))
+      return failure();
+    Problem scratch(prob);
+    if (failed(scheduleSimplex(scratch, lastOp)))
+      return failure();
+    unsigned incrementalEnd = *prob.getStartTime(lastOp);
+    unsigned scratchEnd = *scratch.getStartTime(lastOp);
+    if (incrementalEnd == scratchEnd)
+      return success();
+    return instOp.emitError()
+           << "incremental schedule after " << change << " ends at "
+           << incrementalEnd << ", but the schedule computed from scratch ends "
+           << "at " << scratchEnd;
+  };
+  if (failed(reschedule("the initial solve")))
+    return failure();
+
+  for (auto opr : prob.getOperatorTypes()) {
+    auto latency = prob.getLatency(opr);
+    if (!latency)
+      continue;
+    prob.setLatency(opr, *latency + 1);
+    if (failed(reschedule("increasing the latency of " + opr.getValue())))
+      return failure();
+    prob.setLatency(opr, *latency);
+    if (failed(reschedule("restoring the latency of " + opr.getValue())))
+      return failure();
+  }
+
+  SmallVector<Problem::Dependence> auxDeps;
+  for (auto *op : prob.getOperations())
+    for (auto dep : prob.getDependences(op))
+      if (dep.isAuxiliary())
+        auxDeps.push_back(dep);
+  for (auto dep : auxDeps) {
+    if (failed(prob.eraseDependence(dep)) ||
+        failed(reschedule("removing an auxiliary dependence")) ||
+        failed(prob.insertDependence(dep)) ||
+        failed(reschedule("re-inserting an auxiliary dependence")))
+      return failure();
+  }
+
+  ssp::saveProblem(prob, builder);
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // InstanceGraph
 //===----------------------------------------------------------------------===//
@@ -276,6 +383,9 @@ void registerAnalysisTestPasses() {
   registerPass([]() -> std::unique_ptr<Pass> {
     return std::make_unique<TestSchedulingAnalysisPass>();
   });
+  registerPass([]() -> std::unique_ptr<Pass> {
+    return std::make_unique<TestIncrementalSimplexSchedulerPass>();
+  });
   registerPass([]() -> std::unique_ptr<Pass> {
     return std::make_unique<TestDebugAnalysisPass>();
   });
@@ -342,8 +342,10 @@ protected:
   llvm::DenseMap<StringRef, ModelInfoMap> &modelInfo;
 };
 
-/// Lowers SimInstantiateOp to a malloc and memset call. This pattern will
-/// mutate the global module.
+/// Lowers SimInstantiateOp to a calloc call. This pattern will mutate the
+/// global module. Using calloc rather than malloc and memset lets the C library
+/// hand out fresh, lazily zeroed pages for large models, such that sparsely
+/// accessed memories only occupy host memory for the pages actually touched.
 struct SimInstantiateOpLowering
     : public ModelAwarePattern<arc::SimInstantiateOp> {
   using ModelAwarePattern::ModelAwarePattern;
@@ -367,20 +369,19 @@ struct SimInstantiateOpLowering
     // sizeof(size_t) on the target architecture.
     Type convertedIndex = typeConverter->convertType(rewriter.getIndexType());
 
-    LLVM::LLVMFuncOp mallocFunc =
-        LLVM::lookupOrCreateMallocFn(moduleOp, convertedIndex);
+    LLVM::LLVMFuncOp callocFunc = LLVM::lookupOrCreateFn(
+        moduleOp, "calloc", {convertedIndex, convertedIndex},
+        LLVM::LLVMPointerType::get(getContext()));
     LLVM::LLVMFuncOp freeFunc = LLVM::lookupOrCreateFreeFn(moduleOp);
 
     Location loc = op.getLoc();
     Value numStateBytes = rewriter.create<LLVM::ConstantOp>(
         loc, convertedIndex, model.numStateBytes);
-    Value allocated =
-        rewriter
-            .create<LLVM::CallOp>(loc, mallocFunc, ValueRange{numStateBytes})
-            .getResult();
-    Value zero =
-        rewriter.create<LLVM::ConstantOp>(loc, rewriter.getI8Type(), 0);
-    rewriter.create<LLVM::MemsetOp>(loc, allocated, zero, numStateBytes, false);
+    Value one = rewriter.create<LLVM::ConstantOp>(loc, convertedIndex, 1);
+    Value allocated = rewriter
+                          .create<LLVM::CallOp>(loc, callocFunc,
+                                                ValueRange{numStateBytes, one})
+                          .getResult();
 
     // Call the model's 'initial' function if present.
     if (model.initialFnSymbol) {
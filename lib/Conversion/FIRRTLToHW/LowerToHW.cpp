@@ -42,7 +42,6 @@
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FormatVariadic.h"
-#include "llvm/Support/Mutex.h"
 #include "llvm/Support/Parallel.h"
 
 #define DEBUG_TYPE "lower-to-hw"
@@ -211,12 +210,40 @@ namespace {
 
 struct FIRRTLModuleLowering;
 
-/// This is state shared across the parallel module lowering logic.
+/// This is state accumulated while lowering the operations of a single module.
+/// Each module is lowered by a single thread, so none of this needs any
+/// synchronization. Once all modules are lowered, their states are merged into
+/// the `CircuitLoweringState` in module order, which also keeps the output
+/// independent of the thread scheduling.
+struct ModuleLoweringState {
+  // Flags indicating whether the module uses certain header fragments.
+  bool usedPrintfCond = false;
+  bool usedAssertVerboseCond = false;
+  bool usedStopCond = false;
+
+  /// The sv::BindOps created in the module, which are moved out of the module
+  /// after the parallel lowering.
+  SmallVector<sv::BindOp> binds;
+
+  /// The guard macros the module uses.
+  SetVector<StringAttr> macroDeclNames;
+
+  /// The names of the fragments on which the module relies.
+  SetVector<StringRef> fragments;
+
+  /// The annotations remaining on the operations of the module after they were
+  /// lowered, together with the location of the operation.
+  SmallVector<std::pair<Location, Annotation>> remainingAnnotations;
+};
+
+/// This is state shared across the parallel module lowering logic. It is only
+/// read during the parallel region; everything the modules produce goes through
+/// their `ModuleLoweringState`.
 struct CircuitLoweringState {
   // Flags indicating whether the circuit uses certain header fragments.
-  std::atomic<bool> usedPrintfCond{false};
-  std::atomic<bool> usedAssertVerboseCond{false};
-  std::atomic<bool> usedStopCond{false};
+  bool usedPrintfCond = false;
+  bool usedAssertVerboseCond = false;
+  bool usedStopCond = false;
 
   CircuitLoweringState(CircuitOp circuitOp, bool enableAnnotationWarning,
                        firrtl::VerificationFlavor verificationFlavor,
@@ -288,15 +315,14 @@ struct CircuitLoweringState {
   // Process remaining annotations and emit warnings on unprocessed annotations
   // still remaining in the annoSet.
   void processRemainingAnnotations(Operation *op, const AnnotationSet &annoSet);
+  void processRemainingAnnotation(Location loc, Annotation anno);
 
-  CircuitOp circuitOp;
+  // Merge the state accumulated while lowering the operations of `module` into
+  // the circuit state. This must be called outside of the parallel region.
+  void mergeModuleState(hw::HWModuleOp module,
+                        ModuleLoweringState &moduleState);
 
-  // Safely add a BindOp to global mutable state.  This will acquire a lock to
-  // do this safely.
-  void addBind(sv::BindOp op) {
-    std::lock_guard<std::mutex> lock(bindsMutex);
-    binds.push_back(op);
-  }
+  CircuitOp circuitOp;
 
   /// For a given Type Alias, return the corresponding AliasType. Create and
   /// record the AliasType, if it doesn't exist.
@@ -371,17 +397,9 @@ private:
   // once about any annotation class.
   StringSet<> pendingAnnotations;
   const bool enableAnnotationWarning;
-  std::mutex annotationPrintingMtx;
 
   const firrtl::VerificationFlavor verificationFlavor;
 
-  // Records any sv::BindOps that are found during the course of execution.
-  // This is unsafe to access directly and should only be used through addBind.
-  SmallVector<sv::BindOp> binds;
-
-  // Control access to binds.
-  std::mutex bindsMutex;
-
   // The design-under-test (DUT), if it is found.  This will be set if a
   // "sifive.enterprise.firrtl.MarkDUTAnnotation" exists.
   FModuleLike dut;
@@ -399,23 +417,6 @@ private:
 
   /// The set of guard macros to emit declarations for.
   SetVector<StringAttr> macroDeclNames;
-  std::mutex macroDeclMutex;
-
-  void addMacroDecl(StringAttr name) {
-    std::unique_lock<std::mutex> lock(macroDeclMutex);
-    macroDeclNames.insert(name);
-  }
-
-  /// The list of fragments on which the modules rely. Must be set outside the
-  /// parallelized module lowering since module type reads access it.
-  DenseMap<hw::HWModuleOp, SetVector<Attribute>> fragments;
-  llvm::sys::SmartMutex<true> fragmentsMutex;
-
-  void addFragment(hw::HWModuleOp module, StringRef fragment) {
-    llvm::sys::SmartScopedLock<true> lock(fragmentsMutex);
-    fragments[module].insert(
-        FlatSymbolRefAttr::get(circuitOp.getContext(), fragment));
-  }
 
   /// Cached nla table analysis.
   NLATable *nlaTable = nullptr;
@@ -496,54 +497,84 @@ private:
 
 void CircuitLoweringState::processRemainingAnnotations(
     Operation *op, const AnnotationSet &annoSet) {
-  if (!enableAnnotationWarning || annoSet.empty())
+  if (!enableAnnotationWarning)
     return;
-  std::lock_guard<std::mutex> lock(annotationPrintingMtx);
+  for (auto a : annoSet)
+    processRemainingAnnotation(op->getLoc(), a);
+}
 
-  for (auto a : annoSet) {
-    auto inserted = pendingAnnotations.insert(a.getClass());
-    if (!inserted.second)
-      continue;
+void CircuitLoweringState::processRemainingAnnotation(Location loc,
+                                                      Annotation a) {
+  if (!enableAnnotationWarning)
+    return;
+  auto inserted = pendingAnnotations.insert(a.getClass());
+  if (!inserted.second)
+    return;
 
-    // The following annotations are okay to be silently dropped at this point.
-    // This can occur for example if an annotation marks something in the IR as
-    // not to be processed by a pass, but that pass hasn't run anyway.
-    if (a.isClass(
-            // If the class is `circt.nonlocal`, it's not really an annotation,
-            // but part of a path specifier for another annotation which is
-            // non-local.  We can ignore these path specifiers since there will
-            // be a warning produced for the real annotation.
-            "circt.nonlocal",
-            // The following are either consumed by a pass running before
-            // LowerToHW, or they have no effect if the pass doesn't run at all.
-            // If the accompanying pass runs on the HW dialect, then LowerToHW
-            // should have consumed and processed these into an attribute on the
-            // output.
-            dontObfuscateModuleAnnoClass, noDedupAnnoClass,
-            // The following are inspected (but not consumed) by FIRRTL/GCT
-            // passes that have all run by now. Since no one is responsible for
-            // consuming these, they will linger around and can be ignored.
-            dutAnnoClass, metadataDirectoryAttrName,
-            elaborationArtefactsDirectoryAnnoClass, testBenchDirAnnoClass,
-            // This annotation is used to mark which external modules are
-            // imported blackboxes from the BlackBoxReader pass.
-            blackBoxAnnoClass,
-            // This annotation is used by several GrandCentral passes.
-            extractGrandCentralClass,
-            // The following will be handled while lowering the verification
-            // ops.
-            extractAssertAnnoClass, extractAssumeAnnoClass,
-            extractCoverageAnnoClass,
-            // The following will be handled after lowering FModule ops, since
-            // they are still needed on the circuit until after lowering
-            // FModules.
-            moduleHierAnnoClass, testHarnessHierAnnoClass,
-            blackBoxTargetDirAnnoClass))
-      continue;
+  // The following annotations are okay to be silently dropped at this point.
+  // This can occur for example if an annotation marks something in the IR as
+  // not to be processed by a pass, but that pass hasn't run anyway.
+  if (a.isClass(
+          // If the class is `circt.nonlocal`, it's not really an annotation,
+          // but part of a path specifier for another annotation which is
+          // non-local.  We can ignore these path specifiers since there will
+          // be a warning produced for the real annotation.
+          "circt.nonlocal",
+          // The following are either consumed by a pass running before
+          // LowerToHW, or they have no effect if the pass doesn't run at all.
+          // If the accompanying pass runs on the HW dialect, then LowerToHW
+          // should have consumed and processed these into an attribute on the
+          // output.
+          dontObfuscateModuleAnnoClass, noDedupAnnoClass,
+          // The following are inspected (but not consumed) by FIRRTL/GCT
+          // passes that have all run by now. Since no one is responsible for
+          // consuming these, they will linger around and can be ignored.
+          dutAnnoClass, metadataDirectoryAttrName,
+          elaborationArtefactsDirectoryAnnoClass, testBenchDirAnnoClass,
+          // This annotation is used to mark which external modules are
+          // imported blackboxes from the BlackBoxReader pass.
+          blackBoxAnnoClass,
+          // This annotation is used by several GrandCentral passes.
+          extractGrandCentralClass,
+          // The following will be handled while lowering the verification
+          // ops.
+          extractAssertAnnoClass, extractAssumeAnnoClass,
+          extractCoverageAnnoClass,
+          // The following will be handled after lowering FModule ops, since
+          // they are still needed on the circuit until after lowering
+          // FModules.
+          moduleHierAnnoClass, testHarnessHierAnnoClass,
+          blackBoxTargetDirAnnoClass))
+    return;
+
+  mlir::emitWarning(loc, "unprocessed annotation:'" + a.getClass() +
+                             "' still remaining after LowerToHW");
+}
+
+void CircuitLoweringState::mergeModuleState(hw::HWModuleOp module,
+                                            ModuleLoweringState &moduleState) {
+  // Move binds from inside the module to outside of it.
+  for (auto bind : moduleState.binds)
+    bind->moveBefore(module);
 
-    mlir::emitWarning(op->getLoc(), "unprocessed annotation:'" + a.getClass() +
-                                        "' still remaining after LowerToHW");
+  // Fix up fragment attributes.
+  if (!moduleState.fragments.empty()) {
+    auto *context = module.getContext();
+    SmallVector<Attribute> fragments;
+    for (auto fragment : moduleState.fragments)
+      fragments.push_back(FlatSymbolRefAttr::get(context, fragment));
+    module->setAttr(emit::getFragmentsAttrName(),
+                    ArrayAttr::get(context, fragments));
   }
+
+  macroDeclNames.insert(moduleState.macroDeclNames.begin(),
+                        moduleState.macroDeclNames.end());
+  usedPrintfCond |= moduleState.usedPrintfCond;
+  usedAssertVerboseCond |= moduleState.usedAssertVerboseCond;
+  usedStopCond |= moduleState.usedStopCond;
+
+  for (auto [loc, anno] : moduleState.remainingAnnotations)
+    processRemainingAnnotation(loc, anno);
 }
 } // end anonymous namespace
 
@@ -577,7 +608,8 @@ private:
   lowerModulePortsAndMoveBody(FModuleOp oldModule, hw::HWModuleOp newModule,
                               CircuitLoweringState &loweringState);
   LogicalResult lowerModuleOperations(hw::HWModuleOp module,
-                                      CircuitLoweringState &loweringState);
+                                      CircuitLoweringState &loweringState,
+                                      ModuleLoweringState &moduleState);
 };
 
 } // end anonymous namespace
@@ -632,8 +664,27 @@ void FIRRTLModuleLowering::runOnOperation() {
       extractAssertAnnoClass, extractAssumeAnnoClass, extractCoverageAnnoClass);
 
   state.processRemainingAnnotations(circuit, circuitAnno);
+
+  // Find the alias types used in each module in parallel. They are lowered
+  // sequentially below, in module order, which keeps the TypeDecls in the
+  // global TypeScopeOp deterministic. Only the first use of each alias type in
+  // a module matters, since later ones reuse its TypeDecl.
+  SmallVector<FModuleOp> fmodules(circuitBody->getOps<FModuleOp>());
+  SmallVector<SmallVector<std::pair<Type, Location>>> aliasTypeUses(
+      fmodules.size());
+  mlir::parallelFor(&getContext(), 0, fmodules.size(), [&](size_t index) {
+    DenseSet<Type> seen;
+    fmodules[index].walk([&](Operation *op) {
+      for (auto res : op->getResults())
+        if (type_isa<BaseTypeAliasType>(res.getType()) &&
+            seen.insert(res.getType()).second)
+          aliasTypeUses[index].push_back({res.getType(), op->getLoc()});
+    });
+  });
+
   // Iterate through each operation in the circuit body, transforming any
   // FModule's we come across. If any module fails to lower, return early.
+  unsigned fmoduleIndex = 0;
   for (auto &op : make_early_inc_range(circuitBody->getOperations())) {
     auto result =
         TypeSwitch<Operation *, LogicalResult>(&op)
@@ -645,13 +696,9 @@ void FIRRTLModuleLowering::runOnOperation() {
               state.recordModuleMapping(&op, loweredMod);
               modulesToProcess.push_back(loweredMod);
               // Lower all the alias types.
-              module.walk([&](Operation *op) {
-                for (auto res : op->getResults()) {
-                  if (auto aliasType =
-                          type_dyn_cast<BaseTypeAliasType>(res.getType()))
-                    state.lowerType(aliasType, op->getLoc());
-                }
-              });
+              assert(fmodules[fmoduleIndex] == module);
+              for (auto [type, loc] : aliasTypeUses[fmoduleIndex++])
+                state.lowerType(type, loc);
               return lowerModulePortsAndMoveBody(module, loweredMod, state);
             })
             .Case<FExtModuleOp>([&](auto extModule) {
@@ -725,25 +772,22 @@ void FIRRTLModuleLowering::runOnOperation() {
         ->setAttr(moduleHierarchyFileAttrName,
                   ArrayAttr::get(&getContext(), testHarnessHierarchyFiles));
 
-  // Finally, lower all operations.
+  // Finally, lower all operations. Each module accumulates what it produces
+  // for the circuit in its own state, such that the threads share nothing but
+  // read-only data.
+  SmallVector<ModuleLoweringState> moduleStates(modulesToProcess.size());
   auto result = mlir::failableParallelForEachN(
       &getContext(), 0, modulesToProcess.size(), [&](auto index) {
-        return lowerModuleOperations(modulesToProcess[index], state);
+        return lowerModuleOperations(modulesToProcess[index], state,
+                                     moduleStates[index]);
       });
 
   // If any module bodies failed to lower, return early.
   if (failed(result))
     return signalPassFailure();
 
-  // Move binds from inside modules to outside modules.
-  for (auto bind : state.binds) {
-    bind->moveBefore(bind->getParentOfType<hw::HWModuleOp>());
-  }
-
-  // Fix up fragment attributes.
-  for (auto &[module, fragments] : state.fragments)
-    module->setAttr(emit::getFragmentsAttrName(),
-                    ArrayAttr::get(&getContext(), fragments.getArrayRef()));
+  for (auto [module, moduleState] : llvm::zip(modulesToProcess, moduleStates))
+    state.mergeModuleState(module, moduleState);
 
   // Finally delete all the old modules.
   for (auto oldNew : state.oldToNewModuleMap)
@@ -1398,10 +1442,11 @@ namespace {
 
 struct FIRRTLLowering : public FIRRTLVisitor<FIRRTLLowering, LogicalResult> {
 
-  FIRRTLLowering(hw::HWModuleOp module, CircuitLoweringState &circuitState)
+  FIRRTLLowering(hw::HWModuleOp module, CircuitLoweringState &circuitState,
+                 ModuleLoweringState &moduleState)
       : theModule(module), circuitState(circuitState),
-        builder(module.getLoc(), module.getContext()), moduleNamespace(module),
-        backedgeBuilder(builder, module.getLoc()) {}
+        moduleState(moduleState), builder(module.getLoc(), module.getContext()),
+        moduleNamespace(module), backedgeBuilder(builder, module.getLoc()) {}
 
   LogicalResult run();
 
@@ -1704,6 +1749,7 @@ private:
 
   /// Global state.
   CircuitLoweringState &circuitState;
+  ModuleLoweringState &moduleState;
 
   /// This builder is set to the right location for each visit call.
   ImplicitLocOpBuilder builder;
@@ -1781,8 +1827,9 @@ private:
 } // end anonymous namespace
 
 LogicalResult FIRRTLModuleLowering::lowerModuleOperations(
-    hw::HWModuleOp module, CircuitLoweringState &loweringState) {
-  return FIRRTLLowering(module, loweringState).run();
+    hw::HWModuleOp module, CircuitLoweringState &loweringState,
+    ModuleLoweringState &moduleState) {
+  return FIRRTLLowering(module, loweringState, moduleState).run();
 }
 
 // This is the main entrypoint for the lowering pass.
@@ -1800,7 +1847,9 @@ LogicalResult FIRRTLLowering::run() {
     builder.setInsertionPoint(&op);
     builder.setLoc(op.getLoc());
     auto done = succeeded(dispatchVisitor(&op));
-    circuitState.processRemainingAnnotations(&op, AnnotationSet(&op));
+    if (circuitState.enableAnnotationWarning)
+      for (auto anno : AnnotationSet(&op))
+        moduleState.remainingAnnotations.push_back({op.getLoc(), anno});
     if (done)
       opsToRemove.push_back(&op);
     else {
@@ -2590,7 +2639,7 @@ LogicalResult FIRRTLLowering::emitGuards(Location loc,
                            "elements in `guards` array must be `StringAttr`");
 
   // Record the guard macro to emit a declaration for it.
-  circuitState.addMacroDecl(builder.getStringAttr(guard.getValue()));
+  moduleState.macroDeclNames.insert(builder.getStringAttr(guard.getValue()));
   LogicalResult result = LogicalResult::failure();
   addToIfDefBlock(guard.getValue(), [&]() {
     result = emitGuards(loc, guards.drop_front(), emit);
@@ -3300,7 +3349,7 @@ LogicalResult FIRRTLLowering::visitDecl(InstanceOp oldInstance) {
       bindOp->setAttr("output_file", outputFile);
     // Add the bind to the circuit state.  This will be moved outside of the
     // encapsulating module after all modules have been processed in parallel.
-    circuitState.addBind(bindOp);
+    moduleState.binds.push_back(bindOp);
   }
 
   // Create the new hw.instance operation.
@@ -4260,7 +4309,7 @@ LogicalResult FIRRTLLowering::visitStmt(ForceOp op) {
     return op.emitError("destination isn't an inout type");
 
   // #ifndef SYNTHESIS
-  circuitState.addMacroDecl(builder.getStringAttr("SYNTHESIS"));
+  moduleState.macroDeclNames.insert(builder.getStringAttr("SYNTHESIS"));
   addToIfDefBlock("SYNTHESIS", std::function<void()>(), [&]() {
     addToInitialBlock([&]() { builder.create<sv::ForceOp>(destVal, srcVal); });
   });
@@ -4279,7 +4328,7 @@ LogicalResult FIRRTLLowering::visitStmt(RefForceOp op) {
     return failure();
 
   // #ifndef SYNTHESIS
-  circuitState.addMacroDecl(builder.getStringAttr("SYNTHESIS"));
+  moduleState.macroDeclNames.insert(builder.getStringAttr("SYNTHESIS"));
   addToIfDefBlock("SYNTHESIS", std::function<void()>(), [&]() {
     addToAlwaysBlock(clock, [&]() {
       addIfProceduralBlock(
@@ -4299,7 +4348,7 @@ LogicalResult FIRRTLLowering::visitStmt(RefForceInitialOp op) {
     return failure();
 
   // #ifndef SYNTHESIS
-  circuitState.addMacroDecl(builder.getStringAttr("SYNTHESIS"));
+  moduleState.macroDeclNames.insert(builder.getStringAttr("SYNTHESIS"));
   addToIfDefBlock("SYNTHESIS", std::function<void()>(), [&]() {
     addToInitialBlock([&]() {
       addIfProceduralBlock(
@@ -4319,7 +4368,7 @@ LogicalResult FIRRTLLowering::visitStmt(RefReleaseOp op) {
     return failure();
 
   // #ifndef SYNTHESIS
-  circuitState.addMacroDecl(builder.getStringAttr("SYNTHESIS"));
+  moduleState.macroDeclNames.insert(builder.getStringAttr("SYNTHESIS"));
   addToIfDefBlock("SYNTHESIS", std::function<void()>(), [&]() {
     addToAlwaysBlock(clock, [&]() {
       addIfProceduralBlock(pred,
@@ -4335,7 +4384,7 @@ LogicalResult FIRRTLLowering::visitStmt(RefReleaseInitialOp op) {
     return failure();
 
   // #ifndef SYNTHESIS
-  circuitState.addMacroDecl(builder.getStringAttr("SYNTHESIS"));
+  moduleState.macroDeclNames.insert(builder.getStringAttr("SYNTHESIS"));
   addToIfDefBlock("SYNTHESIS", std::function<void()>(), [&]() {
     addToInitialBlock([&]() {
       addIfProceduralBlock(pred,
@@ -4363,11 +4412,11 @@ LogicalResult FIRRTLLowering::visitStmt(PrintFOp op) {
   }
 
   // Emit an "#ifndef SYNTHESIS" guard into the always block.
-  circuitState.addMacroDecl(builder.getStringAttr("SYNTHESIS"));
+  moduleState.macroDeclNames.insert(builder.getStringAttr("SYNTHESIS"));
   addToIfDefBlock("SYNTHESIS", std::function<void()>(), [&]() {
     addToAlwaysBlock(clock, [&]() {
-      circuitState.usedPrintfCond = true;
-      circuitState.addFragment(theModule, "PRINTF_COND_FRAGMENT");
+      moduleState.usedPrintfCond = true;
+      moduleState.fragments.insert("PRINTF_COND_FRAGMENT");
 
       // Emit an "sv.if '`PRINTF_COND_ & cond' into the #ifndef.
       Value ifCond =
@@ -4393,8 +4442,8 @@ LogicalResult FIRRTLLowering::visitStmt(StopOp op) {
   if (!clock || !cond)
     return failure();
 
-  circuitState.usedStopCond = true;
-  circuitState.addFragment(theModule, "STOP_COND_FRAGMENT");
+  moduleState.usedStopCond = true;
+  moduleState.fragments.insert("STOP_COND_FRAGMENT");
 
   Value stopCond =
       builder.create<sv::MacroRefExprOp>(cond.getType(), "STOP_COND_");
@@ -4546,15 +4595,15 @@ LogicalResult FIRRTLLowering::lowerVerificationStatement(
       predicate = comb::createOrFoldNot(predicate, builder, /*twoState=*/true);
       predicate = builder.createOrFold<comb::AndOp>(enable, predicate, true);
 
-      circuitState.addMacroDecl(builder.getStringAttr("SYNTHESIS"));
+      moduleState.macroDeclNames.insert(builder.getStringAttr("SYNTHESIS"));
       addToIfDefBlock("SYNTHESIS", {}, [&]() {
         addToAlwaysBlock(clock, [&]() {
           addIfProceduralBlock(predicate, [&]() {
-            circuitState.usedStopCond = true;
-            circuitState.addFragment(theModule, "STOP_COND_FRAGMENT");
+            moduleState.usedStopCond = true;
+            moduleState.fragments.insert("STOP_COND_FRAGMENT");
 
-            circuitState.usedAssertVerboseCond = true;
-            circuitState.addFragment(theModule, "ASSERT_VERBOSE_COND_FRAGMENT");
+            moduleState.usedAssertVerboseCond = true;
+            moduleState.fragments.insert("ASSERT_VERBOSE_COND_FRAGMENT");
 
             addIfProceduralBlock(
                 builder.create<sv::MacroRefExprOp>(boolType,
@@ -4732,8 +4781,8 @@ LogicalResult FIRRTLLowering::visitStmt(AttachOp op) {
 
   // If the attach operands contain a port, then we can't do anything to
   // simplify the attach operation.
-  circuitState.addMacroDecl(builder.getStringAttr("SYNTHESIS"));
-  circuitState.addMacroDecl(builder.getStringAttr("VERILATOR"));
+  moduleState.macroDeclNames.insert(builder.getStringAttr("SYNTHESIS"));
+  moduleState.macroDeclNames.insert(builder.getStringAttr("VERILATOR"));
   addToIfDefBlock(
       "SYNTHESIS",
       // If we're doing synthesis, we emit an all-pairs assign complex.
@@ -11,12 +11,20 @@
 //===----------------------------------------------------------------------===//
 
 #include "ImportVerilogInternals.h"
+#include "circt/Support/Version.h"
+#include "mlir/Bytecode/BytecodeWriter.h"
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/Verifier.h"
+#include "mlir/Parser/Parser.h"
 #include "mlir/Support/Timing.h"
 #include "mlir/Tools/mlir-translate/Translation.h"
 #include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA256.h"
 #include "llvm/Support/SourceMgr.h"
 
 #include "slang/diagnostics/DiagnosticClient.h"
@@ -25,6 +33,8 @@
 #include "slang/syntax/SyntaxPrinter.h"
 #include "slang/util/Version.h"
 
+#include <set>
+
 using namespace mlir;
 using namespace circt;
 using namespace ImportVerilog;
@@ -130,22 +140,6 @@ private:
 };
 } // namespace
 
-// Allow for `slang::BufferID` to be used as hash map keys.
-namespace llvm {
-template <>
-struct DenseMapInfo<slang::BufferID> {
-  static slang::BufferID getEmptyKey() { return slang::BufferID(); }
-  static slang::BufferID getTombstoneKey() {
-    return slang::BufferID(UINT32_MAX - 1, ""sv);
-    // UINT32_MAX is already used by `BufferID::getPlaceholder`.
-  }
-  static unsigned getHashValue(slang::BufferID id) {
-    return llvm::hash_value(id.getId());
-  }
-  static bool isEqual(slang::BufferID a, slang::BufferID b) { return a == b; }
-};
-} // namespace llvm
-
 //===----------------------------------------------------------------------===//
 // Driver
 //===----------------------------------------------------------------------===//
@@ -163,6 +157,8 @@ struct ImportDriver {
   LogicalResult importVerilog(ModuleOp module);
   LogicalResult preprocessVerilog(llvm::raw_ostream &os);
 
+  std::string computeOptionsKey();
+
   MLIRContext *mlirContext;
   TimingScope &ts;
   const ImportVerilogOptions &options;
@@ -241,6 +237,13 @@ LogicalResult ImportDriver::prepareDriver(SourceMgr &sourceMgr) {
   return success(driver.processOptions());
 }
 
+/// Load the dialects the imported IR may contain.
+static void loadImportedDialects(MLIRContext *context) {
+  context->loadDialect<moore::MooreDialect, hw::HWDialect,
+                       cf::ControlFlowDialect, func::FuncDialect,
+                       debug::DebugDialect>();
+}
+
 /// Parse and elaborate the prepared source files, and populate the given MLIR
 /// `module` with corresponding operations.
 LogicalResult ImportDriver::importVerilog(ModuleOp module) {
@@ -263,20 +266,335 @@ LogicalResult ImportDriver::importVerilog(ModuleOp module) {
   if (options.mode == ImportVerilogOptions::Mode::OnlyLint)
     return success();
 
+  // Reuse the converted bodies of modules whose sources are unchanged. Macros
+  // may leak across source files if they are all parsed as a single unit, in
+  // which case all files need to be unchanged.
+  std::optional<ModuleCache> moduleCache;
+  if (!options.cacheDir.empty()) {
+    auto cacheTimer = ts.nest("Import cache setup");
+    moduleCache.emplace(options.cacheDir, computeOptionsKey(), *compilation,
+                        driver.sourceManager, bufferFilePaths,
+                        options.singleUnit.value_or(false) ||
+                            options.librariesInheritMacros.value_or(false));
+  }
+
   // Traverse the parsed Verilog AST and map it to the equivalent CIRCT ops.
-  mlirContext
-      ->loadDialect<moore::MooreDialect, hw::HWDialect, cf::ControlFlowDialect,
-                    func::FuncDialect, debug::DebugDialect>();
+  loadImportedDialects(mlirContext);
   auto conversionTimer = ts.nest("Verilog to dialect mapping");
   Context context(options, *compilation, module, driver.sourceManager,
                   bufferFilePaths);
-  if (failed(context.convertCompilation()))
+  context.moduleCache = moduleCache ? &*moduleCache : nullptr;
+  if (failed(context.convertCompilation(conversionTimer)))
     return failure();
   conversionTimer.stop();
 
   // Run the verifier on the constructed module to ensure it is clean.
   auto verifierTimer = ts.nest("Post-parse verification");
-  return verify(module);
+  if (failed(verify(module)))
+    return failure();
+  verifierTimer.stop();
+
+  // Cache the converted module bodies for subsequent imports.
+  if (moduleCache) {
+    auto cacheTimer = ts.nest("Import cache store");
+    moduleCache->storeConvertedBodies();
+  }
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// Module Cache
+//===----------------------------------------------------------------------===//
+//
+// Slang offers no way to serialize parsed or elaborated compilation units, so
+// the sources are always parsed and elaborated, and the cache operates on the
+// converted bodies of individual modules instead. Every specialization of a
+// module gets its own entry in the cache directory, named
+// `<module>-<key>.mlirbc`, which holds a copy of the module op and of the
+// functions declared within it as MLIR bytecode.
+//
+// The key covers everything the converted body depends on:
+//
+// - The source file defining the module, together with all files it includes.
+//   Files are identified by their resolved path and their contents, such that
+//   an include resolving to a different file changes the key as well.
+// - The source files containing compilation unit members like packages, which
+//   any module may refer to.
+// - The module's parameter values.
+// - The names and types of the module, its instances, and the functions
+//   declared within it, which the body refers to by symbol.
+// - The tool versions and all options that affect the imported IR.
+//
+// Editing a source file therefore only invalidates the modules defined in it,
+// unless it contains packages or other members shared by all modules.
+//
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// A helper to hash a sequence of strings.
+struct KeyHasher {
+  llvm::SHA256 hasher;
+
+  void add(StringRef str) {
+    // Prefix with the length to keep adjacent strings apart.
+    hasher.update(std::to_string(str.size()));
+    hasher.update(":");
+    hasher.update(str);
+  }
+
+  template <typename T>
+  void addPrinted(const T &value) {
+    std::string str;
+    llvm::raw_string_ostream(str) << value;
+    add(str);
+  }
+
+  std::string final() {
+    return llvm::toHex(hasher.final(), /*LowerCase=*/true);
+  }
+};
+} // namespace
+
+/// Compute a key that identifies the tool versions and the options that affect
+/// the imported IR.
+std::string ImportDriver::computeOptionsKey() {
+  KeyHasher key;
+  auto addStrings = [&](const auto &strs) {
+    key.add(std::to_string(strs.size()));
+    for (const auto &str : strs)
+      key.add(str);
+  };
+  auto addOptional = [&](const auto &opt) {
+    if (opt)
+      key.addPrinted(*opt);
+    else
+      key.add("none");
+  };
+
+  key.add(getCirctVersion());
+  key.add(getSlangVersion());
+
+  // Use the driver's include directories, which also contain the ones from the
+  // source manager.
+  key.add(options.debugInfo ? "g" : "");
+  addStrings(driver.options.includeDirs);
+  addStrings(options.includeSystemDirs);
+  addStrings(options.libDirs);
+  addStrings(options.libExts);
+  addStrings(options.excludeExts);
+  addStrings(options.ignoreDirectives);
+  addOptional(options.maxIncludeDepth);
+  addStrings(options.defines);
+  addStrings(options.undefines);
+  addOptional(options.librariesInheritMacros);
+  addOptional(options.timeScale);
+  addOptional(options.allowUseBeforeDeclare);
+  addOptional(options.ignoreUnknownModules);
+  addStrings(options.topModules);
+  addStrings(options.paramOverrides);
+  addOptional(options.singleUnit);
+  addStrings(options.libraryFiles);
+  return key.final();
+}
+
+ModuleCache::ModuleCache(
+    StringRef dir, std::string optionsKey, slang::ast::Compilation &compilation,
+    const slang::SourceManager &sourceManager,
+    SmallDenseMap<slang::BufferID, StringRef> &bufferFilePaths,
+    bool includeAllSources)
+    : dir(dir), optionsKey(std::move(optionsKey)),
+      sourceManager(sourceManager), bufferFilePaths(bufferFilePaths) {
+  // Group the buffers by the source file they were loaded for.
+  DenseMap<slang::BufferID, SmallVector<slang::BufferID>> buffersByFile;
+  for (auto buffer : sourceManager.getAllBuffers()) {
+    auto file = buffer;
+    while (auto includedFrom = sourceManager.getIncludedFrom(file))
+      file = includedFrom.buffer();
+    sourceFiles[buffer] = file;
+    buffersByFile[file].push_back(buffer);
+  }
+
+  // Hash every source file together with the files it includes.
+  for (auto &[file, buffers] : buffersByFile) {
+    KeyHasher key;
+    for (auto buffer : buffers) {
+      // Slang null-terminates its buffers.
+      StringRef text = sourceManager.getSourceText(buffer);
+      if (text.ends_with(StringRef("\0", 1)))
+        text = text.drop_back();
+      key.add(sourceManager.getFullPath(buffer).string());
+      key.add(bufferFilePaths.lookup(buffer));
+      key.add(text);
+    }
+    sourceFileHashes[file] = key.final();
+  }
+
+  // Hash the source files shared by all modules, in a deterministic order.
+  std::set<std::string> sharedHashes;
+  if (includeAllSources) {
+    for (auto &[file, hash] : sourceFileHashes)
+      sharedHashes.insert(hash);
+  } else {
+    for (auto *unit : compilation.getRoot().compilationUnits) {
+      for (auto &member : unit->members()) {
+        auto loc = sourceManager.getFullyOriginalLoc(member.location);
+        auto it = sourceFiles.find(loc.buffer());
+        if (it != sourceFiles.end())
+          sharedHashes.insert(sourceFileHashes.lookup(it->second));
+      }
+    }
+  }
+  KeyHasher key;
+  for (auto &hash : sharedHashes)
+    key.add(hash);
+  sharedSourcesHash = key.final();
+}
+
+/// Get the path of the cache entry for a module. The module name only serves
+/// to make the cache directory easier to inspect.
+std::string ModuleCache::getEntryPath(StringRef moduleName, StringRef key) {
+  std::string fileName;
+  for (auto c : moduleName)
+    fileName += llvm::isAlnum(c) ? c : '_';
+  fileName += '-';
+  fileName += key;
+  fileName += ".mlirbc";
+  SmallString<128> path(dir);
+  llvm::sys::path::append(path, fileName);
+  return std::string(path);
+}
+
+bool ModuleCache::lookup(const slang::ast::InstanceBodySymbol &module,
+                         ModuleLowering &lowering,
+                         ArrayRef<const ModuleLowering *> instances,
+                         ArrayRef<const FunctionLowering *> functions) {
+  // Modules from buffers that are not source files, such as the ones created
+  // for command line macros, are not cached.
+  auto loc =
+      sourceManager.getFullyOriginalLoc(module.getDefinition().location);
+  auto fileIt = sourceFiles.find(loc.buffer());
+  if (fileIt == sourceFiles.end())
+    return false;
+
+  KeyHasher key;
+  key.add(optionsKey);
+  key.add(sharedSourcesHash);
+  key.add(sourceFileHashes.lookup(fileIt->second));
+  key.add(std::to_string(module.parameters.size()));
+  for (auto *param : module.parameters) {
+    key.add(param->symbol.name);
+    if (auto *value = param->symbol.as_if<slang::ast::ParameterSymbol>())
+      key.add(value->getValue().toString());
+    else
+      key.add(param->symbol.as<slang::ast::TypeParameterSymbol>()
+                  .getTypeAlias()
+                  .toString());
+  }
+  key.add(lowering.op.getSymName());
+  key.addPrinted(lowering.op.getModuleType());
+  key.add(std::to_string(instances.size()));
+  for (auto *instance : instances) {
+    key.add(instance->op.getSymName());
+    key.addPrinted(instance->op.getModuleType());
+  }
+  key.add(std::to_string(functions.size()));
+  for (auto *function : functions) {
+    key.add(function->op.getSymName());
+    key.addPrinted(function->op.getFunctionType());
+  }
+
+  PendingEntry entry;
+  entry.key = key.final();
+  entry.op = lowering.op;
+  for (auto *function : functions)
+    entry.functions.push_back(function->op);
+
+  // Parse the cached entry, if there is one. A damaged entry is treated like a
+  // missing one, so don't report parse errors. The entry refers to symbols
+  // outside of it, so it cannot be verified on its own.
+  auto path = getEntryPath(lowering.op.getSymName(), entry.key);
+  OwningOpRef<ModuleOp> cached;
+  if (llvm::sys::fs::exists(path)) {
+    auto *context = lowering.op.getContext();
+    ScopedDiagnosticHandler silenceErrors(
+        context, [](Diagnostic &) { return success(); });
+    cached = parseSourceFile<ModuleOp>(
+        path, ParserConfig(context, /*verifyAfterParse=*/false));
+  }
+
+  // Check that the entry contains the expected ops.
+  auto matches = [&]() {
+    auto &ops = cached->getBody()->getOperations();
+    if (ops.size() != 1 + entry.functions.size())
+      return false;
+    auto cachedModule = dyn_cast<moore::SVModuleOp>(&ops.front());
+    if (!cachedModule || cachedModule.getSymName() != entry.op.getSymName() ||
+        cachedModule.getModuleType() != entry.op.getModuleType())
+      return false;
+    for (auto [op, function] :
+         llvm::zip(llvm::drop_begin(ops), entry.functions)) {
+      auto cachedFunction = dyn_cast<func::FuncOp>(&op);
+      if (!cachedFunction ||
+          cachedFunction.getSymName() != function.getSymName() ||
+          cachedFunction.getFunctionType() != function.getFunctionType())
+        return false;
+    }
+    return true;
+  };
+  if (!cached || !matches()) {
+    LLVM_DEBUG(llvm::dbgs() << "Import cache miss: " << lowering.op.getSymName()
+                            << "\n");
+    pending.push_back(std::move(entry));
+    return false;
+  }
+
+  // Move the cached bodies into place.
+  LLVM_DEBUG(llvm::dbgs() << "Import cache hit: " << lowering.op.getSymName()
+                          << "\n");
+  auto &ops = cached->getBody()->getOperations();
+  lowering.op.getBodyRegion().takeBody(
+      cast<moore::SVModuleOp>(&ops.front()).getBodyRegion());
+  for (auto [op, function] :
+       llvm::zip(llvm::drop_begin(ops), entry.functions))
+    function.getBody().takeBody(cast<func::FuncOp>(&op).getBody());
+  return true;
+}
+
+void ModuleCache::storeConvertedBodies() {
+  if (pending.empty())
+    return;
+  auto warn = [&](Location loc, const Twine &message) {
+    mlir::emitWarning(loc, "cannot write import cache: ") << message;
+  };
+  auto loc = pending.front().op.getLoc();
+  if (auto error = llvm::sys::fs::create_directories(dir))
+    return warn(loc, dir + ": " + error.message());
+
+  for (auto &entry : pending) {
+    OwningOpRef<ModuleOp> cached = ModuleOp::create(entry.op.getLoc());
+    auto builder = OpBuilder::atBlockEnd(cached->getBody());
+    builder.clone(*entry.op.getOperation());
+    for (auto function : entry.functions)
+      builder.clone(*function.getOperation());
+
+    // Entries are written to a temporary file first, such that concurrent
+    // imports never see a partially written entry.
+    auto path = getEntryPath(entry.op.getSymName(), entry.key);
+    if (auto error =
+            llvm::writeToOutput(path, [&](raw_ostream &os) -> llvm::Error {
+              if (failed(writeBytecodeToFile(*cached, os)))
+                return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                               "bytecode emission failed");
+              return llvm::Error::success();
+            }))
+      return warn(entry.op.getLoc(), llvm::toString(std::move(error)));
+  }
+  pending.clear();
+}
+
+void ModuleCache::discard(moore::SVModuleOp op) {
+  llvm::erase_if(pending,
+                 [&](const PendingEntry &entry) { return entry.op == op; });
 }
 
 /// Preprocess the prepared source files and print them to the given output
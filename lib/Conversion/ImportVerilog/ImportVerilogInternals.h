@@ -16,7 +16,9 @@
 #include "circt/Dialect/Moore/MooreOps.h"
 #include "mlir/Dialect/ControlFlow/IR/ControlFlowOps.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Support/Timing.h"
 #include "slang/ast/ASTVisitor.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/ScopedHashTable.h"
 #include "llvm/Support/Debug.h"
 #include <map>
@@ -24,6 +26,22 @@
 
 #define DEBUG_TYPE "import-verilog"
 
+// Allow for `slang::BufferID` to be used as hash map keys.
+namespace llvm {
+template <>
+struct DenseMapInfo<slang::BufferID> {
+  static slang::BufferID getEmptyKey() { return slang::BufferID(); }
+  static slang::BufferID getTombstoneKey() {
+    return slang::BufferID(UINT32_MAX - 1, std::string_view());
+    // UINT32_MAX is already used by `BufferID::getPlaceholder`.
+  }
+  static unsigned getHashValue(slang::BufferID id) {
+    return llvm::hash_value(id.getId());
+  }
+  static bool isEqual(slang::BufferID a, slang::BufferID b) { return a == b; }
+};
+} // namespace llvm
+
 namespace circt {
 namespace ImportVerilog {
 
@@ -49,6 +67,62 @@ struct FunctionLowering {
   mlir::func::FuncOp op;
 };
 
+/// A persistent cache of converted module bodies. An entry holds the body of a
+/// module and of the functions declared within it, and is keyed by everything
+/// that IR depends on: the source files the module was parsed from, including
+/// the files they include, its parameter values, the names and types of the
+/// symbols it refers to, and the import options. See `ImportVerilog.cpp`.
+class ModuleCache {
+public:
+  ModuleCache(StringRef dir, std::string optionsKey,
+              slang::ast::Compilation &compilation,
+              const slang::SourceManager &sourceManager,
+              SmallDenseMap<slang::BufferID, StringRef> &bufferFilePaths,
+              bool includeAllSources);
+
+  /// Look up the body of a module whose header and declared members have
+  /// already been created. On a hit, moves the cached bodies into the module
+  /// and function ops and returns true. On a miss, remembers the module such
+  /// that its body is stored by `storeConvertedBodies` once converted.
+  bool lookup(const slang::ast::InstanceBodySymbol &module,
+              ModuleLowering &lowering,
+              ArrayRef<const ModuleLowering *> instances,
+              ArrayRef<const FunctionLowering *> functions);
+
+  /// Store the bodies of all modules that missed the cache. Failing to write
+  /// the cache is not an error, but is reported as a warning.
+  void storeConvertedBodies();
+
+  /// Do not store the body of a module that missed the cache. Used for bodies
+  /// whose conversion emitted warnings, which would not be replayed on a hit.
+  void discard(moore::SVModuleOp op);
+
+private:
+  std::string getEntryPath(StringRef moduleName, StringRef key);
+
+  /// A module body to be stored once converted.
+  struct PendingEntry {
+    std::string key;
+    moore::SVModuleOp op;
+    SmallVector<mlir::func::FuncOp> functions;
+  };
+
+  std::string dir;
+  std::string optionsKey;
+  const slang::SourceManager &sourceManager;
+  SmallDenseMap<slang::BufferID, StringRef> &bufferFilePaths;
+  /// The source file every buffer was loaded for, which is the buffer itself
+  /// unless it was included by another one.
+  DenseMap<slang::BufferID, slang::BufferID> sourceFiles;
+  /// The hash of every source file together with all files it includes.
+  DenseMap<slang::BufferID, std::string> sourceFileHashes;
+  /// The hashes of the source files containing compilation unit members, such
+  /// as packages, which any module may refer to. Covers all source files if
+  /// macros may leak across files.
+  std::string sharedSourcesHash;
+  SmallVector<PendingEntry> pending;
+};
+
 /// Information about a loops continuation and exit blocks relevant while
 /// lowering the loop's body statements.
 struct LoopFrame {
@@ -88,10 +162,18 @@ struct Context {
   Type convertType(const slang::ast::DeclaredType &type);
 
   /// Convert hierarchy and structure AST nodes to MLIR ops.
-  LogicalResult convertCompilation();
+  LogicalResult convertCompilation(mlir::TimingScope &ts);
   ModuleLowering *
   convertModuleHeader(const slang::ast::InstanceBodySymbol *module);
-  LogicalResult convertModuleBody(const slang::ast::InstanceBodySymbol *module);
+  LogicalResult convertModuleBody(const slang::ast::InstanceBodySymbol *module,
+                                  ModuleLowering &lowering);
+  LogicalResult declareModuleMembers(
+      const slang::ast::Scope &scope,
+      SmallVectorImpl<const ModuleLowering *> *instances = nullptr,
+      SmallVectorImpl<const FunctionLowering *> *functions = nullptr);
+  FailureOr<bool>
+  loadCachedModuleBody(const slang::ast::InstanceBodySymbol *module,
+                       ModuleLowering &lowering);
   LogicalResult convertPackage(const slang::ast::PackageSymbol &package);
   FunctionLowering *
   declareFunction(const slang::ast::SubroutineSymbol &subroutine);
@@ -201,6 +283,9 @@ struct Context {
   /// example to populate the list of observed signals in an implicit event
   /// control `@*`.
   std::function<void(moore::ReadOp)> rvalueReadCallback;
+
+  /// The cache of converted module bodies, if enabled.
+  ModuleCache *moduleCache = nullptr;
 };
 
 } // namespace ImportVerilog
@@ -259,8 +259,12 @@ struct ModuleVisitor : public BaseVisitor {
     auto module = moduleLowering->op;
     auto moduleType = module.getModuleType();
 
-    // Set visibility attribute for instantiated module.
-    SymbolTable::setSymbolVisibility(module, SymbolTable::Visibility::Private);
+    // Set visibility attribute for instantiated module. Check first, since
+    // other module bodies may concurrently look at the same module.
+    if (SymbolTable::getSymbolVisibility(module) !=
+        SymbolTable::Visibility::Private)
+      SymbolTable::setSymbolVisibility(module,
+                                       SymbolTable::Visibility::Private);
 
     // Prepare the values that are involved in port connections. This creates
     // rvalues for input ports and appropriate lvalues for output, inout, and
@@ -559,12 +563,13 @@ struct ModuleVisitor : public BaseVisitor {
 
 /// Convert an entire Slang compilation to MLIR ops. This is the main entry
 /// point for the conversion.
-LogicalResult Context::convertCompilation() {
+LogicalResult Context::convertCompilation(mlir::TimingScope &ts) {
   const auto &root = compilation.getRoot();
 
   // Visit all top-level declarations in all compilation units. This does not
   // include instantiable constructs like modules, interfaces, and programs,
   // which are listed separately as top instances.
+  auto rootTimer = ts.nest("Top-level declarations");
   for (auto *unit : root.compilationUnits) {
     for (const auto &member : unit->members()) {
       auto loc = convertLocation(member.location);
@@ -578,18 +583,106 @@ LogicalResult Context::convertCompilation() {
   for (auto *inst : root.topInstances)
     if (!convertModuleHeader(&inst->body))
       return failure();
+  rootTimer.stop();
 
   // Convert all the root module definitions.
+  auto bodiesTimer = ts.nest("Module bodies");
   while (!moduleWorklist.empty()) {
     auto *module = moduleWorklist.front();
     moduleWorklist.pop();
-    if (failed(convertModuleBody(module)))
+    auto &lowering = *modules[module];
+    auto cached = loadCachedModuleBody(module, lowering);
+    if (failed(cached))
       return failure();
+    if (*cached)
+      continue;
+    if (!moduleCache) {
+      if (failed(convertModuleBody(module, lowering)))
+        return failure();
+      continue;
+    }
+
+    // Warnings emitted while converting the body would not be replayed when
+    // loading it from the cache, so only store bodies converted without any.
+    bool hasWarnings = false;
+    auto countWarnings = [&](Diagnostic &diag) {
+      if (diag.getSeverity() == mlir::DiagnosticSeverity::Warning)
+        hasWarnings = true;
+      return failure();
+    };
+    {
+      mlir::ScopedDiagnosticHandler handler(getContext(), countWarnings);
+      if (failed(convertModuleBody(module, lowering)))
+        return failure();
+    }
+    if (hasWarnings)
+      moduleCache->discard(lowering.op);
   }
 
   return success();
 }
 
+/// Try to load the body of a module from the module cache. This declares the
+/// members of the module upfront, since the cache key depends on their names,
+/// and returns whether the body has been loaded.
+FailureOr<bool>
+Context::loadCachedModuleBody(const slang::ast::InstanceBodySymbol *module,
+                              ModuleLowering &lowering) {
+  if (!moduleCache)
+    return false;
+  SmallVector<const ModuleLowering *> instances;
+  SmallVector<const FunctionLowering *> functions;
+  if (failed(declareModuleMembers(*module, &instances, &functions)))
+    return failure();
+  return moduleCache->lookup(*module, lowering, instances, functions);
+}
+
+/// Create the module headers for all instances and the declarations for all
+/// functions in a module body, without converting anything else. This visits
+/// the same members as the `ModuleVisitor` does. The lowerings of the
+/// instantiated modules and declared functions are added to `instances` and
+/// `functions`, if provided.
+LogicalResult Context::declareModuleMembers(
+    const slang::ast::Scope &scope,
+    SmallVectorImpl<const ModuleLowering *> *instances,
+    SmallVectorImpl<const FunctionLowering *> *functions) {
+  for (auto &member : scope.members()) {
+    if (auto *instNode = member.as_if<slang::ast::InstanceSymbol>()) {
+      auto *moduleLowering = convertModuleHeader(&instNode->body);
+      if (!moduleLowering)
+        return failure();
+      SymbolTable::setSymbolVisibility(moduleLowering->op,
+                                       SymbolTable::Visibility::Private);
+      if (instances)
+        instances->push_back(moduleLowering);
+      continue;
+    }
+    if (auto *subroutine = member.as_if<slang::ast::SubroutineSymbol>()) {
+      auto *functionLowering = declareFunction(*subroutine);
+      if (!functionLowering)
+        return failure();
+      if (functions)
+        functions->push_back(functionLowering);
+      continue;
+    }
+    if (auto *genNode = member.as_if<slang::ast::GenerateBlockSymbol>()) {
+      if (!genNode->isUninstantiated &&
+          failed(declareModuleMembers(*genNode, instances, functions)))
+        return failure();
+      continue;
+    }
+    if (auto *genArrNode =
+            member.as_if<slang::ast::GenerateBlockArraySymbol>()) {
+      for (const auto *entry : genArrNode->entries)
+        if (!entry->isUninstantiated &&
+            failed(declareModuleMembers(*entry, instances, functions)))
+          return failure();
+      continue;
+    }
+  }
+  return success();
+}
+
 /// Convert a module and its ports to an empty module op in the IR. Also adds
 /// the op to the worklist of module bodies to be lowered. This acts like a
 /// module "declaration", allowing instances to already refer to a module even
@@ -739,10 +832,11 @@ Context::convertModuleHeader(const slang::ast::InstanceBodySymbol *module) {
 }
 
 /// Convert a module's body to the corresponding IR ops. The module op must have
-/// already been created earlier through a `convertModuleHeader` call.
+/// already been created earlier through a `convertModuleHeader` call, which
+/// returned `lowering`.
 LogicalResult
-Context::convertModuleBody(const slang::ast::InstanceBodySymbol *module) {
-  auto &lowering = *modules[module];
+Context::convertModuleBody(const slang::ast::InstanceBodySymbol *module,
+                           ModuleLowering &lowering) {
   OpBuilder::InsertionGuard g(builder);
   builder.setInsertionPointToEnd(lowering.op.getBody());
 
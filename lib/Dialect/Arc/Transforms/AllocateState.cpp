@@ -10,6 +10,7 @@
 #include "circt/Dialect/Arc/ArcPasses.h"
 #include "mlir/IR/ImplicitLocOpBuilder.h"
 #include "mlir/Pass/Pass.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/Debug.h"
 
 #define DEBUG_TYPE "arc-allocate-state"
@@ -27,6 +28,70 @@ using namespace arc;
 
 using llvm::SmallMapVector;
 
+/// The host page size large memories are aligned to.
+static constexpr unsigned pageSize = 4096;
+
+/// Get the number of bytes an allocation operation occupies in its storage.
+static unsigned getAllocationSize(Operation *op) {
+  if (isa<AllocStateOp, RootInputOp, RootOutputOp>(op))
+    return cast<StateType>(op->getResult(0).getType()).getByteWidth();
+  if (auto memOp = dyn_cast<AllocMemoryOp>(op)) {
+    auto memType = memOp.getType();
+    return memType.getNumWords() * memType.getStride();
+  }
+  if (auto allocStorageOp = dyn_cast<AllocStorageOp>(op))
+    return allocStorageOp.getType().getSize();
+  assert("unsupported op for allocation" && false);
+  return 0;
+}
+
+/// Get the alignment of an allocation of `numBytes`, which is its own size
+/// rounded up to a power of two, or 16 bytes at most.
+static unsigned getAlignment(unsigned numBytes) {
+  return llvm::bit_ceil(std::min(numBytes, 16U));
+}
+
+//===----------------------------------------------------------------------===//
+// Access Analysis
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// The accesses to an allocation from within the block it is allocated in. Any
+/// user of the allocation is attributed to the operation in the block that
+/// contains it, which usually is an `scf.if` guarding a clock domain, or an
+/// initial or final op. Users directly in the block are attributed to the block
+/// itself.
+struct AccessInfo {
+  /// The operations in the block accessing the allocation, given as their
+  /// position in the block plus one. Zero is the block itself. Sorted.
+  SmallVector<unsigned, 2> accessors;
+  /// Whether the allocation is only accessed during initialization and
+  /// finalization of the model, or not at all.
+  bool isCold = true;
+};
+} // namespace
+
+/// Determine which operations in `block` access the result of `op`.
+static AccessInfo
+getAccessInfo(Operation *op, Block *block,
+              const DenseMap<Operation *, unsigned> &positionInBlock) {
+  AccessInfo info;
+  for (auto *user : op->getResult(0).getUsers()) {
+    auto *accessor = block->findAncestorOpInBlock(*user);
+    if (!accessor)
+      continue;
+    if (!isa<InitialOp, FinalOp>(accessor))
+      info.isCold = false;
+    info.accessors.push_back(
+        accessor == user ? 0 : positionInBlock.lookup(accessor) + 1);
+  }
+  llvm::sort(info.accessors);
+  info.accessors.erase(
+      std::unique(info.accessors.begin(), info.accessors.end()),
+      info.accessors.end());
+  return info;
+}
+
 //===----------------------------------------------------------------------===//
 // Pass Implementation
 //===----------------------------------------------------------------------===//
@@ -34,9 +99,15 @@ using llvm::SmallMapVector;
 namespace {
 struct AllocateStatePass
     : public arc::impl::AllocateStateBase<AllocateStatePass> {
+  using AllocateStateBase::AllocateStateBase;
+
   void runOnOperation() override;
   void allocateBlock(Block *block);
   void allocateOps(Value storage, Block *block, ArrayRef<Operation *> ops);
+  void clusterOps(SmallVectorImpl<Operation *> &ops,
+                  ArrayRef<AccessInfo> accessInfos);
+  void updateLineStatistics(ArrayRef<Operation *> ops,
+                            ArrayRef<AccessInfo> accessInfos);
 };
 } // namespace
 
@@ -48,6 +119,12 @@ void AllocateStatePass::runOnOperation() {
   // Walk the blocks from innermost to outermost and group all state allocations
   // in that block in one larger allocation.
   modelOp.walk([&](Block *block) { allocateBlock(block); });
+
+  // Summarize how well the allocations fill the cache lines of the storage.
+  auto storageType =
+      cast<StorageType>(modelOp.getBodyBlock().getArgument(0).getType());
+  unsigned lineSize = std::max(cacheLineSize.getValue(), 1U);
+  numCacheLines += llvm::divideCeil(storageType.getSize(), lineSize);
 }
 
 void AllocateStatePass::allocateBlock(Block *block) {
@@ -69,15 +146,43 @@ void AllocateStatePass::allocateBlock(Block *block) {
 }
 
 void AllocateStatePass::allocateOps(Value storage, Block *block,
-                                    ArrayRef<Operation *> ops) {
+                                    ArrayRef<Operation *> blockOps) {
   SmallVector<std::tuple<Value, Value, IntegerAttr>> gettersToCreate;
 
-  // Helper function to allocate storage aligned to its own size, or 8 bytes at
+  // Determine which operations in the block access each allocation.
+  DenseMap<Operation *, unsigned> positionInBlock;
+  for (auto &op : *block)
+    positionInBlock.insert({&op, positionInBlock.size()});
+  SmallVector<AccessInfo> accessInfos;
+  accessInfos.reserve(blockOps.size());
+  for (auto *op : blockOps)
+    accessInfos.push_back(getAccessInfo(op, block, positionInBlock));
+
+  Operation *storageOwner = storage.getDefiningOp();
+  if (!storageOwner)
+    storageOwner = cast<BlockArgument>(storage).getOwner()->getParentOp();
+  bool isSubstorage = storageOwner->isProperAncestor(block->getParentOp());
+
+  // Determine the order in which to lay out the allocations.
+  SmallVector<Operation *> ops(blockOps);
+  if (clusterByAccess)
+    clusterOps(ops, accessInfos);
+
+  // Large memories go last and start on a page boundary, such that they share
+  // no pages with the frequently accessed states. Substorages are only aligned
+  // to 16 bytes, so this is limited to the model's root storage.
+  auto isLargeMemory = [&](Operation *op) {
+    return largeMemoryBytes != 0 && !isSubstorage && isa<AllocMemoryOp>(op) &&
+           getAllocationSize(op) >= largeMemoryBytes;
+  };
+  std::stable_partition(ops.begin(), ops.end(),
+                        [&](auto *op) { return !isLargeMemory(op); });
+
+  // Helper function to allocate storage aligned to its own size, or 16 bytes at
   // most.
   unsigned currentByte = 0;
   auto allocBytes = [&](unsigned numBytes) {
-    currentByte = llvm::alignToPowerOf2(
-        currentByte, llvm::bit_ceil(std::min(numBytes, 16U)));
+    currentByte = llvm::alignToPowerOf2(currentByte, getAlignment(numBytes));
     unsigned offset = currentByte;
     currentByte += numBytes;
     return offset;
@@ -89,27 +194,28 @@ void AllocateStatePass::allocateOps(Value storage, Block *block,
     if (isa<AllocStateOp, RootInputOp, RootOutputOp>(op)) {
       auto result = op->getResult(0);
       auto storage = op->getOperand(0);
-      unsigned numBytes = cast<StateType>(result.getType()).getByteWidth();
-      auto offset = builder.getI32IntegerAttr(allocBytes(numBytes));
+      auto offset =
+          builder.getI32IntegerAttr(allocBytes(getAllocationSize(op)));
       op->setAttr("offset", offset);
       gettersToCreate.emplace_back(result, storage, offset);
       continue;
     }
 
     if (auto memOp = dyn_cast<AllocMemoryOp>(op)) {
-      auto memType = memOp.getType();
-      unsigned stride = memType.getStride();
-      unsigned numBytes = memType.getNumWords() * stride;
-      auto offset = builder.getI32IntegerAttr(allocBytes(numBytes));
+      if (isLargeMemory(op))
+        currentByte = llvm::alignTo(currentByte, pageSize);
+      auto offset =
+          builder.getI32IntegerAttr(allocBytes(getAllocationSize(op)));
       op->setAttr("offset", offset);
-      op->setAttr("stride", builder.getI32IntegerAttr(stride));
+      op->setAttr("stride",
+                  builder.getI32IntegerAttr(memOp.getType().getStride()));
       gettersToCreate.emplace_back(memOp, memOp.getStorage(), offset);
       continue;
     }
 
     if (auto allocStorageOp = dyn_cast<AllocStorageOp>(op)) {
-      auto offset = builder.getI32IntegerAttr(
-          allocBytes(allocStorageOp.getType().getSize()));
+      auto offset =
+          builder.getI32IntegerAttr(allocBytes(getAllocationSize(op)));
       allocStorageOp.setOffsetAttr(offset);
       gettersToCreate.emplace_back(allocStorageOp, allocStorageOp.getInput(),
                                    offset);
@@ -119,6 +225,17 @@ void AllocateStatePass::allocateOps(Value storage, Block *block,
     assert("unsupported op for allocation" && false);
   }
 
+  // Track the bytes occupied by allocations and the padding between them.
+  // Substorages are accounted for by the blocks they are allocated in.
+  unsigned numUsedBytes = 0;
+  for (auto *op : ops) {
+    unsigned numBytes = getAllocationSize(op);
+    numUsedBytes += numBytes;
+    if (!isa<AllocStorageOp>(op))
+      numStateBytes += numBytes;
+  }
+  numPaddingBytes += currentByte - numUsedBytes;
+
   // For every user of the alloc op, create a local `StorageGetOp`.
   // First, create an ordering of operations to avoid a very expensive
   // combination of isBeforeInBlock and moveBefore calls (which can be O(n²))
@@ -147,11 +264,7 @@ void AllocateStatePass::allocateOps(Value storage, Block *block,
   }
 
   // Create the substorage accessor at the beginning of the block.
-  Operation *storageOwner = storage.getDefiningOp();
-  if (!storageOwner)
-    storageOwner = cast<BlockArgument>(storage).getOwner()->getParentOp();
-
-  if (storageOwner->isProperAncestor(block->getParentOp())) {
+  if (isSubstorage) {
     auto substorage = builder.create<AllocStorageOp>(
         block->getParentOp()->getLoc(),
         StorageType::get(&getContext(), currentByte), storage);
@@ -161,9 +274,79 @@ void AllocateStatePass::allocateOps(Value storage, Block *block,
       op->replaceUsesOfWith(storage, substorage);
   } else {
     storage.setType(StorageType::get(&getContext(), currentByte));
+#if LLVM_ENABLE_STATS
+    updateLineStatistics(blockOps, accessInfos);
+#endif
+  }
+}
+
+/// Reorder the allocations in `ops` such that allocations accessed together are
+/// placed next to each other. Ports come first since the host accesses them
+/// around every evaluation of the model, followed by the allocations accessed
+/// during evaluation, and finally the cold ones. Sorting the hot allocations
+/// by the list of accessing operations groups the allocations private to a
+/// clock domain, and places allocations shared between two clock domains right
+/// after the ones private to the first. Within a group, larger alignments go
+/// first to reduce padding.
+void AllocateStatePass::clusterOps(SmallVectorImpl<Operation *> &ops,
+                                   ArrayRef<AccessInfo> accessInfos) {
+  DenseMap<Operation *, const AccessInfo *> infoForOp;
+  for (auto [op, info] : llvm::zip(ops, accessInfos))
+    infoForOp[op] = &info;
+
+  // Ports first, then hot allocations, then cold ones.
+  auto getKind = [&](Operation *op) {
+    if (isa<RootInputOp, RootOutputOp>(op))
+      return 0;
+    return infoForOp.lookup(op)->isCold ? 2 : 1;
+  };
+  llvm::stable_sort(ops, [&](Operation *a, Operation *b) {
+    auto kindA = getKind(a), kindB = getKind(b);
+    if (kindA != kindB)
+      return kindA < kindB;
+    ArrayRef<unsigned> accessorsA = infoForOp.lookup(a)->accessors;
+    ArrayRef<unsigned> accessorsB = infoForOp.lookup(b)->accessors;
+    if (accessorsA != accessorsB)
+      return std::lexicographical_compare(accessorsA.begin(), accessorsA.end(),
+                                          accessorsB.begin(), accessorsB.end());
+    return getAlignment(getAllocationSize(a)) >
+           getAlignment(getAllocationSize(b));
+  });
+}
+
+/// Count the distinct cache lines each operation in the model body touches
+/// through the allocations it accesses. Only the allocations in the model body
+/// have their final offset, which is why this is limited to them. The lines are
+/// counted from the merged ranges of lines each operation accesses, such that
+/// large memories cost no more than small states. This only feeds a statistic,
+/// so it is skipped in builds that cannot record statistics.
+void AllocateStatePass::updateLineStatistics(ArrayRef<Operation *> ops,
+                                             ArrayRef<AccessInfo> accessInfos) {
+  uint64_t lineSize = std::max(cacheLineSize.getValue(), 1U);
+  SmallMapVector<unsigned, SmallVector<std::pair<uint64_t, uint64_t>>, 4>
+      linesByAccessor;
+  for (auto [op, info] : llvm::zip(ops, accessInfos)) {
+    uint64_t numBytes = getAllocationSize(op);
+    if (numBytes == 0)
+      continue;
+    uint64_t offset = cast<IntegerAttr>(op->getAttr("offset")).getInt();
+    for (auto accessor : info.accessors)
+      linesByAccessor[accessor].push_back(
+          {offset / lineSize, (offset + numBytes - 1) / lineSize + 1});
+  }
+  for (auto &[accessor, lines] : linesByAccessor) {
+    llvm::sort(lines);
+    uint64_t end = 0;
+    for (auto [lineBegin, lineEnd] : lines) {
+      if (lineEnd <= end)
+        continue;
+      numCacheLinesTouched += lineEnd - std::max(lineBegin, end);
+      end = lineEnd;
+    }
   }
 }
 
-std::unique_ptr<Pass> arc::createAllocateStatePass() {
-  return std::make_unique<AllocateStatePass>();
+std::unique_ptr<Pass>
+arc::createAllocateStatePass(const AllocateStateOptions &options) {
+  return std::make_unique<AllocateStatePass>(options);
 }
@@ -13,6 +13,7 @@
 #include "mlir/IR/IRMapping.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/InliningUtils.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Debug.h"
 
 #define DEBUG_TYPE "arc-inline"
@@ -46,7 +47,10 @@ class InlineArcsAnalysis {
 public:
   InlineArcsAnalysis(InlineArcsStatistics &statistics,
                      const InlineArcsOptions &options)
-      : statistics(statistics), options(options) {}
+      : statistics(statistics), options(options) {
+    hotArcs.insert(options.hotArcs.begin(), options.hotArcs.end());
+    coldArcs.insert(options.coldArcs.begin(), options.coldArcs.end());
+  }
 
   /// Clears the current analysis state and recomputes it. The first argument
   /// is a list of regions that can contain calls that should possibly be
@@ -81,6 +85,9 @@ private:
 
   InlineArcsStatistics &statistics;
   const InlineArcsOptions &options;
+  /// Arcs that a profile of a previous simulation found to be hot or cold.
+  llvm::StringSet<> hotArcs;
+  llvm::StringSet<> coldArcs;
 };
 
 /// The actual inliner performing the transformation. Has to be given an
@@ -254,6 +261,15 @@ bool InlineArcsAnalysis::shouldInline(mlir::CallOpInterface callOp) const {
   if (numOpsInArc.at(arcName) <= options.maxNonTrivialOpsInBody)
     return true;
 
+  // Cold arcs stay outlined even if they have a single use, such that they do
+  // not bloat the code that is executed all the time. Hot arcs are inlined at
+  // every use to avoid the call overhead and to expose them to optimizations
+  // across the call boundary.
+  if (coldArcs.contains(arcName.getValue()))
+    return false;
+  if (hotArcs.contains(arcName.getValue()))
+    return true;
+
   return usersPerArc.at(arcName) == 1;
 }
 
@@ -321,6 +337,8 @@ void InlineArcsPass::runOnOperation() {
   InlineArcsOptions options;
   options.intoArcsOnly = intoArcsOnly;
   options.maxNonTrivialOpsInBody = maxNonTrivialOpsInBody;
+  options.hotArcs.assign(hotArcs.begin(), hotArcs.end());
+  options.coldArcs.assign(coldArcs.begin(), coldArcs.end());
   InlineArcsStatistics statistics;
   InlineArcsAnalysis analysis(statistics, options);
   ArcInliner inliner(analysis);
@@ -356,6 +374,7 @@ void InlineArcsPass::runOnOperation() {
   numTrivialArcs = statistics.numTrivialArcs;
 }
 
-std::unique_ptr<Pass> arc::createInlineArcsPass() {
-  return std::make_unique<InlineArcsPass>();
+std::unique_ptr<Pass>
+arc::createInlineArcsPass(const InlineArcsOptions &options) {
+  return std::make_unique<InlineArcsPass>(options);
 }
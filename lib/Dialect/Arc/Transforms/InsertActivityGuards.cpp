@@ -0,0 +1,225 @@
+//===- InsertActivityGuards.cpp -------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/Arc/ArcOps.h"
+#include "circt/Dialect/Arc/ArcPasses.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "arc-insert-activity-guards"
+
+namespace circt {
+namespace arc {
+#define GEN_PASS_DEF_INSERTACTIVITYGUARDSPASS
+#include "circt/Dialect/Arc/ArcPasses.h.inc"
+} // namespace arc
+} // namespace circt
+
+using namespace mlir;
+using namespace circt;
+using namespace arc;
+
+namespace {
+struct InsertActivityGuardsPass
+    : public arc::impl::InsertActivityGuardsPassBase<
+          InsertActivityGuardsPass> {
+  using InsertActivityGuardsPassBase::InsertActivityGuardsPassBase;
+
+  void runOnOperation() override;
+  void runOnBlock(Block &block);
+  bool isSink(StateWriteOp op);
+  void guardRegion(ArrayRef<Operation *> region);
+
+private:
+  /// The number of writes to each state outside of `arc.initial` and
+  /// `arc.final`.
+  DenseMap<Value, unsigned> numWrites;
+  /// The model body, where shadow states are allocated.
+  Block *modelBlock;
+};
+} // namespace
+
+void InsertActivityGuardsPass::runOnOperation() {
+  auto modelOp = getOperation();
+  modelBlock = &modelOp.getBodyBlock();
+
+  // Count the writes to each state that happen during evaluation. A state
+  // written by a guarded region must not be written by anything else, or
+  // skipping the region would fail to restore its value.
+  numWrites.clear();
+  SmallVector<Block *> blocks;
+  modelOp.walk<WalkOrder::PreOrder>([&](Operation *op) {
+    if (isa<InitialOp, FinalOp>(op))
+      return WalkResult::skip();
+    if (auto writeOp = dyn_cast<StateWriteOp>(op))
+      ++numWrites[writeOp.getState()];
+    for (auto &region : op->getRegions())
+      if (region.hasOneBlock() && mlir::mayHaveSSADominance(region))
+        blocks.push_back(&region.front());
+    return WalkResult::advance();
+  });
+
+  // Nested blocks, like the bodies of clock domains, are handled the same way
+  // as the model body. They are opaque to the analysis of their parent block,
+  // so the order in which the blocks are processed does not matter.
+  for (auto *block : blocks)
+    runOnBlock(*block);
+}
+
+/// Check whether a state write may anchor a guarded region.
+bool InsertActivityGuardsPass::isSink(StateWriteOp op) {
+  auto *stateOp = op.getState().getDefiningOp();
+  if (!isa_and_nonnull<AllocStateOp, RootOutputOp>(stateOp))
+    return false;
+  return numWrites.lookup(op.getState()) == 1;
+}
+
+/// Partition the pure ops of a block into regions and guard the ones that are
+/// worth it. Going through the block backwards, every eligible state write
+/// starts a region, and every pure op joins the region of its users, merging
+/// the regions of all its users. Ops with users outside of any region, in
+/// nested blocks, or with side effects stay where they are.
+void InsertActivityGuardsPass::runOnBlock(Block &block) {
+  DenseMap<Operation *, Operation *> regionOf;
+  llvm::EquivalenceClasses<Operation *> sinks;
+  for (auto &op : llvm::reverse(block)) {
+    if (auto writeOp = dyn_cast<StateWriteOp>(op)) {
+      if (isSink(writeOp)) {
+        regionOf[&op] = &op;
+        sinks.insert(&op);
+      }
+      continue;
+    }
+    if (op.getNumRegions() != 0 || op.use_empty() || !isMemoryEffectFree(&op))
+      continue;
+    Operation *sink = nullptr;
+    bool allUsersInRegions = true;
+    for (auto *user : op.getUsers()) {
+      auto it = regionOf.find(user);
+      if (it == regionOf.end()) {
+        allUsersInRegions = false;
+        break;
+      }
+      if (!sink)
+        sink = it->second;
+      else
+        sinks.unionSets(sink, it->second);
+    }
+    if (allUsersInRegions)
+      regionOf[&op] = sink;
+  }
+  if (regionOf.empty())
+    return;
+
+  // Group the ops by region, in block order.
+  llvm::MapVector<Operation *, SmallVector<Operation *>> regions;
+  for (auto &op : block)
+    if (auto it = regionOf.find(&op); it != regionOf.end())
+      regions[sinks.getLeaderValue(it->second)].push_back(&op);
+
+  for (auto &[leader, region] : regions)
+    guardRegion(region);
+}
+
+/// Wrap the ops of a region in an `scf.if` that only executes them if any of
+/// the region's inputs changed since the last time they were executed. The
+/// guard is placed at the position of the last op of the region, which is
+/// always a state write.
+void InsertActivityGuardsPass::guardRegion(ArrayRef<Operation *> region) {
+  // Weigh the cost of the change detection against the cost of the region.
+  unsigned numOps = llvm::count_if(
+      region, [](auto *op) { return !isa<StateWriteOp, hw::ConstantOp>(op); });
+  if (numOps < minOps)
+    return;
+
+  SmallPtrSet<Operation *, 16> regionOps(region.begin(), region.end());
+  SetVector<Value> inputs;
+  SmallPtrSet<Value, 4> destStates;
+  for (auto *op : region) {
+    if (auto writeOp = dyn_cast<StateWriteOp>(op))
+      destStates.insert(writeOp.getState());
+    for (auto operand : op->getOperands()) {
+      if (regionOps.contains(operand.getDefiningOp()))
+        continue;
+      if (isa<StateType>(operand.getType()))
+        continue;
+      auto intType = dyn_cast<IntegerType>(operand.getType());
+      if (!intType || intType.getWidth() == 0)
+        return;
+      inputs.insert(operand);
+    }
+  }
+  if (inputs.empty() || inputs.size() > maxInputs)
+    return;
+
+  // All state writes but the last one are moved down to the guard. This is
+  // only valid if no op in between accesses the states they write.
+  auto *lastOp = region.back();
+  auto *firstWrite = *llvm::find_if(
+      region, [](auto *op) { return isa<StateWriteOp>(op); });
+  for (auto *op = firstWrite; op != lastOp; op = op->getNextNode()) {
+    if (regionOps.contains(op))
+      continue;
+    auto result = op->walk([&](Operation *nestedOp) {
+      Value state;
+      if (auto readOp = dyn_cast<StateReadOp>(nestedOp))
+        state = readOp.getState();
+      else if (auto writeOp = dyn_cast<StateWriteOp>(nestedOp))
+        state = writeOp.getState();
+      if (state && destStates.contains(state))
+        return WalkResult::interrupt();
+      return WalkResult::advance();
+    });
+    if (result.wasInterrupted()) {
+      LLVM_DEBUG(llvm::dbgs() << "- Not guarding region of " << *lastOp
+                              << ": written state accessed before guard\n");
+      return;
+    }
+  }
+
+  // Compare each input against its shadow state. The region also runs if it
+  // has never run before, since the shadows start out zero-initialized.
+  auto loc = lastOp->getLoc();
+  OpBuilder builder(lastOp);
+  auto allocBuilder = OpBuilder::atBlockBegin(modelBlock);
+  auto storage = modelBlock->getArgument(0);
+  auto trueValue = builder.create<hw::ConstantOp>(loc, builder.getI1Type(), 1);
+  SmallVector<Value> shadows;
+  SmallVector<Value> changes;
+  for (auto input : inputs) {
+    auto shadow = allocBuilder.create<AllocStateOp>(
+        loc, StateType::get(input.getType()), storage);
+    auto oldValue = builder.create<StateReadOp>(loc, shadow);
+    changes.push_back(builder.create<comb::ICmpOp>(
+        loc, comb::ICmpPredicate::ne, input, oldValue, true));
+    shadows.push_back(shadow);
+  }
+  auto didRun = allocBuilder.create<AllocStateOp>(
+      loc, StateType::get(builder.getI1Type()), storage);
+  changes.push_back(builder.create<comb::XorOp>(
+      loc, builder.create<StateReadOp>(loc, didRun), trueValue, true));
+  auto anyChanges = builder.create<comb::OrOp>(loc, changes, true);
+
+  auto ifOp = builder.create<scf::IfOp>(loc, anyChanges, false);
+  for (auto *op : region)
+    op->moveBefore(ifOp.thenYield());
+  builder.setInsertionPoint(ifOp.thenYield());
+  for (auto [input, shadow] : llvm::zip(inputs, shadows))
+    builder.create<StateWriteOp>(loc, shadow, input, Value{});
+  builder.create<StateWriteOp>(loc, didRun, trueValue, Value{});
+
+  ++numGuards;
+  numGuardedOps += numOps;
+  numShadowStates += inputs.size() + 1;
+}
@@ -0,0 +1,142 @@
+//===- InsertProfiling.cpp ------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/Arc/ArcOps.h"
+#include "circt/Dialect/Arc/ArcPasses.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "llvm/ADT/StringMap.h"
+
+#define DEBUG_TYPE "arc-insert-profiling"
+
+namespace circt {
+namespace arc {
+#define GEN_PASS_DEF_INSERTPROFILINGPASS
+#include "circt/Dialect/Arc/ArcPasses.h.inc"
+} // namespace arc
+} // namespace circt
+
+using namespace mlir;
+using namespace circt;
+using namespace arc;
+
+/// The runtime function that returns the current value of the cycle counter.
+static constexpr StringLiteral cycleCounterFuncName =
+    "_arc_env_read_cycle_counter";
+
+namespace {
+/// The states accumulating the measurements of one profiled site.
+struct Counters {
+  Value cycles;
+  Value calls;
+};
+
+struct InsertProfilingPass
+    : public arc::impl::InsertProfilingPassBase<InsertProfilingPass> {
+  void runOnOperation() override;
+  void runOnModel(ModelOp modelOp);
+  Counters getCounters(StringRef site, Location loc);
+  void accumulate(OpBuilder &builder, Location loc, Value state, Value value);
+  void instrument(Block *block, Block::iterator begin, Block::iterator end,
+                  StringRef site, Location loc);
+
+private:
+  func::FuncOp cycleCounterFunc;
+  Block *modelBlock;
+  llvm::StringMap<Counters> counters;
+};
+} // namespace
+
+void InsertProfilingPass::runOnOperation() {
+  auto module = getOperation();
+  cycleCounterFunc = module.lookupSymbol<func::FuncOp>(cycleCounterFuncName);
+  if (!cycleCounterFunc) {
+    auto builder = OpBuilder::atBlockEnd(module.getBody());
+    cycleCounterFunc = builder.create<func::FuncOp>(
+        module.getLoc(), cycleCounterFuncName,
+        builder.getFunctionType({}, builder.getI64Type()));
+    cycleCounterFunc.setPrivate();
+  }
+
+  for (auto modelOp : module.getOps<ModelOp>())
+    runOnModel(modelOp);
+}
+
+void InsertProfilingPass::runOnModel(ModelOp modelOp) {
+  modelBlock = &modelOp.getBodyBlock();
+  counters.clear();
+
+  // Collect the clock domains and arc calls before instrumenting anything,
+  // since the instrumentation adds ops to the model body.
+  SmallVector<Operation *> domains;
+  SmallVector<CallOp> calls;
+  for (auto &op : *modelBlock)
+    if (isa<scf::IfOp>(op))
+      domains.push_back(&op);
+  modelOp.walk<WalkOrder::PreOrder>([&](Operation *op) {
+    if (isa<InitialOp, FinalOp>(op))
+      return WalkResult::skip();
+    if (auto callOp = dyn_cast<CallOp>(op))
+      calls.push_back(callOp);
+    return WalkResult::advance();
+  });
+
+  instrument(modelBlock, modelBlock->begin(), modelBlock->end(),
+             "profile/eval", modelOp.getLoc());
+  for (auto [index, op] : llvm::enumerate(domains))
+    instrument(modelBlock, op->getIterator(), std::next(op->getIterator()),
+               "profile/domains/" + std::to_string(index), op->getLoc());
+  for (auto callOp : calls)
+    instrument(callOp->getBlock(), callOp->getIterator(),
+               std::next(callOp->getIterator()),
+               ("profile/arcs/" + callOp.getArc()).str(), callOp.getLoc());
+  numInstrumentedOps += domains.size() + calls.size();
+}
+
+/// Get the counter states of a site, allocating them on first use.
+Counters InsertProfilingPass::getCounters(StringRef site, Location loc) {
+  auto &entry = counters[site];
+  if (entry.cycles)
+    return entry;
+  auto builder = OpBuilder::atBlockBegin(modelBlock);
+  auto storage = modelBlock->getArgument(0);
+  auto stateType = StateType::get(builder.getI64Type());
+  auto cycles = builder.create<AllocStateOp>(loc, stateType, storage);
+  cycles->setAttr("name", builder.getStringAttr(site + "/cycles"));
+  auto calls = builder.create<AllocStateOp>(loc, stateType, storage);
+  calls->setAttr("name", builder.getStringAttr(site + "/calls"));
+  entry = {cycles, calls};
+  return entry;
+}
+
+/// Add a value to a counter state.
+void InsertProfilingPass::accumulate(OpBuilder &builder, Location loc,
+                                     Value state, Value value) {
+  auto oldValue = builder.create<StateReadOp>(loc, state);
+  auto newValue = builder.create<comb::AddOp>(loc, oldValue, value, true);
+  builder.create<StateWriteOp>(loc, state, newValue, Value{});
+}
+
+/// Measure the cycles spent executing the ops in `[begin, end)` and count how
+/// often they are executed.
+void InsertProfilingPass::instrument(Block *block, Block::iterator begin,
+                                     Block::iterator end, StringRef site,
+                                     Location loc) {
+  auto [cycles, calls] = getCounters(site, loc);
+  OpBuilder builder(block, begin);
+  auto start = builder.create<func::CallOp>(loc, cycleCounterFunc);
+  builder.setInsertionPoint(block, end);
+  auto stop = builder.create<func::CallOp>(loc, cycleCounterFunc);
+  auto elapsed = builder.create<comb::SubOp>(loc, stop.getResult(0),
+                                             start.getResult(0), true);
+  accumulate(builder, loc, cycles, elapsed);
+  auto one = builder.create<hw::ConstantOp>(loc, builder.getI64Type(), 1);
+  accumulate(builder, loc, calls, one);
+}
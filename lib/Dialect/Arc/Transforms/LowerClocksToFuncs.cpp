@@ -11,6 +11,7 @@
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/Dialect/SCF/IR/SCF.h"
 #include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/RegionUtils.h"
 #include "llvm/ADT/TypeSwitch.h"
 #include "llvm/Support/Debug.h"
 
@@ -36,9 +37,13 @@ using mlir::OpTrait::ConstantLike;
 namespace {
 struct LowerClocksToFuncsPass
     : public arc::impl::LowerClocksToFuncsBase<LowerClocksToFuncsPass> {
+  using LowerClocksToFuncsBase::LowerClocksToFuncsBase;
   LowerClocksToFuncsPass() = default;
   LowerClocksToFuncsPass(const LowerClocksToFuncsPass &pass)
-      : LowerClocksToFuncsPass() {}
+      : LowerClocksToFuncsPass() {
+    coldDomains = pass.coldDomains;
+    numDomains = pass.numDomains.getValue();
+  }
 
   void runOnOperation() override;
   LogicalResult lowerModel(ModelOp modelOp);
@@ -46,6 +51,7 @@ struct LowerClocksToFuncsPass
                            OpBuilder &funcBuilder);
   LogicalResult isolateClock(Operation *clockOp, Value modelStorageArg,
                              Value clockStorageArg);
+  void lowerDomain(scf::IfOp domainOp, unsigned index, OpBuilder &funcBuilder);
 
   SymbolTable *symbolTable;
 
@@ -99,6 +105,20 @@ LogicalResult LowerClocksToFuncsPass::lowerModel(ModelOp modelOp) {
 
   // Perform the actual extraction.
   OpBuilder funcBuilder(modelOp);
+  if (!coldDomains.empty()) {
+    // The domains are only known by their index, which changes with the
+    // options the model is compiled with, e.g. activity guards add domains.
+    // Make sure the profile was recorded for the same set of domains.
+    SmallVector<scf::IfOp> domains(modelOp.getBodyBlock().getOps<scf::IfOp>());
+    if (numDomains != 0 && domains.size() != numDomains)
+      return modelOp.emitError()
+             << "profile describes " << numDomains
+             << " clock domains, but the model has " << domains.size()
+             << "; the profile must be recorded with the same options";
+    for (auto [index, domainOp] : llvm::enumerate(domains))
+      if (llvm::is_contained(coldDomains, index))
+        lowerDomain(domainOp, index, funcBuilder);
+  }
   for (auto *op : clocks)
     if (failed(lowerClock(op, modelOp.getBody().getArgument(0), funcBuilder)))
       return failure();
@@ -170,6 +190,70 @@ LogicalResult LowerClocksToFuncsPass::lowerClock(Operation *clockOp,
   return success();
 }
 
+/// Move the body of a rarely executed clock domain into a separate function,
+/// which keeps it out of the instruction cache when the model is evaluated.
+/// The domain's condition stays in the model and guards a call to the
+/// function. Domains are numbered in the same way as their profile counters.
+void LowerClocksToFuncsPass::lowerDomain(scf::IfOp domainOp, unsigned index,
+                                         OpBuilder &funcBuilder) {
+  if (domainOp.getNumResults() != 0)
+    return;
+  LLVM_DEBUG(llvm::dbgs() << "- Lowering clock domain " << index << "\n");
+
+  // Constants used by the domain are copied into the function. Any other
+  // value defined outside the domain, including the storage, is passed in.
+  Region &domainRegion = domainOp.getThenRegion();
+  SetVector<Value> captures;
+  getUsedValuesDefinedAbove(domainRegion, captures);
+  SmallVector<Value> operands;
+  for (auto value : captures) {
+    auto *definingOp = value.getDefiningOp();
+    if (!definingOp || !definingOp->hasTrait<ConstantLike>())
+      operands.push_back(value);
+  }
+
+  auto modelOp = domainOp->getParentOfType<ModelOp>();
+  auto funcOp = funcBuilder.create<func::FuncOp>(
+      domainOp.getLoc(),
+      (modelOp.getName() + "_domain" + Twine(index)).str(),
+      funcBuilder.getFunctionType(ValueRange(operands).getTypes(), {}));
+  symbolTable->insert(funcOp); // uniquifies the name
+  LLVM_DEBUG(llvm::dbgs() << "  - Created function `" << funcOp.getSymName()
+                          << "`\n");
+
+  // Move everything but the terminator of the domain into the function.
+  Block *domainBlock = domainOp.thenBlock();
+  Block *funcBlock = funcOp.addEntryBlock();
+  funcBlock->getOperations().splice(funcBlock->end(),
+                                    domainBlock->getOperations(),
+                                    domainBlock->begin(),
+                                    std::prev(domainBlock->end()));
+  auto builder = OpBuilder::atBlockEnd(funcBlock);
+  builder.create<func::ReturnOp>(domainOp.getLoc());
+
+  builder.setInsertionPointToStart(funcBlock);
+  unsigned argIndex = 0;
+  for (auto value : captures) {
+    Value innerValue;
+    auto *definingOp = value.getDefiningOp();
+    if (definingOp && definingOp->hasTrait<ConstantLike>()) {
+      innerValue = builder.clone(*definingOp)
+                       ->getResult(cast<OpResult>(value).getResultNumber());
+      ++numOpsCopied;
+    } else {
+      innerValue = funcBlock->getArgument(argIndex++);
+    }
+    value.replaceUsesWithIf(innerValue, [&](OpOperand &use) {
+      return funcOp->isAncestor(use.getOwner());
+    });
+  }
+
+  // Call the function from within the domain.
+  builder.setInsertionPoint(domainBlock->getTerminator());
+  builder.create<func::CallOp>(domainOp.getLoc(), funcOp, operands);
+  ++numDomainsOutlined;
+}
+
 /// Copy any external constants that the clock tree might be using into its
 /// body. Anything besides constants should no longer exist after a proper run
 /// of the pipeline.
@@ -247,6 +331,7 @@ LogicalResult LowerClocksToFuncsPass::isolateClock(Operation *clockOp,
   return success(!result.wasInterrupted());
 }
 
-std::unique_ptr<Pass> arc::createLowerClocksToFuncsPass() {
-  return std::make_unique<LowerClocksToFuncsPass>();
+std::unique_ptr<Pass>
+arc::createLowerClocksToFuncsPass(const LowerClocksToFuncsOptions &options) {
+  return std::make_unique<LowerClocksToFuncsPass>(options);
 }
@@ -0,0 +1,160 @@
+//===- ResourceSharing.cpp - Resource sharing pass --------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass binds pipelined arithmetic cells used by groups which never execute
+// concurrently onto shared cells.
+//
+// A pipelined cell holds its result on its output ports until it is started
+// again. Sharing a cell therefore shortens the live range of those results to
+// the group starting the cell, and the pass only considers cells whose output
+// ports are only read by groups which also drive the cell.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/Calyx/CalyxOps.h"
+#include "circt/Dialect/Calyx/CalyxPasses.h"
+#include "circt/Support/LLVM.h"
+#include "mlir/IR/SymbolTable.h"
+#include "llvm/ADT/SetOperations.h"
+#include "llvm/ADT/SetVector.h"
+
+namespace circt {
+namespace calyx {
+#define GEN_PASS_DEF_RESOURCESHARING
+#include "circt/Dialect/Calyx/CalyxPasses.h.inc"
+} // namespace calyx
+} // namespace circt
+
+using namespace circt;
+using namespace calyx;
+using namespace mlir;
+
+/// The control ops enclosing an enable, outermost first, ending with the
+/// enable itself.
+using ControlPath = SmallVector<Operation *, 8>;
+
+static ControlPath getControlPath(EnableOp op) {
+  ControlPath path;
+  for (Operation *parent = op; !isa<ControlOp>(parent);
+       parent = parent->getParentOp())
+    path.push_back(parent);
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+/// Check whether two enables may execute at the same time. This is the case if
+/// the innermost control op enclosing both of them is a parallel composition.
+static bool mayRunConcurrently(const ControlPath &a, const ControlPath &b) {
+  auto [itA, itB] = std::mismatch(a.begin(), a.end(), b.begin(), b.end());
+  if (itA == a.begin())
+    return false;
+  return isa<ParOp, StaticParOp>(*std::prev(itA));
+}
+
+namespace {
+/// A cell that other cells of the same kind have been merged into, together
+/// with the groups using it.
+struct SharedCell {
+  Operation *cell;
+  SmallVector<StringAttr> groups;
+};
+
+struct ResourceSharingPass
+    : public circt::calyx::impl::ResourceSharingBase<ResourceSharingPass> {
+  void runOnOperation() override;
+  bool getUserGroups(Operation *cell, SmallVectorImpl<StringAttr> &groups);
+  bool mayConflict(ArrayRef<StringAttr> groupsA, ArrayRef<StringAttr> groupsB);
+
+private:
+  /// The places where the control program enables each group.
+  DenseMap<StringAttr, SmallVector<ControlPath, 1>> enables;
+};
+} // end anonymous namespace
+
+/// Collect the groups using the ports of a cell. Returns false if the cell is
+/// used outside of a group, or by a group the control program does not enable,
+/// or if its outputs are read by a group that does not drive its inputs. In the
+/// latter case the outputs are live across groups, and another group using the
+/// same shared cell in between would overwrite them.
+bool ResourceSharingPass::getUserGroups(Operation *cell,
+                                        SmallVectorImpl<StringAttr> &groups) {
+  auto cellInterface = cast<CellInterface>(cell);
+  SetVector<StringAttr> drivingGroups, readingGroups;
+  for (auto port : cell->getResults()) {
+    bool isOutput = cellInterface.direction(port) == Direction::Output;
+    for (auto *user : port.getUsers()) {
+      auto *groupOp = user->getParentOp();
+      if (!isa<GroupOp, StaticGroupOp>(groupOp))
+        return false;
+      auto groupName = SymbolTable::getSymbolName(groupOp);
+      if (!enables.contains(groupName))
+        return false;
+      (isOutput ? readingGroups : drivingGroups).insert(groupName);
+    }
+  }
+  if (!llvm::set_is_subset(readingGroups, drivingGroups))
+    return false;
+  groups.append(drivingGroups.begin(), drivingGroups.end());
+  return true;
+}
+
+/// Check whether any group of the first set may run at the same time as any
+/// group of the second set.
+bool ResourceSharingPass::mayConflict(ArrayRef<StringAttr> groupsA,
+                                      ArrayRef<StringAttr> groupsB) {
+  for (auto groupA : groupsA) {
+    for (auto groupB : groupsB) {
+      if (groupA == groupB)
+        return true;
+      for (auto &pathA : enables[groupA])
+        for (auto &pathB : enables[groupB])
+          if (mayRunConcurrently(pathA, pathB))
+            return true;
+    }
+  }
+  return false;
+}
+
+void ResourceSharingPass::runOnOperation() {
+  auto component = getOperation();
+  enables.clear();
+  component.getControlOp().walk([&](EnableOp op) {
+    enables[op.getGroupNameAttr().getAttr()].push_back(getControlPath(op));
+  });
+
+  // Greedily merge each cell into the first compatible shared cell, in the
+  // order in which the cells are defined.
+  SmallVector<SharedCell> sharedCells;
+  for (auto &op : llvm::make_early_inc_range(*component.getBodyBlock())) {
+    if (!isa<MultPipeLibOp, DivUPipeLibOp, DivSPipeLibOp, RemUPipeLibOp,
+             RemSPipeLibOp>(op))
+      continue;
+    SmallVector<StringAttr> groups;
+    if (!getUserGroups(&op, groups))
+      continue;
+
+    auto *it = llvm::find_if(sharedCells, [&](auto &shared) {
+      return shared.cell->getName() == op.getName() &&
+             shared.cell->getResultTypes() == op.getResultTypes() &&
+             !mayConflict(shared.groups, groups);
+    });
+    if (it == sharedCells.end()) {
+      sharedCells.push_back({&op, std::move(groups)});
+      continue;
+    }
+
+    op.replaceAllUsesWith(it->cell->getResults());
+    op.erase();
+    it->groups.append(groups.begin(), groups.end());
+    ++numCellsShared;
+  }
+}
+
+std::unique_ptr<mlir::Pass> circt::calyx::createResourceSharingPass() {
+  return std::make_unique<ResourceSharingPass>();
+}
@@ -0,0 +1,203 @@
+//===- DCStaticSchedule.cpp - Static schedule extraction pass ---*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Contains the definitions of the static schedule extraction pass, which
+// removes the handshakes between tokens whose relative timing is static and
+// reports the latency of the static schedules and the area saved.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/DC/DCOps.h"
+#include "circt/Dialect/DC/DCPasses.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/TypeSwitch.h"
+
+namespace circt {
+namespace dc {
+#define GEN_PASS_DEF_DCSTATICSCHEDULE
+#include "circt/Dialect/DC/DCPasses.h.inc"
+} // namespace dc
+} // namespace circt
+
+using namespace circt;
+using namespace dc;
+using namespace mlir;
+
+/// Check whether a buffer delays the tokens passing through it by a fixed
+/// number of cycles. Initial values shift the token stream, so buffers with
+/// initial values do not.
+static bool isStaticBuffer(BufferOp op) {
+  return isa<TokenType>(op.getType()) && !op.getInitValues();
+}
+
+/// Estimate the area of a join in gate equivalents. Its output valid is an AND
+/// tree over the input valids, and each input ready needs another gate.
+static uint64_t getJoinArea(unsigned numInputs) { return 2 * numInputs - 1; }
+
+/// Estimate the area of a token buffer slot in gate equivalents: a valid
+/// flip-flop of about four gate equivalents, plus its handshake logic.
+static constexpr uint64_t bufferSlotArea = 6;
+
+namespace {
+/// The static timing of a token: the token it is derived from through
+/// statically scheduled operations only, and the number of cycles it trails
+/// that token by.
+struct StaticTiming {
+  Value root;
+  uint64_t latency = 0;
+};
+
+/// The handshakes removed from the tokens derived from a common root.
+struct StaticRegion {
+  /// The location of the first handshake removed, where the region is
+  /// reported.
+  Location loc;
+  /// The estimated area of the removed handshake logic in gate equivalents.
+  uint64_t areaSaved = 0;
+};
+
+struct DCStaticSchedulePass
+    : public circt::dc::impl::DCStaticScheduleBase<DCStaticSchedulePass> {
+  void runOnOperation() override {
+    getOperation()->walk([&](Block *block) { runOnBlock(*block); });
+  }
+
+  void runOnBlock(Block &block);
+  StaticTiming getTiming(Value token) const;
+  void setTiming(Value token, StaticTiming tokenTiming);
+  StaticRegion &getRegion(Value root, Location loc);
+  void removeJoin(JoinOp op);
+  void removeSunkBuffers(Block &block);
+
+private:
+  DenseMap<Value, StaticTiming> timing;
+  /// The latest any token derived from a root trails it by.
+  DenseMap<Value, uint64_t> rootLatency;
+  llvm::MapVector<Value, StaticRegion> regions;
+};
+} // namespace
+
+/// Get the timing of a token. Tokens that have not been derived from another
+/// one are their own root.
+StaticTiming DCStaticSchedulePass::getTiming(Value token) const {
+  auto it = timing.find(token);
+  if (it != timing.end())
+    return it->second;
+  return {token, 0};
+}
+
+void DCStaticSchedulePass::setTiming(Value token, StaticTiming tokenTiming) {
+  timing[token] = tokenTiming;
+  auto &latency = rootLatency[tokenTiming.root];
+  latency = std::max(latency, tokenTiming.latency);
+}
+
+/// Get the region of tokens derived from a root, starting it at the given
+/// location if no handshake has been removed from it yet.
+StaticRegion &DCStaticSchedulePass::getRegion(Value root, Location loc) {
+  return regions.try_emplace(root, StaticRegion{loc}).first->second;
+}
+
+void DCStaticSchedulePass::runOnBlock(Block &block) {
+  // Propagate the timing through the block in order. Operands defined further
+  // down the block are part of a cycle and treated as roots, which is
+  // conservative: their users never share a root with anything else.
+  timing.clear();
+  rootLatency.clear();
+  regions.clear();
+  SmallVector<JoinOp> staticJoins;
+  for (auto &op : block) {
+    TypeSwitch<Operation *>(&op)
+        .Case<ForkOp>([&](auto forkOp) {
+          auto inputTiming = getTiming(forkOp.getToken());
+          for (auto output : forkOp.getOutputs())
+            setTiming(output, inputTiming);
+        })
+        .Case<BufferOp>([&](auto bufferOp) {
+          if (!isStaticBuffer(bufferOp))
+            return;
+          auto inputTiming = getTiming(bufferOp.getInput());
+          inputTiming.latency += bufferOp.getSize();
+          setTiming(bufferOp.getOutput(), inputTiming);
+        })
+        .Case<JoinOp>([&](auto joinOp) {
+          auto tokens = joinOp.getTokens();
+          auto joinTiming = getTiming(tokens.front());
+          for (auto token : tokens.drop_front()) {
+            auto inputTiming = getTiming(token);
+            if (inputTiming.root != joinTiming.root)
+              return;
+            joinTiming.latency =
+                std::max(joinTiming.latency, inputTiming.latency);
+          }
+          setTiming(joinOp.getOutput(), joinTiming);
+          if (tokens.size() > 1)
+            staticJoins.push_back(joinOp);
+        });
+  }
+
+  for (auto joinOp : staticJoins)
+    removeJoin(joinOp);
+  removeSunkBuffers(block);
+
+  for (auto &[root, region] : regions) {
+    mlir::emitRemark(region.loc)
+        << "removed the handshakes of a static schedule of "
+        << rootLatency.lookup(root) << " cycles, saving an estimated "
+        << region.areaSaved << " gate equivalents";
+    estimatedAreaSaved += region.areaSaved;
+  }
+}
+
+/// Replace a join of tokens with a common root by its latest input. All inputs
+/// carry the same token stream, so the join fires exactly when the latest one
+/// arrives and the other inputs only need to be consumed.
+void DCStaticSchedulePass::removeJoin(JoinOp op) {
+  Value latest;
+  uint64_t latestLatency = 0;
+  for (auto token : op.getTokens()) {
+    auto latency = getTiming(token).latency;
+    if (!latest || latency > latestLatency) {
+      latest = token;
+      latestLatency = latency;
+    }
+  }
+
+  auto &region = getRegion(getTiming(latest).root, op.getLoc());
+  region.areaSaved += getJoinArea(op.getTokens().size());
+
+  OpBuilder builder(op);
+  for (auto token : op.getTokens())
+    if (token != latest)
+      builder.create<SinkOp>(op.getLoc(), token);
+  op.getOutput().replaceAllUsesWith(latest);
+  op.erase();
+}
+
+/// Remove the static buffers whose only user is a sink. A sink always accepts
+/// its input, so such a buffer never holds a token that matters.
+void DCStaticSchedulePass::removeSunkBuffers(Block &block) {
+  SmallVector<SinkOp> worklist(block.getOps<SinkOp>());
+  while (!worklist.empty()) {
+    auto sinkOp = worklist.pop_back_val();
+    auto bufferOp = sinkOp.getToken().getDefiningOp<BufferOp>();
+    if (!bufferOp || !isStaticBuffer(bufferOp) || !bufferOp->hasOneUse())
+      continue;
+    auto &region =
+        getRegion(getTiming(bufferOp.getOutput()).root, bufferOp.getLoc());
+    region.areaSaved += bufferSlotArea * bufferOp.getSize();
+    sinkOp.getTokenMutable().set(bufferOp.getInput());
+    bufferOp.erase();
+    worklist.push_back(sinkOp);
+  }
+}
+
+std::unique_ptr<mlir::Pass> circt::dc::createDCStaticSchedulePass() {
+  return std::make_unique<DCStaticSchedulePass>();
+}
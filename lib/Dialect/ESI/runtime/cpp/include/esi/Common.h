@@ -19,6 +19,7 @@
 #include <any>
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <optional>
 #include <stdexcept>
 #include <string>
@@ -97,31 +98,38 @@ struct HWClientDetail {
 using HWClientDetails = std::vector<HWClientDetail>;
 using ServiceImplDetails = std::map<std::string, std::any>;
 
-/// A logical chunk of data representing serialized data. Currently, just a
-/// wrapper for a vector of bytes, which is not efficient in terms of memory
-/// copying. This will change in the future as will the API.
+/// A logical chunk of data representing serialized data. Either owns a vector
+/// of bytes, or references bytes owned by someone else (e.g. a pooled host
+/// memory buffer) without copying them.
 class MessageData {
 public:
   /// Adopts the data vector buffer.
   MessageData() = default;
   MessageData(std::vector<uint8_t> &data) : data(std::move(data)) {}
   MessageData(const uint8_t *data, size_t size) : data(data, data + size) {}
+  /// References `size` bytes at `bytes`. The `owner` keeps the bytes alive for
+  /// as long as this message or any copy of it exists. Copies share the bytes.
+  MessageData(std::shared_ptr<const void> owner, const uint8_t *bytes,
+              size_t size)
+      : owner(std::move(owner)), ref(bytes), refSize(size) {}
   ~MessageData() = default;
 
-  const uint8_t *getBytes() const { return data.data(); }
+  const uint8_t *getBytes() const { return owner ? ref : data.data(); }
   /// Get the size of the data in bytes.
-  size_t getSize() const { return data.size(); }
+  size_t getSize() const { return owner ? refSize : data.size(); }
+  /// Check whether the message references bytes it does not own.
+  bool isReference() const { return owner != nullptr; }
 
   /// Cast to a type. Throws if the size of the data does not match the size of
   /// the message. The lifetime of the resulting pointer is tied to the lifetime
   /// of this object.
   template <typename T>
   const T *as() const {
-    if (data.size() != sizeof(T))
+    if (getSize() != sizeof(T))
       throw std::runtime_error("Data size does not match type size. Size is " +
-                               std::to_string(data.size()) + ", expected " +
+                               std::to_string(getSize()) + ", expected " +
                                std::to_string(sizeof(T)) + ".");
-    return reinterpret_cast<const T *>(data.data());
+    return reinterpret_cast<const T *>(getBytes());
   }
 
   /// Cast from a type to its raw bytes.
@@ -135,6 +143,9 @@ public:
 
 private:
   std::vector<uint8_t> data;
+  std::shared_ptr<const void> owner;
+  const uint8_t *ref = nullptr;
+  size_t refSize = 0;
 };
 
 } // namespace esi
@@ -20,11 +20,73 @@
 #include "esi/Types.h"
 #include "esi/Utils.h"
 
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
 #include <future>
+#include <iosfwd>
+#include <variant>
 
 namespace esi {
 
+/// Traffic statistics of a channel. Ports update them with relaxed atomic
+/// operations, so they are cheap to maintain and can be read from any thread at
+/// any time.
+class ChannelTelemetry {
+public:
+  /// Latencies are recorded in power-of-two buckets: bucket 0 counts those
+  /// below 1us, bucket i those in [2^(i-1), 2^i) us, and the last bucket all
+  /// longer ones.
+  static constexpr size_t NumLatencyBuckets = 24;
+
+  /// A copy of the statistics at one point in time.
+  struct Snapshot {
+    /// Messages and bytes transferred.
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    /// Messages which could not be transferred right away: failed `tryWrite`
+    /// calls, or deliveries refused by a read callback or a full read queue.
+    /// A refused message counts once, however often its delivery is retried.
+    uint64_t rejected = 0;
+    /// Calls to `poll` which did not transfer anything, on channels which
+    /// need polling.
+    uint64_t pollMisses = 0;
+    /// Current and peak number of messages waiting to be read. Only tracked in
+    /// polling mode.
+    uint64_t queueDepth = 0;
+    uint64_t maxQueueDepth = 0;
+    /// For read channels, the time messages waited to be read. For write
+    /// channels, the time spent in blocking writes.
+    std::array<uint64_t, NumLatencyBuckets> latency = {};
+  };
+
+  Snapshot getSnapshot() const;
+  void reset();
+
+  void recordMessage(size_t size) {
+    messages.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+  void recordRejected() { rejected.fetch_add(1, std::memory_order_relaxed); }
+  void recordPollMiss() { pollMisses.fetch_add(1, std::memory_order_relaxed); }
+  void recordQueueDepth(size_t depth);
+  void recordLatency(std::chrono::steady_clock::duration latency);
+
+private:
+  std::atomic<uint64_t> messages = 0;
+  std::atomic<uint64_t> bytes = 0;
+  std::atomic<uint64_t> rejected = 0;
+  std::atomic<uint64_t> pollMisses = 0;
+  std::atomic<uint64_t> queueDepth = 0;
+  std::atomic<uint64_t> maxQueueDepth = 0;
+  std::array<std::atomic<uint64_t>, NumLatencyBuckets> latency = {};
+};
+
 /// Unidirectional channels are the basic communication primitive between the
 /// host and accelerator. A 'ChannelPort' is the host side of a channel. It can
 /// be either read or write but not both. At this level, channels are untyped --
@@ -51,19 +113,31 @@ public:
   /// this on each port occasionally. This is also called from the 'master' poll
   /// method in the Accelerator class.
   bool poll() {
-    if (isConnected())
-      return pollImpl();
+    if (!isConnected())
+      return false;
+    if (pollImpl())
+      return true;
+    if (needsPolling())
+      telemetry.recordPollMiss();
     return false;
   }
 
   const Type *getType() const { return type; }
 
+  /// Get the traffic statistics of this channel.
+  const ChannelTelemetry &getTelemetry() const { return telemetry; }
+  ChannelTelemetry &getTelemetry() { return telemetry; }
+
 protected:
   const Type *type;
+  ChannelTelemetry telemetry;
 
   /// Method called by poll() to actually poll the channel if the channel is
   /// connected.
   virtual bool pollImpl() { return false; }
+  /// Whether pollImpl() moves the data of this channel. Only such channels
+  /// count poll misses.
+  virtual bool needsPolling() const { return false; }
 
   /// Called by all connect methods to let backends initiate the underlying
   /// connections.
@@ -85,17 +159,74 @@ public:
 
   /// A very basic blocking write API. Will likely change for performance
   /// reasons.
-  virtual void write(const MessageData &) = 0;
+  void write(const MessageData &data) {
+    auto start = std::chrono::steady_clock::now();
+    writeImpl(data);
+    telemetry.recordLatency(std::chrono::steady_clock::now() - start);
+    telemetry.recordMessage(data.getSize());
+  }
 
   /// A basic non-blocking write API. Returns true if the data was written.
   /// It is invalid for backends to always return false (i.e. backends must
   /// eventually ensure that writes may succeed).
-  virtual bool tryWrite(const MessageData &data) = 0;
+  bool tryWrite(const MessageData &data) {
+    if (!tryWriteImpl(data)) {
+      telemetry.recordRejected();
+      return false;
+    }
+    telemetry.recordMessage(data.getSize());
+    return true;
+  }
+
+protected:
+  /// Methods called by write() and tryWrite() to actually send the data.
+  virtual void writeImpl(const MessageData &) = 0;
+  virtual bool tryWriteImpl(const MessageData &data) = 0;
 
 private:
   volatile bool connected = false;
 };
 
+class ReadChannelPort;
+
+/// Collects the messages received on any number of read channels so that a
+/// single thread can service all of them. Channels deliver into the queue from
+/// whichever thread receives their data. The servicing thread drains the queue
+/// in batches, without any per-message allocation or waiting.
+class CompletionQueue {
+public:
+  /// A message received on a channel.
+  struct Completion {
+    ReadChannelPort *port;
+    MessageData data;
+  };
+
+  /// Hold at most `maxCompletions` messages. Channels retry delivery while the
+  /// queue is full. 0 means no limit.
+  CompletionQueue(size_t maxCompletions = 0) : maxCompletions(maxCompletions) {}
+
+  /// Move up to `maxBatch` queued completions to the end of `out` without
+  /// blocking. Returns the number of completions moved.
+  size_t poll(std::vector<Completion> &out, size_t maxBatch = SIZE_MAX);
+
+  /// Like `poll`, but first wait until at least one completion is queued or the
+  /// timeout expires. Waits indefinitely if no timeout is given.
+  size_t wait(std::vector<Completion> &out,
+              std::optional<std::chrono::microseconds> timeout = std::nullopt,
+              size_t maxBatch = SIZE_MAX);
+
+  /// Queue a message received on a channel. Returns false if the queue is full.
+  bool push(ReadChannelPort *port, MessageData data);
+
+private:
+  size_t popBatch(std::vector<Completion> &out, size_t maxBatch);
+
+  std::mutex m;
+  std::condition_variable cv;
+  std::deque<Completion> completions;
+  size_t maxCompletions;
+};
+
 /// A ChannelPort which reads data from the accelerator. It has two modes:
 /// Callback and Polling which cannot be used at the same time. The mode is set
 /// at connect() time. To change the mode, disconnect() and then connect()
@@ -105,7 +236,10 @@ class ReadChannelPort : public ChannelPort {
 public:
   ReadChannelPort(const Type *type)
       : ChannelPort(type), mode(Mode::Disconnected) {}
-  virtual void disconnect() override { mode = Mode::Disconnected; }
+  virtual ~ReadChannelPort();
+  /// Disconnect the channel. Outstanding reads fail: futures hold and awaiters
+  /// throw a `std::runtime_error`.
+  virtual void disconnect() override;
   virtual bool isConnected() const override {
     return mode != Mode::Disconnected;
   }
@@ -124,6 +258,11 @@ public:
   virtual void connect(std::function<bool(MessageData)> callback,
                        std::optional<unsigned> bufferSize = std::nullopt);
 
+  /// Connect in callback mode, delivering all incoming data into a completion
+  /// queue which may be shared with other channels.
+  void connect(CompletionQueue &queue,
+               std::optional<unsigned> bufferSize = std::nullopt);
+
   //===--------------------------------------------------------------------===//
   // Polling mode methods: To use futures or blocking reads, connect without any
   // arguments. You will then be able to use readAsync() or read().
@@ -147,6 +286,36 @@ public:
     outData = std::move(f.get());
   }
 
+  /// Awaitable for reading a message from a coroutine. Obtained through
+  /// `awaitRead()`.
+  class ReadAwaiter {
+  public:
+    bool await_ready() const { return false; }
+    bool await_suspend(std::coroutine_handle<> handle);
+    MessageData await_resume() {
+      if (error)
+        std::rethrow_exception(error);
+      return std::move(data);
+    }
+
+  private:
+    friend class ReadChannelPort;
+    ReadAwaiter(ReadChannelPort &port) : port(port) {}
+
+    ReadChannelPort &port;
+    std::coroutine_handle<> handle;
+    MessageData data;
+    /// Set instead of `data` if the read failed.
+    std::exception_ptr error;
+  };
+
+  /// Asynchronous read for coroutines: `MessageData msg = co_await
+  /// port.awaitRead();`. If no data is available, the coroutine is suspended
+  /// and later resumed on the thread which delivers the data, usually the one
+  /// calling `poll()`. Reads are served in the order they were issued, whether
+  /// through futures or awaiters.
+  ReadAwaiter awaitRead();
+
   /// Set maximum number of messages to store in the dataQueue. 0 means no
   /// limit. This is only used in polling mode and is set to default of 32 upon
   /// connect. While it may seem redundant to have this and bufferSize, there
@@ -163,19 +332,40 @@ protected:
   /// Backends call this callback when new data is available.
   std::function<bool(MessageData)> callback;
 
+  /// Whether the last delivery to the callback was refused. Backends retry
+  /// refused messages until they are accepted, so only the first refusal of
+  /// each message is counted as a rejection.
+  std::atomic<bool> refused = false;
+  void recordRefused() {
+    if (!refused.exchange(true, std::memory_order_relaxed))
+      telemetry.recordRejected();
+  }
+  void recordAccepted(size_t size) {
+    refused.store(false, std::memory_order_relaxed);
+    telemetry.recordMessage(size);
+  }
+
   //===--------------------------------------------------------------------===//
   // Polling mode members.
   //===--------------------------------------------------------------------===//
 
   /// Mutex to protect the two queues used for polling.
   std::mutex pollingM;
-  /// Store incoming data here if there are no outstanding promises to be
-  /// fulfilled.
-  std::queue<MessageData> dataQueue;
+  /// Store incoming data here, along with its arrival time, if there are no
+  /// outstanding reads to be fulfilled.
+  std::queue<std::pair<MessageData, std::chrono::steady_clock::time_point>>
+      dataQueue;
   /// Maximum number of messages to store in dataQueue. 0 means no limit.
   uint64_t maxDataQueueMsgs;
-  /// Promises to be fulfilled when data is available.
-  std::queue<std::promise<MessageData>> promiseQueue;
+  /// Pop the oldest message from dataQueue, recording how long it waited. Must
+  /// be called with pollingM held.
+  MessageData popData();
+  /// Outstanding reads to be fulfilled when data is available, either promises
+  /// backing futures or suspended coroutines.
+  std::queue<std::variant<std::promise<MessageData>, ReadAwaiter *>>
+      readerQueue;
+  /// Fail all the outstanding reads, resuming the suspended coroutines.
+  void failPendingReads();
 };
 
 /// Services provide connections to 'bundles' -- collections of named,
@@ -231,4 +421,7 @@ private:
 
 } // namespace esi
 
+std::ostream &operator<<(std::ostream &,
+                         const esi::ChannelTelemetry::Snapshot &);
+
 #endif // ESI_PORTS_H
@@ -229,6 +229,48 @@ public:
   /// Unmap memory which was previously mapped with 'mapMemory'. Undefined
   /// behavior when called with a pointer which was not previously mapped.
   virtual void unmapMemory(void *ptr) const {}
+
+  /// A pool of equally sized host memory regions. Regions are allocated from
+  /// the service on demand and recycled once released, so steady-state
+  /// transfers neither allocate nor map memory. Buffers may outlive the pool
+  /// object, but not the accelerator connection.
+  ///
+  /// Only the host to accelerator direction avoids copies: messages built with
+  /// `getMessage` are handed to write channels without copying their bytes
+  /// into the message. Backends still copy the messages they receive (e.g.
+  /// cosim reads and trace replay). Buffers are not pinned by the pool; the
+  /// `Options` are passed to `allocate` as is, and some backends (cosim)
+  /// ignore them.
+  class BufferPool {
+  public:
+    /// Create a pool of `bufferSize` byte buffers. At most `maxBuffers` are
+    /// handed out at a time, unless it is 0.
+    BufferPool(const HostMem &hostMem, std::size_t bufferSize,
+               Options opts, std::size_t maxBuffers = 0);
+    ~BufferPool();
+
+    /// Get a buffer, allocating a new one if none is free. The buffer returns
+    /// to the pool once the last reference to it is dropped, including those
+    /// held by messages created with `getMessage`. Returns nullptr if
+    /// `maxBuffers` buffers are in use.
+    std::shared_ptr<HostMemRegion> acquire();
+
+    std::size_t getBufferSize() const;
+    /// Get the number of buffers currently handed out.
+    std::size_t getNumInUse() const;
+    /// Get the number of buffers waiting in the pool to be reused.
+    std::size_t getNumFree() const;
+
+  private:
+    struct State;
+    std::shared_ptr<State> state;
+  };
+
+  /// Create a message which references the first `size` bytes of a buffer
+  /// without copying them. The buffer is kept alive by the message and its
+  /// copies. References the whole buffer if no size is given.
+  static MessageData getMessage(std::shared_ptr<HostMemRegion> buffer,
+                                std::optional<std::size_t> size = {});
 };
 
 /// Service for calling functions.
@@ -39,10 +39,19 @@ public:
     // garbage data for reads from the accelerator.
     Write,
 
-    // Sent data to the accelerator is compared against the trace file's record.
-    // Data read from the accelerator is read from the trace file.
-    // TODO: Full trace mode not yet supported.
-    // Read
+    // Like 'Write', but record the messages on all channels in both directions
+    // to a binary trace file which can be replayed. MMIO and host memory
+    // accesses are not recorded.
+    WriteBinary,
+
+    // Data read from the accelerator is streamed from a binary trace file, with
+    // the same spacing in time as when it was recorded. Data sent to the
+    // accelerator is compared against the trace file's record; a message which
+    // differs, or is not in the trace, throws.
+    Replay,
+
+    // Like 'Replay', but stream the messages as fast as they are consumed.
+    ReplayMaxRate,
 
     // Discard all data sent to the accelerator. Disable trace file generation.
     Discard,
@@ -51,14 +60,16 @@ public:
   /// Create a trace-based accelerator backend.
   /// \param mode The mode of operation. See Mode.
   /// \param manifestJson The path to the manifest JSON file.
-  /// \param traceFile The path to the trace file. For 'Write' mode, this file
-  ///   is opened for writing. For 'Read' mode, this file is opened for reading.
+  /// \param traceFile The path to the trace file. For the write modes, this
+  ///   file is opened for writing. For the replay modes, it is memory-mapped
+  ///   for reading.
   TraceAccelerator(Context &, Mode mode, std::filesystem::path manifestJson,
                    std::filesystem::path traceFile);
   ~TraceAccelerator() override;
 
   /// Parse the connection string and instantiate the accelerator. Format is:
-  /// "<mode>:<manifest path>[:<traceFile>]".
+  /// "<mode>:<manifest path>[:<traceFile>]". The mode is one of 'w' (Write),
+  /// 'b' (WriteBinary), 'r' (Replay), 'R' (ReplayMaxRate), or '-' (Discard).
   static std::unique_ptr<AcceleratorConnection>
   connect(Context &, std::string connectionString);
 
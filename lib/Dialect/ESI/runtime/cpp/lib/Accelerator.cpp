@@ -305,13 +305,21 @@ void AcceleratorServiceThread::Impl::loop() {
     // callbacks to be called later so we can release the lock.
     {
       std::lock_guard<std::mutex> g(m);
-      for (auto &[channel, cbfPair] : listeners) {
+      for (auto it = listeners.begin(); it != listeners.end();) {
+        auto &[channel, cbfPair] = *it;
         assert(channel && "Null channel in listener list");
         std::future<MessageData> &f = cbfPair.second;
         if (f.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-          portUnlockWorkList.emplace_back(channel, cbfPair.first, f.get());
-          f = channel->readAsync();
+          try {
+            portUnlockWorkList.emplace_back(channel, cbfPair.first, f.get());
+            f = channel->readAsync();
+          } catch (const std::runtime_error &) {
+            // The channel was disconnected, so stop listening to it.
+            it = listeners.erase(it);
+            continue;
+          }
         }
+        ++it;
       }
     }
 
@@ -22,14 +22,15 @@ using namespace esi;
 std::string MessageData::toHex() const {
   std::ostringstream ss;
   ss << std::hex;
-  for (size_t i = 0, e = data.size(); i != e; ++i) {
+  const uint8_t *bytes = getBytes();
+  for (size_t i = 0, e = getSize(); i != e; ++i) {
     // Add spaces every 8 bytes.
     if (i % 8 == 0 && i != 0)
       ss << ' ';
     // Add an extra space every 64 bytes.
     if (i % 64 == 0 && i != 0)
       ss << ' ';
-    ss << static_cast<unsigned>(data[i]);
+    ss << static_cast<unsigned>(bytes[i]);
   }
   return ss.str();
 }
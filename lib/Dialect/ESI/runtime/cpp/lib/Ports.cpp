@@ -14,7 +14,9 @@
 
 #include "esi/Ports.h"
 
+#include <bit>
 #include <chrono>
+#include <iostream>
 #include <stdexcept>
 
 using namespace esi;
@@ -41,33 +43,199 @@ ReadChannelPort &BundlePort::getRawRead(const std::string &name) const {
     throw std::runtime_error("Channel '" + name + "' is not a read channel");
   return *read;
 }
+
+ChannelTelemetry::Snapshot ChannelTelemetry::getSnapshot() const {
+  Snapshot snapshot;
+  snapshot.messages = messages.load(std::memory_order_relaxed);
+  snapshot.bytes = bytes.load(std::memory_order_relaxed);
+  snapshot.rejected = rejected.load(std::memory_order_relaxed);
+  snapshot.pollMisses = pollMisses.load(std::memory_order_relaxed);
+  snapshot.queueDepth = queueDepth.load(std::memory_order_relaxed);
+  snapshot.maxQueueDepth = maxQueueDepth.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < NumLatencyBuckets; ++i)
+    snapshot.latency[i] = latency[i].load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+void ChannelTelemetry::reset() {
+  messages.store(0, std::memory_order_relaxed);
+  bytes.store(0, std::memory_order_relaxed);
+  rejected.store(0, std::memory_order_relaxed);
+  pollMisses.store(0, std::memory_order_relaxed);
+  // The current queue depth is state, not a statistic, so it survives a reset.
+  maxQueueDepth.store(queueDepth.load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+  for (auto &bucket : latency)
+    bucket.store(0, std::memory_order_relaxed);
+}
+
+void ChannelTelemetry::recordQueueDepth(size_t depth) {
+  queueDepth.store(depth, std::memory_order_relaxed);
+  uint64_t max = maxQueueDepth.load(std::memory_order_relaxed);
+  while (depth > max && !maxQueueDepth.compare_exchange_weak(
+                            max, depth, std::memory_order_relaxed))
+    ;
+}
+
+void ChannelTelemetry::recordLatency(std::chrono::steady_clock::duration d) {
+  auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+  size_t bucket = us <= 0 ? 0 : std::bit_width(static_cast<uint64_t>(us));
+  bucket = std::min(bucket, NumLatencyBuckets - 1);
+  latency[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::ostream &operator<<(std::ostream &os,
+                         const ChannelTelemetry::Snapshot &snapshot) {
+  os << "messages: " << snapshot.messages << ", bytes: " << snapshot.bytes
+     << ", rejected: " << snapshot.rejected
+     << ", poll misses: " << snapshot.pollMisses
+     << ", queue depth: " << snapshot.queueDepth << " (max "
+     << snapshot.maxQueueDepth << ")";
+  // Print the non-empty latency buckets by their upper bound.
+  bool first = true;
+  for (size_t i = 0; i < ChannelTelemetry::NumLatencyBuckets; ++i) {
+    if (snapshot.latency[i] == 0)
+      continue;
+    os << (first ? ", latency: " : " ");
+    first = false;
+    if (i == ChannelTelemetry::NumLatencyBuckets - 1)
+      os << ">=" << (1ull << (i - 1)) << "us";
+    else
+      os << "<" << (1ull << i) << "us";
+    os << ":" << snapshot.latency[i];
+  }
+  return os;
+}
+
+size_t CompletionQueue::popBatch(std::vector<Completion> &out,
+                                 size_t maxBatch) {
+  size_t n = std::min(maxBatch, completions.size());
+  for (size_t i = 0; i < n; ++i) {
+    out.push_back(std::move(completions.front()));
+    completions.pop_front();
+  }
+  return n;
+}
+
+size_t CompletionQueue::poll(std::vector<Completion> &out, size_t maxBatch) {
+  std::scoped_lock<std::mutex> lock(m);
+  return popBatch(out, maxBatch);
+}
+
+size_t CompletionQueue::wait(std::vector<Completion> &out,
+                             std::optional<std::chrono::microseconds> timeout,
+                             size_t maxBatch) {
+  std::unique_lock<std::mutex> lock(m);
+  auto ready = [this]() { return !completions.empty(); };
+  if (timeout)
+    cv.wait_for(lock, *timeout, ready);
+  else
+    cv.wait(lock, ready);
+  return popBatch(out, maxBatch);
+}
+
+bool CompletionQueue::push(ReadChannelPort *port, MessageData data) {
+  {
+    std::scoped_lock<std::mutex> lock(m);
+    if (maxCompletions != 0 && completions.size() >= maxCompletions)
+      return false;
+    completions.push_back({port, std::move(data)});
+  }
+  cv.notify_one();
+  return true;
+}
+
+ReadChannelPort::~ReadChannelPort() { failPendingReads(); }
+
+void ReadChannelPort::disconnect() {
+  mode = Mode::Disconnected;
+  failPendingReads();
+}
+
+void ReadChannelPort::failPendingReads() {
+  decltype(readerQueue) readers;
+  {
+    std::scoped_lock<std::mutex> lock(pollingM);
+    std::swap(readers, readerQueue);
+  }
+  if (readers.empty())
+    return;
+
+  // Resume the coroutines outside the lock, since they may well issue another
+  // read (which throws, as the channel is now disconnected).
+  std::exception_ptr error =
+      std::make_exception_ptr(std::runtime_error("Channel disconnected"));
+  for (; !readers.empty(); readers.pop()) {
+    auto &reader = readers.front();
+    if (auto *p = std::get_if<std::promise<MessageData>>(&reader)) {
+      p->set_exception(error);
+    } else {
+      ReadAwaiter *awaiter = std::get<ReadAwaiter *>(reader);
+      awaiter->error = error;
+      awaiter->handle.resume();
+    }
+  }
+}
+
 void ReadChannelPort::connect(std::function<bool(MessageData)> callback,
                               std::optional<unsigned> bufferSize) {
   if (mode != Mode::Disconnected)
     throw std::runtime_error("Channel already connected");
   mode = Mode::Callback;
-  this->callback = callback;
+  this->callback = [this, callback](MessageData data) {
+    size_t size = data.getSize();
+    if (!callback(std::move(data))) {
+      recordRefused();
+      return false;
+    }
+    recordAccepted(size);
+    return true;
+  };
   connectImpl(bufferSize);
 }
 
+void ReadChannelPort::connect(CompletionQueue &queue,
+                              std::optional<unsigned> bufferSize) {
+  connect(
+      [this, &queue](MessageData data) {
+        return queue.push(this, std::move(data));
+      },
+      bufferSize);
+}
+
 void ReadChannelPort::connect(std::optional<unsigned> bufferSize) {
   mode = Mode::Polling;
   maxDataQueueMsgs = DefaultMaxDataQueueMsgs;
   this->callback = [this](MessageData data) {
-    std::scoped_lock<std::mutex> lock(pollingM);
-    assert(!(!promiseQueue.empty() && !dataQueue.empty()) &&
+    std::unique_lock<std::mutex> lock(pollingM);
+    assert(!(!readerQueue.empty() && !dataQueue.empty()) &&
            "Both queues are in use.");
 
-    if (!promiseQueue.empty()) {
-      // If there are promises waiting, fulfill the first one.
-      std::promise<MessageData> p = std::move(promiseQueue.front());
-      promiseQueue.pop();
-      p.set_value(std::move(data));
+    if (!readerQueue.empty()) {
+      recordAccepted(data.getSize());
+      telemetry.recordLatency({});
+      // If there are reads waiting, fulfill the first one.
+      auto reader = std::move(readerQueue.front());
+      readerQueue.pop();
+      if (auto *p = std::get_if<std::promise<MessageData>>(&reader)) {
+        p->set_value(std::move(data));
+      } else {
+        // Resume the coroutine outside the lock, since it may well issue the
+        // next read right away.
+        ReadAwaiter *awaiter = std::get<ReadAwaiter *>(reader);
+        awaiter->data = std::move(data);
+        lock.unlock();
+        awaiter->handle.resume();
+      }
     } else {
       // If not, add it to the data queue, unless the queue is full.
-      if (dataQueue.size() >= maxDataQueueMsgs && maxDataQueueMsgs != 0)
+      if (dataQueue.size() >= maxDataQueueMsgs && maxDataQueueMsgs != 0) {
+        recordRefused();
         return false;
-      dataQueue.push(std::move(data));
+      }
+      recordAccepted(data.getSize());
+      dataQueue.emplace(std::move(data), std::chrono::steady_clock::now());
+      telemetry.recordQueueDepth(dataQueue.size());
     }
     return true;
   };
@@ -79,21 +247,57 @@ std::future<MessageData> ReadChannelPort::readAsync() {
     throw std::runtime_error(
         "Cannot read from a callback channel. `connect()` without a callback "
         "specified to use polling mode.");
+  if (mode == Mode::Disconnected)
+    throw std::runtime_error("Cannot read from a disconnected channel.");
 
   std::scoped_lock<std::mutex> lock(pollingM);
-  assert(!(!promiseQueue.empty() && !dataQueue.empty()) &&
+  assert(!(!readerQueue.empty() && !dataQueue.empty()) &&
          "Both queues are in use.");
 
   if (!dataQueue.empty()) {
     // If there's data available, fulfill the promise immediately.
     std::promise<MessageData> p;
     std::future<MessageData> f = p.get_future();
-    p.set_value(std::move(dataQueue.front()));
-    dataQueue.pop();
+    p.set_value(popData());
     return f;
   } else {
     // Otherwise, add a promise to the queue and return the future.
-    promiseQueue.emplace();
-    return promiseQueue.back().get_future();
+    auto &reader = readerQueue.emplace(std::promise<MessageData>());
+    return std::get<std::promise<MessageData>>(reader).get_future();
   }
 }
+
+ReadChannelPort::ReadAwaiter ReadChannelPort::awaitRead() {
+  if (mode == Mode::Callback)
+    throw std::runtime_error(
+        "Cannot read from a callback channel. `connect()` without a callback "
+        "specified to use polling mode.");
+  if (mode == Mode::Disconnected)
+    throw std::runtime_error("Cannot read from a disconnected channel.");
+  return ReadAwaiter(*this);
+}
+
+bool ReadChannelPort::ReadAwaiter::await_suspend(
+    std::coroutine_handle<> handle) {
+  std::scoped_lock<std::mutex> lock(port.pollingM);
+  assert(!(!port.readerQueue.empty() && !port.dataQueue.empty()) &&
+         "Both queues are in use.");
+
+  // If there's data available, continue without suspending.
+  if (!port.dataQueue.empty()) {
+    data = port.popData();
+    return false;
+  }
+  // Otherwise, wait for the callback to resume us.
+  this->handle = handle;
+  port.readerQueue.emplace(this);
+  return true;
+}
+
+MessageData ReadChannelPort::popData() {
+  auto [data, arrival] = std::move(dataQueue.front());
+  dataQueue.pop();
+  telemetry.recordQueueDepth(dataQueue.size());
+  telemetry.recordLatency(std::chrono::steady_clock::now() - arrival);
+  return std::move(data);
+}
@@ -165,6 +165,88 @@ std::vector<uint8_t> MMIOSysInfo::getCompressedManifest() const {
 
 std::string HostMem::getServiceSymbol() const { return "__builtin_HostMem"; }
 
+struct HostMem::BufferPool::State {
+  State(const HostMem &hostMem, std::size_t bufferSize, Options opts,
+        std::size_t maxBuffers)
+      : hostMem(hostMem), bufferSize(bufferSize), opts(opts),
+        maxBuffers(maxBuffers) {}
+
+  void release(HostMemRegion *region) {
+    std::scoped_lock<std::mutex> lock(m);
+    free.emplace_back(region);
+    --numInUse;
+  }
+
+  const HostMem &hostMem;
+  const std::size_t bufferSize;
+  const Options opts;
+  const std::size_t maxBuffers;
+
+  mutable std::mutex m;
+  std::vector<std::unique_ptr<HostMemRegion>> free;
+  std::size_t numInUse = 0;
+};
+
+HostMem::BufferPool::BufferPool(const HostMem &hostMem, std::size_t bufferSize,
+                                Options opts, std::size_t maxBuffers)
+    : state(std::make_shared<State>(hostMem, bufferSize, opts, maxBuffers)) {}
+HostMem::BufferPool::~BufferPool() = default;
+
+std::shared_ptr<HostMem::HostMemRegion> HostMem::BufferPool::acquire() {
+  std::unique_ptr<HostMemRegion> region;
+  {
+    std::scoped_lock<std::mutex> lock(state->m);
+    if (!state->free.empty()) {
+      region = std::move(state->free.back());
+      state->free.pop_back();
+    } else if (state->maxBuffers != 0 &&
+               state->numInUse >= state->maxBuffers) {
+      return nullptr;
+    }
+    ++state->numInUse;
+  }
+  if (!region) {
+    try {
+      region = state->hostMem.allocate(state->bufferSize, state->opts);
+    } catch (...) {
+      std::scoped_lock<std::mutex> lock(state->m);
+      --state->numInUse;
+      throw;
+    }
+  }
+
+  // The deleter holds on to the pool state so that buffers may outlive the
+  // pool object.
+  return std::shared_ptr<HostMemRegion>(
+      region.release(),
+      [state = state](HostMemRegion *region) { state->release(region); });
+}
+
+std::size_t HostMem::BufferPool::getBufferSize() const {
+  return state->bufferSize;
+}
+
+std::size_t HostMem::BufferPool::getNumInUse() const {
+  std::scoped_lock<std::mutex> lock(state->m);
+  return state->numInUse;
+}
+
+std::size_t HostMem::BufferPool::getNumFree() const {
+  std::scoped_lock<std::mutex> lock(state->m);
+  return state->free.size();
+}
+
+MessageData HostMem::getMessage(std::shared_ptr<HostMemRegion> buffer,
+                                std::optional<std::size_t> size) {
+  std::size_t bufferSize = buffer->getSize();
+  if (size && *size > bufferSize)
+    throw std::runtime_error("message size " + std::to_string(*size) +
+                             " exceeds buffer size " +
+                             std::to_string(bufferSize));
+  const auto *bytes = static_cast<const uint8_t *>(buffer->getPtr());
+  return MessageData(std::move(buffer), bytes, size.value_or(bufferSize));
+}
+
 CustomService::CustomService(AppIDPath idPath,
                              const ServiceImplDetails &details,
                              const HWClientDetails &clients)
@@ -189,7 +189,7 @@ public:
   }
 
   /// Send a write message to the server.
-  void write(const MessageData &data) override {
+  void writeImpl(const MessageData &data) override {
     ClientContext context;
     AddressedMessage msg;
     msg.set_channel_name(name);
@@ -203,8 +203,8 @@ public:
                                ". Details: " + sendStatus.error_details());
   }
 
-  bool tryWrite(const MessageData &data) override {
-    write(data);
+  bool tryWriteImpl(const MessageData &data) override {
+    writeImpl(data);
     return true;
   }
 
@@ -507,6 +507,8 @@ public:
 
   virtual std::unique_ptr<HostMemRegion>
   allocate(std::size_t size, HostMem::Options opts) const override {
+    // The simulation reads plain host memory, so there is nothing to pin and
+    // the options do not apply.
     return std::unique_ptr<HostMemRegion>(new CosimHostMemRegion(size));
   }
   virtual bool mapMemory(void *ptr, std::size_t size,
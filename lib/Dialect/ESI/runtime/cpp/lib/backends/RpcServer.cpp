@@ -123,8 +123,8 @@ public:
 class RpcServerWritePort : public WriteChannelPort {
 public:
   RpcServerWritePort(Type *type) : WriteChannelPort(type) {}
-  void write(const MessageData &data) override { writeQueue.push(data); }
-  bool tryWrite(const MessageData &data) override {
+  void writeImpl(const MessageData &data) override { writeQueue.push(data); }
+  bool tryWriteImpl(const MessageData &data) override {
     writeQueue.push(data);
     return true;
   }
@@ -19,11 +19,22 @@
 #include "esi/Utils.h"
 
 #include <cassert>
+#include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <regex>
 #include <sstream>
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#elif _WIN32
+#include <windows.h>
+#endif
+
 using namespace esi;
 using namespace esi::services;
 using namespace esi::backends::trace;
@@ -35,6 +46,322 @@ namespace {
 class TraceChannelPort;
 }
 
+//===----------------------------------------------------------------------===//
+// Binary trace format
+//===----------------------------------------------------------------------===//
+//
+// A binary trace starts with a header, followed by the records of all channels
+// in the order in which they were recorded. After the records comes the channel
+// table, with each entry followed by the channel name, and then the index: the
+// file offsets of the records of each channel. Records and names are padded to
+// a multiple of 8 bytes so that everything can be accessed in place once the
+// file is memory-mapped. All values are stored in host byte order.
+
+static constexpr char BinaryTraceMagic[8] = {'E', 'S', 'I', 'T',
+                                             'R', 'A', 'C', 'E'};
+static constexpr uint32_t BinaryTraceVersion = 1;
+
+namespace {
+struct BinaryTraceHeader {
+  /// Only written once the trace is closed, so that incomplete traces are not
+  /// mistaken for valid ones.
+  char magic[8];
+  uint32_t version;
+  uint32_t numChannels;
+  uint64_t numRecords;
+  uint64_t channelTableOffset;
+};
+
+struct BinaryTraceRecord {
+  /// Nanoseconds since the start of the trace.
+  uint64_t timestamp;
+  uint32_t channel;
+  uint32_t size;
+  // Followed by `size` bytes of message data.
+};
+
+struct BinaryTraceChannel {
+  uint64_t indexOffset;
+  uint64_t numRecords;
+  uint32_t toAccelerator;
+  uint32_t nameSize;
+  // Followed by `nameSize` bytes of channel name.
+};
+} // namespace
+
+static uint64_t alignTo8(uint64_t size) { return (size + 7) & ~uint64_t(7); }
+
+/// Get the name under which a channel is stored in a binary trace.
+static std::string getTraceChannelName(const AppIDPath &id,
+                                       const std::string &portName) {
+  return id.toStr() + "." + portName;
+}
+
+namespace {
+/// Records the messages on a set of channels into a binary trace file. The
+/// channel table and index are written when the writer is destroyed.
+class BinaryTraceWriter {
+public:
+  BinaryTraceWriter(const std::filesystem::path &traceFile);
+  ~BinaryTraceWriter();
+
+  /// Register a channel. Returns the channel number to record messages with.
+  uint32_t addChannel(std::string name, bool toAccelerator);
+  /// Append a message to the trace. Thread safe.
+  void record(uint32_t channel, const MessageData &data);
+
+private:
+  void writePadded(const void *data, size_t size);
+
+  struct Channel {
+    std::string name;
+    bool toAccelerator;
+    std::vector<uint64_t> recordOffsets;
+  };
+
+  std::mutex m;
+  std::ofstream os;
+  std::chrono::steady_clock::time_point start;
+  uint64_t offset = 0;
+  uint64_t numRecords = 0;
+  std::vector<Channel> channels;
+};
+} // namespace
+
+BinaryTraceWriter::BinaryTraceWriter(const std::filesystem::path &traceFile)
+    : os(traceFile, std::ios::binary), start(std::chrono::steady_clock::now()) {
+  if (!os.is_open())
+    throw std::runtime_error("failed to open trace file '" +
+                             traceFile.string() + "'");
+  BinaryTraceHeader header = {};
+  writePadded(&header, sizeof(header));
+}
+
+BinaryTraceWriter::~BinaryTraceWriter() {
+  BinaryTraceHeader header = {};
+  std::memcpy(header.magic, BinaryTraceMagic, sizeof(header.magic));
+  header.version = BinaryTraceVersion;
+  header.numChannels = channels.size();
+  header.numRecords = numRecords;
+  header.channelTableOffset = offset;
+
+  // The index starts right after the channel table.
+  uint64_t indexOffset = offset;
+  for (auto &channel : channels)
+    indexOffset += sizeof(BinaryTraceChannel) + alignTo8(channel.name.size());
+  for (auto &channel : channels) {
+    BinaryTraceChannel entry = {indexOffset, channel.recordOffsets.size(),
+                                channel.toAccelerator,
+                                static_cast<uint32_t>(channel.name.size())};
+    writePadded(&entry, sizeof(entry));
+    writePadded(channel.name.data(), channel.name.size());
+    indexOffset += channel.recordOffsets.size() * sizeof(uint64_t);
+  }
+  for (auto &channel : channels)
+    writePadded(channel.recordOffsets.data(),
+                channel.recordOffsets.size() * sizeof(uint64_t));
+
+  os.seekp(0);
+  os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+void BinaryTraceWriter::writePadded(const void *data, size_t size) {
+  static constexpr char zeros[8] = {};
+  uint64_t paddedSize = alignTo8(size);
+  os.write(static_cast<const char *>(data), size);
+  os.write(zeros, paddedSize - size);
+  offset += paddedSize;
+}
+
+uint32_t BinaryTraceWriter::addChannel(std::string name, bool toAccelerator) {
+  std::scoped_lock<std::mutex> lock(m);
+  channels.push_back({std::move(name), toAccelerator, {}});
+  return channels.size() - 1;
+}
+
+void BinaryTraceWriter::record(uint32_t channel, const MessageData &data) {
+  std::scoped_lock<std::mutex> lock(m);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  BinaryTraceRecord record = {
+      static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+              .count()),
+      channel, static_cast<uint32_t>(data.getSize())};
+  channels[channel].recordOffsets.push_back(offset);
+  writePadded(&record, sizeof(record));
+  writePadded(data.getBytes(), data.getSize());
+  ++numRecords;
+}
+
+namespace {
+/// A read-only memory mapping of a whole file.
+class MappedFile {
+public:
+  MappedFile(const std::filesystem::path &path);
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const uint8_t *getData() const { return data; }
+  size_t getSize() const { return size; }
+
+private:
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#endif
+};
+} // namespace
+
+MappedFile::MappedFile(const std::filesystem::path &path) {
+  size = std::filesystem::file_size(path);
+#ifdef __linux__
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("failed to open trace file '" + path.string() +
+                             "'");
+  void *ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED)
+    throw std::runtime_error("failed to map trace file '" + path.string() +
+                             "'");
+  // Replay walks through the records mostly front to back.
+  madvise(ptr, size, MADV_SEQUENTIAL);
+  data = static_cast<const uint8_t *>(ptr);
+#elif _WIN32
+  file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("failed to open trace file '" + path.string() +
+                             "'");
+  mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping)
+    data = static_cast<const uint8_t *>(
+        MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (!data) {
+    if (mapping)
+      CloseHandle(mapping);
+    CloseHandle(file);
+    throw std::runtime_error("failed to map trace file '" + path.string() +
+                             "'");
+  }
+#else
+#error "Unsupported platform"
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef __linux__
+  munmap(const_cast<uint8_t *>(data), size);
+#elif _WIN32
+  UnmapViewOfFile(data);
+  CloseHandle(mapping);
+  CloseHandle(file);
+#endif
+}
+
+namespace {
+/// Provides in-place access to the records of a memory-mapped binary trace.
+class BinaryTraceReader {
+public:
+  BinaryTraceReader(const std::filesystem::path &traceFile);
+
+  /// The records of one channel, in the order in which they were recorded.
+  struct Channel {
+    const uint64_t *recordOffsets = nullptr;
+    uint64_t numRecords = 0;
+  };
+
+  /// Get the messages recorded on a channel. Channels which are not in the
+  /// trace have no messages.
+  Channel getChannel(const std::string &name) const {
+    auto it = channels.find(name);
+    if (it == channels.end())
+      return {};
+    return it->second;
+  }
+
+  const BinaryTraceRecord &getRecord(uint64_t offset) const {
+    return *reinterpret_cast<const BinaryTraceRecord *>(file.getData() +
+                                                        offset);
+  }
+  const uint8_t *getRecordData(const BinaryTraceRecord &record) const {
+    return reinterpret_cast<const uint8_t *>(&record + 1);
+  }
+
+private:
+  MappedFile file;
+  std::map<std::string, Channel> channels;
+};
+} // namespace
+
+BinaryTraceReader::BinaryTraceReader(const std::filesystem::path &traceFile)
+    : file(traceFile) {
+  auto invalid = [&](const std::string &reason) {
+    return std::runtime_error("invalid trace file '" + traceFile.string() +
+                              "': " + reason);
+  };
+  const uint8_t *data = file.getData();
+  uint64_t size = file.getSize();
+  if (size < sizeof(BinaryTraceHeader))
+    throw invalid("truncated header");
+  auto &header = *reinterpret_cast<const BinaryTraceHeader *>(data);
+  if (std::memcmp(header.magic, BinaryTraceMagic, sizeof(header.magic)) != 0)
+    throw invalid("not a binary trace, or the trace was not closed");
+  if (header.version != BinaryTraceVersion)
+    throw invalid("unsupported version " + std::to_string(header.version));
+
+  // The records lie between the header and the channel table. All sizes are
+  // checked against the remaining space rather than by adding them to an
+  // offset, which a corrupt trace could make overflow.
+  uint64_t recordsEnd = header.channelTableOffset;
+  if (recordsEnd % 8 != 0 || recordsEnd < sizeof(BinaryTraceHeader) ||
+      recordsEnd > size)
+    throw invalid("channel table outside of the trace");
+
+  uint64_t offset = recordsEnd;
+  for (uint32_t i = 0; i < header.numChannels; ++i) {
+    if (size - offset < sizeof(BinaryTraceChannel))
+      throw invalid("truncated channel table");
+    auto &entry = *reinterpret_cast<const BinaryTraceChannel *>(data + offset);
+    offset += sizeof(BinaryTraceChannel);
+    if (size - offset < alignTo8(entry.nameSize))
+      throw invalid("truncated channel table");
+    std::string name(reinterpret_cast<const char *>(data + offset),
+                     entry.nameSize);
+    offset += alignTo8(entry.nameSize);
+    if (entry.indexOffset % 8 != 0 || entry.indexOffset > size ||
+        entry.numRecords > (size - entry.indexOffset) / sizeof(uint64_t))
+      throw invalid("truncated index of channel '" + name + "'");
+
+    // Check every record up front, such that replay can access them without
+    // further checks.
+    auto *recordOffsets =
+        reinterpret_cast<const uint64_t *>(data + entry.indexOffset);
+    for (uint64_t r = 0; r < entry.numRecords; ++r) {
+      uint64_t recordOffset = recordOffsets[r];
+      if (recordOffset % 8 != 0 || recordOffset < sizeof(BinaryTraceHeader) ||
+          recordOffset > recordsEnd ||
+          recordsEnd - recordOffset < sizeof(BinaryTraceRecord))
+        throw invalid("record " + std::to_string(r) + " of channel '" + name +
+                      "' is outside of the trace");
+      auto &record = getRecord(recordOffset);
+      if (record.channel != i ||
+          record.size >
+              recordsEnd - recordOffset - sizeof(BinaryTraceRecord))
+        throw invalid("record " + std::to_string(r) + " of channel '" + name +
+                      "' is corrupt");
+    }
+    channels[name] = {recordOffsets, entry.numRecords};
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Trace accelerator
+//===----------------------------------------------------------------------===//
+
 struct esi::backends::trace::TraceAccelerator::Impl {
   Impl(Mode mode, std::filesystem::path manifestJson,
        std::filesystem::path traceFile)
@@ -49,6 +376,12 @@ struct esi::backends::trace::TraceAccelerator::Impl {
       if (!traceWrite->is_open())
         throw std::runtime_error("failed to open trace file '" +
                                  traceFile.string() + "'");
+    } else if (mode == WriteBinary) {
+      traceBinary = std::make_unique<BinaryTraceWriter>(traceFile);
+    } else if (mode == Replay || mode == ReplayMaxRate) {
+      replay = std::make_unique<BinaryTraceReader>(traceFile);
+      if (mode == Replay)
+        replayStart = std::chrono::steady_clock::now();
     } else if (mode == Discard) {
       traceWrite = nullptr;
     } else {
@@ -84,8 +417,28 @@ struct esi::backends::trace::TraceAccelerator::Impl {
   }
   bool isWriteable() { return traceWrite; }
 
+  /// Register a channel with the binary trace, if one is being recorded.
+  /// Returns the channel number to record its messages with.
+  uint32_t addTraceChannel(const AppIDPath &id, const std::string &portName,
+                           bool toAccelerator) {
+    if (!traceBinary)
+      return 0;
+    return traceBinary->addChannel(getTraceChannelName(id, portName),
+                                   toAccelerator);
+  }
+  bool isRecording() { return traceBinary != nullptr; }
+  void record(uint32_t channel, const MessageData &data) {
+    if (traceBinary)
+      traceBinary->record(channel, data);
+  }
+
 private:
-  std::ofstream *traceWrite;
+  std::ofstream *traceWrite = nullptr;
+  std::unique_ptr<BinaryTraceWriter> traceBinary;
+  std::unique_ptr<BinaryTraceReader> replay;
+  /// The time the replay started, if messages are replayed at their recorded
+  /// rate.
+  std::optional<std::chrono::steady_clock::time_point> replayStart;
   std::filesystem::path manifestJson;
   std::filesystem::path traceFile;
   std::vector<std::unique_ptr<ChannelPort>> channels;
@@ -108,17 +461,17 @@ std::unique_ptr<AcceleratorConnection>
 TraceAccelerator::connect(Context &ctxt, std::string connectionString) {
   std::string modeStr;
   std::string manifestPath;
-  std::string traceFile = "trace.log";
+  std::string traceFile;
 
   // Parse the connection std::string.
   // <mode>:<manifest path>[:<traceFile>]
-  std::regex connPattern("([\\w-]):([^:]+)(:(\\w+))?");
+  std::regex connPattern("([\\w-]):([^:]+)(:(.+))?");
   std::smatch match;
   if (regex_search(connectionString, match, connPattern)) {
     modeStr = match[1];
     manifestPath = match[2];
     if (match[3].matched)
-      traceFile = match[3];
+      traceFile = match[4];
   } else {
     throw std::runtime_error("connection std::string must be of the form "
                              "'<mode>:<manifest path>[:<traceFile>]'");
@@ -128,11 +481,20 @@ TraceAccelerator::connect(Context &ctxt, std::string connectionString) {
   Mode mode;
   if (modeStr == "w")
     mode = Write;
+  else if (modeStr == "b")
+    mode = WriteBinary;
+  else if (modeStr == "r")
+    mode = Replay;
+  else if (modeStr == "R")
+    mode = ReplayMaxRate;
   else if (modeStr == "-")
     mode = Discard;
   else
     throw std::runtime_error("unknown mode '" + modeStr + "'");
 
+  if (traceFile.empty())
+    traceFile = mode == Write || mode == Discard ? "trace.log" : "trace.bin";
+
   return std::make_unique<TraceAccelerator>(ctxt, mode,
                                             std::filesystem::path(manifestPath),
                                             std::filesystem::path(traceFile));
@@ -187,14 +549,17 @@ class WriteTraceChannelPort : public WriteChannelPort {
 public:
   WriteTraceChannelPort(TraceAccelerator::Impl &impl, const Type *type,
                         const AppIDPath &id, const std::string &portName)
-      : WriteChannelPort(type), impl(impl), id(id), portName(portName) {}
+      : WriteChannelPort(type), impl(impl), id(id), portName(portName),
+        traceChannel(impl.addTraceChannel(id, portName, true)) {}
 
-  virtual void write(const MessageData &data) override {
+  virtual void writeImpl(const MessageData &data) override {
     impl.write(id, portName, data.getBytes(), data.getSize());
+    impl.record(traceChannel, data);
   }
 
-  bool tryWrite(const MessageData &data) override {
+  bool tryWriteImpl(const MessageData &data) override {
     impl.write(id, portName, data.getBytes(), data.getSize(), "try");
+    impl.record(traceChannel, data);
     return true;
   }
 
@@ -202,14 +567,17 @@ protected:
   TraceAccelerator::Impl &impl;
   AppIDPath id;
   std::string portName;
+  uint32_t traceChannel;
 };
 } // namespace
 
 namespace {
 class ReadTraceChannelPort : public ReadChannelPort {
 public:
-  ReadTraceChannelPort(TraceAccelerator::Impl &impl, const Type *type)
-      : ReadChannelPort(type) {}
+  ReadTraceChannelPort(TraceAccelerator::Impl &impl, const Type *type,
+                       const AppIDPath &id, const std::string &portName)
+      : ReadChannelPort(type), impl(impl),
+        traceChannel(impl.addTraceChannel(id, portName, false)) {}
   ~ReadTraceChannelPort() { disconnect(); }
 
 private:
@@ -227,7 +595,99 @@ private:
     return MessageData(bytes);
   }
 
-  bool pollImpl() override { return callback(genMessage()); }
+  bool needsPolling() const override { return true; }
+  bool pollImpl() override {
+    MessageData data = genMessage();
+    if (!impl.isRecording())
+      return callback(std::move(data));
+    // Only record the messages which were actually delivered.
+    if (!callback(data))
+      return false;
+    impl.record(traceChannel, data);
+    return true;
+  }
+
+  TraceAccelerator::Impl &impl;
+  uint32_t traceChannel;
+};
+} // namespace
+
+namespace {
+/// Streams the messages recorded on a channel from a binary trace.
+class ReplayTraceChannelPort : public ReadChannelPort {
+public:
+  ReplayTraceChannelPort(
+      const Type *type, const BinaryTraceReader &reader,
+      BinaryTraceReader::Channel channel,
+      std::optional<std::chrono::steady_clock::time_point> replayStart)
+      : ReadChannelPort(type), reader(reader), channel(channel),
+        replayStart(replayStart) {}
+  ~ReplayTraceChannelPort() { disconnect(); }
+
+private:
+  bool needsPolling() const override { return true; }
+  bool pollImpl() override {
+    if (nextRecord == channel.numRecords)
+      return false;
+    const BinaryTraceRecord &record =
+        reader.getRecord(channel.recordOffsets[nextRecord]);
+    // Hold the message back until it is due.
+    if (replayStart) {
+      auto elapsed = std::chrono::steady_clock::now() - *replayStart;
+      if (std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+              .count() < static_cast<int64_t>(record.timestamp))
+        return false;
+    }
+    if (!callback(MessageData(reader.getRecordData(record), record.size)))
+      return false;
+    ++nextRecord;
+    return true;
+  }
+
+  const BinaryTraceReader &reader;
+  BinaryTraceReader::Channel channel;
+  std::optional<std::chrono::steady_clock::time_point> replayStart;
+  uint64_t nextRecord = 0;
+};
+} // namespace
+
+namespace {
+/// Checks the messages sent to the accelerator against the ones recorded on the
+/// channel in a binary trace.
+class ReplayWriteTraceChannelPort : public WriteChannelPort {
+public:
+  ReplayWriteTraceChannelPort(const Type *type, const BinaryTraceReader &reader,
+                              BinaryTraceReader::Channel channel,
+                              std::string name)
+      : WriteChannelPort(type), reader(reader), channel(channel),
+        name(std::move(name)) {}
+
+  void writeImpl(const MessageData &data) override { check(data); }
+  bool tryWriteImpl(const MessageData &data) override {
+    check(data);
+    return true;
+  }
+
+private:
+  void check(const MessageData &data) {
+    if (nextRecord == channel.numRecords)
+      throw std::runtime_error("replay: more messages sent on '" + name +
+                               "' than were recorded");
+    const BinaryTraceRecord &record =
+        reader.getRecord(channel.recordOffsets[nextRecord]);
+    if (record.size != data.getSize() ||
+        std::memcmp(reader.getRecordData(record), data.getBytes(),
+                    record.size) != 0)
+      throw std::runtime_error("replay: message " +
+                               std::to_string(nextRecord) + " sent on '" +
+                               name + "' differs from the recorded one");
+    ++nextRecord;
+  }
+
+  const BinaryTraceReader &reader;
+  BinaryTraceReader::Channel channel;
+  std::string name;
+  uint64_t nextRecord = 0;
 };
 } // namespace
 
@@ -247,10 +707,17 @@ TraceAccelerator::Impl::requestChannelsFor(AppIDPath idPath,
   std::map<std::string, ChannelPort &> channels;
   for (auto [name, dir, type] : bundleType->getChannels()) {
     ChannelPort *port;
-    if (BundlePort::isWrite(dir))
+    std::string traceName = getTraceChannelName(idPath, name);
+    if (BundlePort::isWrite(dir) && replay)
+      port = new ReplayWriteTraceChannelPort(
+          type, *replay, replay->getChannel(traceName), traceName);
+    else if (BundlePort::isWrite(dir))
       port = new WriteTraceChannelPort(*this, type, idPath, name);
+    else if (replay)
+      port = new ReplayTraceChannelPort(
+          type, *replay, replay->getChannel(traceName), replayStart);
     else
-      port = new ReadTraceChannelPort(*this, type);
+      port = new ReadTraceChannelPort(*this, type, idPath, name);
     channels.emplace(name, *port);
     adoptChannelPort(port);
   }
@@ -17,20 +17,28 @@
 #include "esi/Manifest.h"
 #include "esi/Services.h"
 
+#include <chrono>
+#include <future>
 #include <iostream>
 #include <map>
 #include <stdexcept>
+#include <thread>
 
 using namespace esi;
 
 void printInfo(std::ostream &os, AcceleratorConnection &acc);
 void printHier(std::ostream &os, AcceleratorConnection &acc);
+void printTelemetry(std::ostream &os, AcceleratorConnection &acc,
+                    std::chrono::milliseconds duration);
 
 int main(int argc, const char *argv[]) {
   // TODO: find a command line parser library rather than doing this by hand.
   if (argc < 3) {
     std::cerr << "Expected usage: " << argv[0]
               << " <backend> <connection specifier> [command]" << std::endl;
+    std::cerr << "Commands: version, json_manifest, info, hier, "
+                 "telemetry [milliseconds]"
+              << std::endl;
     return -1;
   }
 
@@ -54,6 +62,10 @@ int main(int argc, const char *argv[]) {
       printInfo(std::cout, *acc);
     else if (cmd == "hier")
       printHier(std::cout, *acc);
+    else if (cmd == "telemetry")
+      printTelemetry(std::cout, *acc,
+                     std::chrono::milliseconds(argc > 4 ? std::stoul(argv[4])
+                                                        : 1000));
     else {
       std::cout << "Connection successful." << std::endl;
       if (!cmd.empty()) {
@@ -133,3 +145,70 @@ void printHier(std::ostream &os, AcceleratorConnection &acc) {
   os << std::endl;
   printInstance(os, design);
 }
+
+void printPortTelemetry(std::ostream &os, const BundlePort &port,
+                        std::string indent = "") {
+  os << indent << "  " << port.getID() << ":" << std::endl;
+  for (const auto &[name, chan] : port.getChannels())
+    os << indent << "    " << name << ": " << chan.getTelemetry().getSnapshot()
+       << std::endl;
+}
+
+void printInstanceTelemetry(std::ostream &os, const HWModule *d,
+                            std::string indent = "") {
+  os << indent << "* Instance:";
+  if (auto inst = dynamic_cast<const Instance *>(d))
+    os << inst->getID() << std::endl;
+  else
+    os << "top" << std::endl;
+  for (const BundlePort &port : d->getPortsOrdered())
+    printPortTelemetry(os, port, indent + "  ");
+  for (const Instance *child : d->getChildrenOrdered())
+    printInstanceTelemetry(os, child, indent + "  ");
+}
+
+/// Connect all the read channels of a module and its children in polling mode
+/// and start reading from them, so that their traffic is accepted and counted.
+void connectReadChannels(
+    const HWModule *d,
+    std::vector<std::pair<ReadChannelPort *, std::future<MessageData>>>
+        &reads) {
+  for (const BundlePort &port : d->getPortsOrdered())
+    for (const auto &[name, chan] : port.getChannels())
+      if (auto *readPort = dynamic_cast<ReadChannelPort *>(&chan);
+          readPort && !readPort->isConnected()) {
+        readPort->connect();
+        reads.emplace_back(readPort, readPort->readAsync());
+      }
+  for (const Instance *child : d->getChildrenOrdered())
+    connectReadChannels(child, reads);
+}
+
+void printTelemetry(std::ostream &os, AcceleratorConnection &acc,
+                    std::chrono::milliseconds duration) {
+  Manifest manifest(acc.getCtxt(),
+                    acc.getService<services::SysInfo>()->getJsonManifest());
+  Accelerator *design = manifest.buildAccelerator(acc);
+  std::vector<std::pair<ReadChannelPort *, std::future<MessageData>>> reads;
+  connectReadChannels(design, reads);
+  auto end = std::chrono::steady_clock::now() + duration;
+  while (std::chrono::steady_clock::now() < end) {
+    bool busy = design->poll();
+    // Consume the messages received so far.
+    for (auto &[port, read] : reads) {
+      while (read.wait_for(std::chrono::seconds(0)) ==
+             std::future_status::ready) {
+        read.get();
+        read = port->readAsync();
+      }
+    }
+    if (!busy)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  os << "********************************" << std::endl;
+  os << "* Channel telemetry" << std::endl;
+  os << "********************************" << std::endl;
+  os << std::endl;
+  printInstanceTelemetry(os, design);
+}
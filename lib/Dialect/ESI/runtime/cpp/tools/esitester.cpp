@@ -23,14 +23,18 @@
 #include "esi/Manifest.h"
 #include "esi/Services.h"
 
+#include <coroutine>
 #include <iostream>
 #include <map>
 #include <stdexcept>
+#include <thread>
 
 using namespace esi;
 
 static void registerCallbacks(AcceleratorConnection *, Accelerator *);
 static void dmaTest(AcceleratorConnection *, Accelerator *);
+static void readTest();
+static void bufferTest(AcceleratorConnection *);
 
 int main(int argc, const char *argv[]) {
   // TODO: find a command line parser library rather than doing this by hand.
@@ -64,6 +68,10 @@ int main(int argc, const char *argv[]) {
       std::this_thread::sleep_for(std::chrono::seconds(1));
     } else if (cmd == "dmatest") {
       dmaTest(acc.get(), accel);
+    } else if (cmd == "readtest") {
+      readTest();
+    } else if (cmd == "buffertest") {
+      bufferTest(acc.get());
     }
 
     acc->disconnect();
@@ -123,3 +131,179 @@ void dmaTest(AcceleratorConnection *conn, Accelerator *acc) {
   if (val != *dataPtr)
     throw std::runtime_error("DMA test failed");
 }
+
+static std::string getBytes(const MessageData &msg) {
+  std::string bytes;
+  for (size_t i = 0; i < msg.getSize(); ++i)
+    bytes += (i ? " " : "") + std::to_string(msg.getBytes()[i]);
+  return bytes;
+}
+
+/// Exercise the host memory buffer pool and the messages referencing its
+/// buffers.
+void bufferTest(AcceleratorConnection *conn) {
+  using services::HostMem;
+  auto *hostmem = conn->getService<HostMem>();
+  auto pool = std::make_unique<HostMem::BufferPool>(*hostmem, 4,
+                                                    HostMem::Options(), 2);
+
+  // Messages reference the buffer rather than copying it, and keep it alive.
+  std::shared_ptr<HostMem::HostMemRegion> buffer = pool->acquire();
+  auto *bytes = static_cast<uint8_t *>(buffer->getPtr());
+  for (uint8_t i = 0; i < 4; ++i)
+    bytes[i] = i + 1;
+  MessageData msg = HostMem::getMessage(buffer, 2);
+  buffer.reset();
+  std::cout << "message: " << getBytes(msg) << ", reference "
+            << msg.isReference() << ", shares buffer "
+            << (msg.getBytes() == bytes) << std::endl;
+  bytes[0] = 0xff;
+  std::cout << "after buffer write: " << getBytes(msg) << std::endl;
+
+  // Copies share the bytes and the buffer only returns to the pool once the
+  // last of them is gone.
+  MessageData copy = msg;
+  msg = MessageData();
+  std::cout << "copy: " << getBytes(copy) << ", shares buffer "
+            << (copy.getBytes() == bytes) << ", in use "
+            << pool->getNumInUse() << std::endl;
+  copy = MessageData();
+  std::cout << "released: in use " << pool->getNumInUse() << ", free "
+            << pool->getNumFree() << std::endl;
+
+  // Released buffers are recycled, up to the cap.
+  auto a = pool->acquire();
+  auto b = pool->acquire();
+  auto c = pool->acquire();
+  std::cout << "recycled " << (a->getPtr() == bytes) << ", second "
+            << (b != nullptr) << ", over the cap " << (c != nullptr)
+            << std::endl;
+  try {
+    HostMem::getMessage(a, 5);
+  } catch (std::exception &e) {
+    std::cout << "oversized message: " << e.what() << std::endl;
+  }
+
+  // Buffers may outlive the pool.
+  pool.reset();
+  a.reset();
+  b.reset();
+  std::cout << "buffers released after the pool" << std::endl;
+}
+
+namespace {
+/// A read channel whose messages are delivered by the test rather than by a
+/// backend.
+class TestReadChannelPort : public ReadChannelPort {
+public:
+  using ReadChannelPort::ReadChannelPort;
+  bool deliver(uint8_t value) { return callback(MessageData(&value, 1)); }
+};
+
+/// A coroutine which nobody waits on. It runs until its first suspension when
+/// called.
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() { return {}; }
+    std::suspend_never initial_suspend() { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+} // namespace
+
+static std::ostream &operator<<(std::ostream &os,
+                                const CompletionQueue::Completion &c) {
+  return os << c.port->getType()->getID()
+            << ":" << static_cast<unsigned>(*c.data.as<uint8_t>());
+}
+
+static DetachedTask awaitOne(ReadChannelPort &port, std::string name) {
+  try {
+    MessageData msg = co_await port.awaitRead();
+    std::cout << name << ": " << static_cast<unsigned>(*msg.as<uint8_t>())
+              << std::endl;
+  } catch (std::exception &e) {
+    std::cout << name << ": " << e.what() << std::endl;
+  }
+}
+
+static unsigned getValue(std::future<MessageData> &f) {
+  return *f.get().as<uint8_t>();
+}
+
+/// Exercise the completion queue and coroutine reads on channels fed by the
+/// test itself, independently of the accelerator.
+void readTest() {
+  UIntType typeA("a", 8), typeB("b", 8);
+
+  // Completion queue: polling, waiting, and the capacity limit.
+  {
+    TestReadChannelPort a(&typeA), b(&typeB);
+    CompletionQueue queue(2);
+    a.connect(queue);
+    b.connect(queue);
+    std::vector<CompletionQueue::Completion> out;
+    std::cout << "poll empty: " << queue.poll(out) << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+    size_t n = queue.wait(out, std::chrono::milliseconds(10));
+    bool waited = std::chrono::steady_clock::now() - start >=
+                  std::chrono::milliseconds(10);
+    std::cout << "wait timeout: " << n << (waited ? " after" : " before")
+              << " the timeout" << std::endl;
+
+    std::cout << "deliver: " << a.deliver(1) << " " << b.deliver(2) << " "
+              << a.deliver(3) << std::endl;
+    std::cout << "poll one: " << queue.poll(out, 1) << " " << out.back()
+              << std::endl;
+    std::cout << "deliver: " << b.deliver(4) << std::endl;
+    out.clear();
+    std::cout << "wait: " << queue.wait(out) << " " << out[0] << " " << out[1]
+              << std::endl;
+
+    // Wake up a waiting thread.
+    std::thread deliverer([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      a.deliver(5);
+    });
+    out.clear();
+    std::cout << "wait for thread: " << queue.wait(out) << " " << out[0]
+              << std::endl;
+    deliverer.join();
+
+    auto stats = a.getTelemetry().getSnapshot();
+    std::cout << "a: messages " << stats.messages << ", rejected "
+              << stats.rejected << std::endl;
+  }
+
+  // Futures and awaiters are served in the order the reads were issued.
+  {
+    TestReadChannelPort port(&typeA);
+    port.connect();
+    std::future<MessageData> f1 = port.readAsync();
+    awaitOne(port, "co1");
+    std::future<MessageData> f2 = port.readAsync();
+    awaitOne(port, "co2");
+    for (uint8_t i = 1; i <= 4; ++i)
+      port.deliver(i);
+    std::cout << "f1: " << getValue(f1) << std::endl;
+    std::cout << "f2: " << getValue(f2) << std::endl;
+
+    // Queued data is read without suspending.
+    port.deliver(5);
+    awaitOne(port, "co3");
+
+    // Disconnecting fails the outstanding reads.
+    std::future<MessageData> f3 = port.readAsync();
+    awaitOne(port, "co4");
+    port.disconnect();
+    try {
+      getValue(f3);
+    } catch (std::exception &e) {
+      std::cout << "f3: " << e.what() << std::endl;
+    }
+    awaitOne(port, "co5");
+  }
+}
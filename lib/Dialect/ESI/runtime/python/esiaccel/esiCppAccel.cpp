@@ -266,7 +266,26 @@ PYBIND11_MODULE(esiCppAccel, m) {
            py::arg("buffer_size") = std::nullopt)
       .def("disconnect", &ChannelPort::disconnect)
       .def_property_readonly("type", &ChannelPort::getType,
-                             py::return_value_policy::reference);
+                             py::return_value_policy::reference)
+      .def_property_readonly(
+          "telemetry",
+          [](ChannelPort &p) {
+            ChannelTelemetry::Snapshot snapshot =
+                p.getTelemetry().getSnapshot();
+            py::dict d;
+            d["messages"] = snapshot.messages;
+            d["bytes"] = snapshot.bytes;
+            d["rejected"] = snapshot.rejected;
+            d["poll_misses"] = snapshot.pollMisses;
+            d["queue_depth"] = snapshot.queueDepth;
+            d["max_queue_depth"] = snapshot.maxQueueDepth;
+            d["latency_us_histogram"] = py::cast(snapshot.latency);
+            return d;
+          },
+          "Traffic statistics of the channel. Latency bucket 0 counts "
+          "latencies below 1us, bucket i those below 2^i us.")
+      .def("reset_telemetry",
+           [](ChannelPort &p) { p.getTelemetry().reset(); });
 
   py::class_<WriteChannelPort, ChannelPort>(m, "WriteChannelPort")
       .def("write",
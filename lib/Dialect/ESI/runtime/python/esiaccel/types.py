@@ -309,6 +309,16 @@ class Port:
   def disconnect(self):
     self.cpp_port.disconnect()
 
+  @property
+  def telemetry(self) -> Dict[str, Any]:
+    """Traffic statistics of the channel: message and byte counts, rejected
+    messages, poll misses, queue depth, and a latency histogram with
+    power-of-two microsecond buckets."""
+    return self.cpp_port.telemetry
+
+  def reset_telemetry(self):
+    self.cpp_port.reset_telemetry()
+
 
 class WritePort(Port):
   """A unidirectional communication channel from the host to the accelerator."""
@@ -23,9 +23,11 @@
 #include "mlir/IR/Threading.h"
 #include "mlir/Pass/Pass.h"
 #include "llvm/ADT/APSInt.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ScopedPrinter.h"
+#include <queue>
 
 namespace circt {
 namespace firrtl {
@@ -195,8 +197,44 @@ struct IMConstPropPass
   }
 
   bool isOverdefined(FieldRef value) const {
-    auto it = latticeValues.find(value);
-    return it != latticeValues.end() && it->second.isOverdefined();
+    auto *lattice = lookupLatticeValue(value);
+    return lattice && lattice->isOverdefined();
+  }
+
+  /// Return the dense number of a field ref, assigning the next free one if it
+  /// has none yet.
+  unsigned getFieldRefId(FieldRef value) {
+    auto [it, inserted] = fieldRefIds.try_emplace(value, fieldRefs.size());
+    if (inserted) {
+      fieldRefs.push_back(value);
+      latticeValues.emplace_back();
+      fieldRefUsers.emplace_back();
+      inWorklist.push_back(false);
+    }
+    return it->second;
+  }
+
+  /// Return the lattice value of a field ref, which starts out unknown.
+  LatticeValue &getLatticeValue(FieldRef value) {
+    return latticeValues[getFieldRefId(value)];
+  }
+
+  /// Return the lattice value of a field ref, or null if nothing has been
+  /// computed for it yet.
+  const LatticeValue *lookupLatticeValue(FieldRef value) const {
+    auto it = fieldRefIds.find(value);
+    if (it == fieldRefIds.end())
+      return nullptr;
+    return &latticeValues[it->second];
+  }
+
+  /// Queue the users of a field ref for revisitation, unless they already are.
+  void markChanged(FieldRef value) {
+    unsigned id = getFieldRefId(value);
+    if (inWorklist.test(id))
+      return;
+    inWorklist.set(id);
+    changedLatticeValueWorklist.push(id);
   }
 
   // Mark the given value as overdefined. If the value is an aggregate,
@@ -217,14 +255,14 @@ struct IMConstPropPass
   /// Mark the given value as overdefined. This means that we cannot refine a
   /// specific constant for this value.
   void markOverdefined(FieldRef value) {
-    auto &entry = latticeValues[value];
+    auto &entry = getLatticeValue(value);
     if (!entry.isOverdefined()) {
       LLVM_DEBUG({
         logger.getOStream()
             << "Setting overdefined : (" << getFieldName(value).first << ")\n";
       });
       entry.markOverdefined();
-      changedLatticeValueWorklist.push_back(value);
+      markChanged(value);
     }
   }
 
@@ -238,7 +276,7 @@ struct IMConstPropPass
         logger.getOStream()
             << "Changed to " << valueEntry << " : (" << value << ")\n";
       });
-      changedLatticeValueWorklist.push_back(value);
+      markChanged(value);
     }
   }
 
@@ -246,16 +284,16 @@ struct IMConstPropPass
     // Don't even do a map lookup if from has no info in it.
     if (source.isUnknown())
       return;
-    mergeLatticeValue(value, latticeValues[value], source);
+    mergeLatticeValue(value, getLatticeValue(value), source);
   }
 
   void mergeLatticeValue(FieldRef result, FieldRef from) {
     // If 'from' hasn't been computed yet, then it is unknown, don't do
     // anything.
-    auto it = latticeValues.find(from);
-    if (it == latticeValues.end())
+    auto *fromLattice = lookupLatticeValue(from);
+    if (!fromLattice)
       return;
-    mergeLatticeValue(result, it->second);
+    mergeLatticeValue(result, *fromLattice);
   }
 
   void mergeLatticeValue(Value result, Value from) {
@@ -284,10 +322,10 @@ struct IMConstPropPass
       return;
 
     // If we've changed this value then revisit all the users.
-    auto &valueEntry = latticeValues[value];
+    auto &valueEntry = getLatticeValue(value);
     if (valueEntry != source) {
-      changedLatticeValueWorklist.push_back(value);
       valueEntry = source;
+      markChanged(value);
     }
   }
 
@@ -333,18 +371,36 @@ private:
   /// This is the current instance graph for the Circuit.
   InstanceGraph *instanceGraph = nullptr;
 
+  /// A dense numbering of the tracked field refs. Everything the analysis
+  /// tracks per field ref is stored at its number in the flat arrays below,
+  /// such that a field ref costs a single map entry and the propagation itself
+  /// works on indices.
+  DenseMap<FieldRef, unsigned> fieldRefIds;
+  SmallVector<FieldRef> fieldRefs;
+
   /// This keeps track of the current state of each tracked value.
-  DenseMap<FieldRef, LatticeValue> latticeValues;
+  SmallVector<LatticeValue> latticeValues;
+
+  /// The operations to be reprocessed when a lattice value changes.
+  SmallVector<llvm::TinyPtrVector<Operation *>> fieldRefUsers;
 
   /// The set of blocks that are known to execute, or are intrinsically live.
   SmallPtrSet<Block *, 16> executableBlocks;
 
   /// A worklist of values whose LatticeValue recently changed, indicating the
-  /// users need to be reprocessed.
-  SmallVector<FieldRef, 64> changedLatticeValueWorklist;
-
-  // A map to give operations to be reprocessed.
-  DenseMap<FieldRef, llvm::TinyPtrVector<Operation *>> fieldRefToUsers;
+  /// users need to be reprocessed. A value is only queued once until it is
+  /// processed, since its users always see its latest lattice value.
+  ///
+  /// Field refs are numbered as the blocks defining them become executable,
+  /// which follows program order within a module and descends into instances
+  /// as they are encountered. Popping the lowest number first therefore
+  /// visits changed values roughly in topological order: the operands of an
+  /// operation tend to settle before it is revisited, instead of the
+  /// operation being revisited once per operand change.
+  std::priority_queue<unsigned, SmallVector<unsigned, 64>,
+                      std::greater<unsigned>>
+      changedLatticeValueWorklist;
+  llvm::BitVector inWorklist;
 
   // A map to cache results of getFieldRefFromValue since it's costly traverse
   // the IR.
@@ -381,8 +437,14 @@ void IMConstPropPass::runOnOperation() {
 
   // If a value changed lattice state then reprocess any of its users.
   while (!changedLatticeValueWorklist.empty()) {
-    FieldRef changedFieldRef = changedLatticeValueWorklist.pop_back_val();
-    for (Operation *user : fieldRefToUsers[changedFieldRef]) {
+    unsigned changedId = changedLatticeValueWorklist.top();
+    changedLatticeValueWorklist.pop();
+    inWorklist.reset(changedId);
+    FieldRef changedFieldRef = fieldRefs[changedId];
+    // Visiting a user may track new field refs and grow `fieldRefUsers`, so
+    // the users are looked up by index.
+    for (size_t i = 0; i < fieldRefUsers[changedId].size(); ++i) {
+      Operation *user = fieldRefUsers[changedId][i];
       if (isBlockExecutable(user->getBlock()))
         visitOperation(user, changedFieldRef);
     }
@@ -395,10 +457,13 @@ void IMConstPropPass::runOnOperation() {
 
   // Clean up our state for next time.
   instanceGraph = nullptr;
+  fieldRefIds.clear();
+  fieldRefs.clear();
   latticeValues.clear();
+  fieldRefUsers.clear();
   executableBlocks.clear();
   assert(changedLatticeValueWorklist.empty());
-  fieldRefToUsers.clear();
+  inWorklist.clear();
   valueToFieldRef.clear();
   resultPortToInstanceResultMapping.clear();
 }
@@ -410,11 +475,11 @@ LatticeValue IMConstPropPass::getExtendedLatticeValue(FieldRef value,
                                                       FIRRTLType destType,
                                                       bool allowTruncation) {
   // If 'value' hasn't been computed yet, then it is unknown.
-  auto it = latticeValues.find(value);
-  if (it == latticeValues.end())
+  auto *lattice = lookupLatticeValue(value);
+  if (!lattice)
     return LatticeValue();
 
-  auto result = it->second;
+  auto result = *lattice;
   // Unknown/overdefined stay whatever they are.
   if (result.isUnknown() || result.isOverdefined())
     return result;
@@ -527,11 +592,12 @@ void IMConstPropPass::markBlockExecutable(Block *block) {
           continue;
         // Special-handle PropertyType's, walkGroundTypes doesn't support.
         if (type_isa<PropertyType>(firrtlType)) {
-          fieldRefToUsers[fieldRef].push_back(&op);
+          fieldRefUsers[getFieldRefId(fieldRef)].push_back(&op);
           continue;
         }
         walkGroundTypes(firrtlType, [&](uint64_t fieldID, auto type, auto) {
-          fieldRefToUsers[fieldRef.getSubField(fieldID)].push_back(&op);
+          fieldRefUsers[getFieldRefId(fieldRef.getSubField(fieldID))]
+              .push_back(&op);
         });
       }
     }
@@ -844,7 +910,8 @@ void IMConstPropPass::visitOperation(Operation *op, FieldRef changedField) {
   bool hasUnknown = false;
   for (Value operand : op->getOperands()) {
 
-    auto &operandLattice = latticeValues[getOrCacheFieldRefFromValue(operand)];
+    auto &operandLattice =
+        getLatticeValue(getOrCacheFieldRefFromValue(operand));
 
     // If the operand is an unknown value, then we generally don't want to
     // process it - we want to wait until the value is resolved to by the SCCP
@@ -919,7 +986,7 @@ void IMConstPropPass::visitOperation(Operation *op, FieldRef changedField) {
         resultLattice = LatticeValue::getOverdefined();
     } else { // Folding to an operand results in its value.
       resultLattice =
-          latticeValues[getOrCacheFieldRefFromValue(foldResult.get<Value>())];
+          getLatticeValue(getOrCacheFieldRefFromValue(foldResult.get<Value>()));
     }
 
     mergeLatticeValue(getOrCacheFieldRefFromValue(op->getResult(i)),
@@ -986,9 +1053,8 @@ void IMConstPropPass::rewriteModuleBody(FModuleOp module) {
     };
 
     // TODO: Replace entire aggregate.
-    auto it = latticeValues.find(getFieldRefFromValue(value));
-    if (it == latticeValues.end() || it->second.isOverdefined() ||
-        it->second.isUnknown())
+    auto *lattice = lookupLatticeValue(getFieldRefFromValue(value));
+    if (!lattice || lattice->isOverdefined() || lattice->isUnknown())
       return false;
 
     // Cannot materialize constants for certain types.
@@ -999,7 +1065,7 @@ void IMConstPropPass::rewriteModuleBody(FModuleOp module) {
       return false;
 
     auto cstValue =
-        getConst(it->second.getValue(), value.getType(), value.getLoc());
+        getConst(lattice->getValue(), value.getType(), value.getLoc());
 
     replaceIfNotConnect(cstValue);
     return true;
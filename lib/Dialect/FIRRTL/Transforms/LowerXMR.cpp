@@ -91,6 +91,10 @@ class LowerXMRPass : public circt::firrtl::impl::LowerXMRBase<LowerXMRPass> {
     dataFlowClasses = &eq;
 
     InstanceGraph &instanceGraph = getAnalysis<InstanceGraph>();
+    // Instances are only replaced when dropping their ref ports, which the
+    // listener tracks in the instance graph.
+    InstanceGraphListener listener(instanceGraph);
+    instanceGraphListener = &listener;
     SmallVector<RefResolveOp> resolveOps;
     SmallVector<RefSubOp> indexingOps;
     SmallVector<Operation *> forceAndReleaseOps;
@@ -356,8 +360,11 @@ class LowerXMRPass : public circt::firrtl::impl::LowerXMRBase<LowerXMRPass> {
     opsToRemove.clear();
     xmrPathSuffix.clear();
     circuitNamespace = nullptr;
+    instanceGraphListener = nullptr;
     pathCache.clear();
     pathInsertPoint = {};
+
+    markAnalysesPreserved<InstanceGraph>();
   }
 
   /// Generate the ABI ref_<module> prefix string into `prefix`.
@@ -735,9 +742,10 @@ class LowerXMRPass : public circt::firrtl::impl::LowerXMRBase<LowerXMRPass> {
       else if (auto mod = dyn_cast<FExtModuleOp>(iter.getFirst()))
         mod.erasePorts(iter.getSecond());
       else if (auto inst = dyn_cast<InstanceOp>(iter.getFirst())) {
-        ImplicitLocOpBuilder b(inst.getLoc(), inst);
-        inst.erasePorts(b, iter.getSecond());
-        inst.erase();
+        IRRewriter rewriter(inst.getContext(), instanceGraphListener);
+        rewriter.setInsertionPoint(inst);
+        inst.erasePorts(rewriter, iter.getSecond());
+        rewriter.eraseOp(inst);
       } else if (auto mem = dyn_cast<MemOp>(iter.getFirst())) {
         // Remove all debug ports of the memory.
         ImplicitLocOpBuilder builder(mem.getLoc(), mem);
@@ -849,6 +857,9 @@ private:
 
   CircuitNamespace *circuitNamespace;
 
+  /// Keeps the instance graph up to date as instances are replaced.
+  InstanceGraphListener *instanceGraphListener = nullptr;
+
   /// A cache of already created HierPathOps.  This is used to avoid repeatedly
   /// creating the same HierPathOp.
   DenseMap<Attribute, hw::HierPathOp> pathCache;
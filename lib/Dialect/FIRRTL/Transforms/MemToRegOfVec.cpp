@@ -71,6 +71,9 @@ struct MemToRegOfVecPass
                             if (auto mod = dyn_cast<FModuleOp>(op))
                               runOnModule(mod);
                           });
+
+    // Memories are replaced by registers, which leaves the instances alone.
+    markAnalysesPreserved<InstanceGraph>();
   }
 
   void runOnModule(FModuleOp mod) {
@@ -38,7 +38,8 @@ struct RemoveUnusedPortsPass
     : public circt::firrtl::impl::RemoveUnusedPortsBase<RemoveUnusedPortsPass> {
   void runOnOperation() override;
   void removeUnusedModulePorts(FModuleOp module,
-                               InstanceGraphNode *instanceGraphNode);
+                               InstanceGraphNode *instanceGraphNode,
+                               InstanceGraphListener &listener);
 
   /// If true, the pass will remove unused ports even if they have carry a
   /// symbol or annotations. This is likely to break the IR, but may be useful
@@ -51,17 +52,25 @@ struct RemoveUnusedPortsPass
 void RemoveUnusedPortsPass::runOnOperation() {
   auto &instanceGraph = getAnalysis<InstanceGraph>();
   LLVM_DEBUG(debugPassHeader(this) << "\n");
+  // Instances are replaced through a listener which keeps the instance graph
+  // up to date. Since this changes the instance lists the post-order traversal
+  // is walking, the order is computed upfront.
+  InstanceGraphListener listener(instanceGraph);
+  SmallVector<InstanceGraphNode *> nodes(llvm::post_order(&instanceGraph));
   // Iterate in the reverse order of instance graph iterator, i.e. from leaves
   // to top.
-  for (auto *node : llvm::post_order(&instanceGraph))
+  for (auto *node : nodes)
     if (auto module = dyn_cast<FModuleOp>(*node->getModule()))
       // Don't prune the main module.
       if (!module.isPublic())
-        removeUnusedModulePorts(module, node);
+        removeUnusedModulePorts(module, node, listener);
+
+  markAnalysesPreserved<InstanceGraph>();
 }
 
 void RemoveUnusedPortsPass::removeUnusedModulePorts(
-    FModuleOp module, InstanceGraphNode *instanceGraphNode) {
+    FModuleOp module, InstanceGraphNode *instanceGraphNode,
+    InstanceGraphListener &listener) {
   LLVM_DEBUG(llvm::dbgs() << "Prune ports of module: " << module.getName()
                           << "\n");
   // This tracks constant values of output ports. None indicates an invalid
@@ -152,7 +161,8 @@ void RemoveUnusedPortsPass::removeUnusedModulePorts(
              }););
 
   // Rewrite all uses.
-  for (auto *use : instanceGraphNode->uses()) {
+  IRRewriter rewriter(module.getContext(), &listener);
+  for (auto *use : llvm::make_early_inc_range(instanceGraphNode->uses())) {
     auto instance = ::cast<InstanceOp>(*use->getInstance());
     ImplicitLocOpBuilder builder(instance.getLoc(), instance);
     unsigned outputPortIndex = 0;
@@ -202,9 +212,10 @@ void RemoveUnusedPortsPass::removeUnusedModulePorts(
     }
 
     // Create a new instance op without unused ports.
-    instance.erasePorts(builder, removalPortIndexes);
+    rewriter.setInsertionPoint(instance);
+    instance.erasePorts(rewriter, removalPortIndexes);
     // Remove old one.
-    instance.erase();
+    rewriter.eraseOp(instance);
   }
 
   numRemovedPorts += removalPortIndexes.count();
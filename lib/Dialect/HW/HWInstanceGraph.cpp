@@ -25,9 +25,14 @@ InstanceGraph::InstanceGraph(Operation *operation)
 }
 
 igraph::InstanceGraphNode *InstanceGraph::addHWModule(HWModuleLike module) {
-  auto *node = igraph::InstanceGraph::addModule(
-      cast<igraph::ModuleOpInterface>(module.getOperation()));
-  if (module.isPublic())
+  return addModule(cast<igraph::ModuleOpInterface>(module.getOperation()));
+}
+
+igraph::InstanceGraphNode *
+InstanceGraph::addModule(igraph::ModuleOpInterface module) {
+  auto *node = igraph::InstanceGraph::addModule(module);
+  auto hwModule = dyn_cast<HWModuleLike>(module.getOperation());
+  if (hwModule && hwModule.isPublic())
     entry.addInstance({}, node);
   return node;
 }
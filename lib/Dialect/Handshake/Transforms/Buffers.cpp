@@ -13,6 +13,8 @@
 #include "circt/Dialect/Handshake/HandshakeOps.h"
 #include "circt/Dialect/Handshake/HandshakePasses.h"
 #include "circt/Dialect/Handshake/HandshakeUtils.h"
+#include "circt/Scheduling/Algorithms.h"
+#include "circt/Scheduling/Problems.h"
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Rewrite/FrozenRewritePatternSet.h"
@@ -178,14 +180,174 @@ static void bufferAllFIFOStrategy(Region &r, OpBuilder &builder,
                     /*bufferType=*/BufferTypeEnum::fifo);
 }
 
+// The number of cycles a token spends in an operation. Only sequential buffers
+// delay tokens, by one cycle per slot.
+static unsigned getLatency(Operation *op) {
+  auto bufferOp = dyn_cast<handshake::BufferOp>(op);
+  if (bufferOp && bufferOp.isSequential())
+    return bufferOp.getNumSlots();
+  return 0;
+}
+
+// Insert a buffer on a single use of a value.
+static void insertBufferOnUse(OpOperand &use, OpBuilder &builder,
+                              unsigned numSlots, BufferTypeEnum bufferType) {
+  auto ip = builder.saveInsertionPoint();
+  builder.setInsertionPointAfterValue(use.get());
+  auto bufferOp = builder.create<handshake::BufferOp>(
+      use.get().getLoc(), use.get(), numSlots, bufferType);
+  use.set(bufferOp);
+  builder.restoreInsertionPoint(ip);
+}
+
+// Sort the operations of a region topologically, treating the channels which
+// close a cycle as back edges. Returns the operations in topological order and
+// adds the back edges to `backEdges`.
+static SmallVector<Operation *>
+sortChannels(Region &r, DenseSet<OpOperand *> &backEdges) {
+  SmallVector<Operation *> postOrder;
+  DenseSet<Operation *> visited;
+  DenseSet<Operation *> onStack;
+  SmallVector<std::pair<Operation *, Operation::user_iterator>> stack;
+  auto push = [&](Operation *op) {
+    visited.insert(op);
+    onStack.insert(op);
+    stack.push_back({op, op->getUsers().begin()});
+  };
+
+  for (auto &root : r.getOps()) {
+    if (visited.contains(&root))
+      continue;
+    push(&root);
+    while (!stack.empty()) {
+      auto &[op, it] = stack.back();
+      if (it == op->getUsers().end()) {
+        onStack.erase(op);
+        postOrder.push_back(op);
+        stack.pop_back();
+        continue;
+      }
+      auto *user = *it++;
+      if (user->getParentRegion() != &r)
+        continue;
+      if (onStack.contains(user)) {
+        for (auto &operand : user->getOpOperands())
+          if (operand.get().getDefiningOp() == op)
+            backEdges.insert(&operand);
+        continue;
+      }
+      if (!visited.contains(user))
+        push(user);
+    }
+  }
+  return SmallVector<Operation *>(llvm::reverse(postOrder));
+}
+
+// Place buffers such that the circuit reaches the highest throughput its
+// cycles allow, or the `targetII` if that is lower. The circuit is modeled as
+// a marked graph: every cycle holds one token at a time, which enters through
+// a back edge, and a token takes as many cycles to traverse a cycle as the
+// sequential buffers along it have slots. The longest such cycle determines
+// the initiation interval (II) at which new tokens can enter the circuit,
+// which is computed by solving a cyclic scheduling problem. Reconvergent paths
+// of different latency then need buffers on the shorter path to hold the
+// tokens that arrive while the longer path is still busy. Computing the
+// earliest arrival time of tokens at each operation places this slack on the
+// channels feeding the point where the paths reconverge, which are buffered
+// with a FIFO large enough to hold one token per II of slack.
+static LogicalResult bufferThroughputStrategy(Region &r, OpBuilder &builder,
+                                              unsigned numSlots,
+                                              unsigned targetII) {
+  // Break combinational cycles with sequential buffers.
+  auto isSeqBuffer = [](auto op) {
+    auto bufferOp = dyn_cast<handshake::BufferOp>(op);
+    return bufferOp && bufferOp.isSequential();
+  };
+  for (auto mergeOp : r.getOps<MergeLikeOpInterface>())
+    if (inCycle(mergeOp, isSeqBuffer))
+      bufferResults(builder, mergeOp, numSlots, BufferTypeEnum::seq);
+
+  DenseSet<OpOperand *> backEdges;
+  auto order = sortChannels(r, backEdges);
+  if (order.empty())
+    return success();
+
+  // Determine the II the cycles of the circuit allow.
+  auto *containingOp = r.getParentOp();
+  scheduling::CyclicProblem prob(containingOp);
+  DenseMap<unsigned, scheduling::Problem::OperatorType> oprs;
+  for (auto *op : order) {
+    unsigned latency = getLatency(op);
+    auto &opr = oprs[latency];
+    if (!opr) {
+      opr = prob.getOrInsertOperatorType("latency" + std::to_string(latency));
+      prob.setLatency(opr, latency);
+    }
+    prob.insertOperation(op);
+    prob.setLinkedOperatorType(op, opr);
+  }
+  for (auto *operand : backEdges)
+    prob.setDistance(operand, 1);
+  auto *lastOp = r.front().getTerminator();
+  if (failed(prob.check()) || failed(scheduling::scheduleSimplex(prob, lastOp)))
+    return containingOp->emitOpError()
+           << "cannot determine the throughput of the circuit";
+  unsigned ii = std::max(*prob.getInitiationInterval(), 1u);
+  if (targetII != 0 && ii > targetII)
+    containingOp->emitWarning()
+        << "cannot reach target initiation interval " << targetII
+        << "; the longest cycle of the circuit limits it to " << ii;
+  ii = std::max(ii, targetII);
+
+  // Compute the earliest time at which tokens arrive at each operation, and
+  // the number of cycles they wait on each channel.
+  DenseMap<Operation *, unsigned> arrival;
+  auto getDeparture = [&](Value value) -> unsigned {
+    auto *defOp = value.getDefiningOp();
+    if (!defOp || defOp->getParentRegion() != &r)
+      return 0;
+    return arrival.lookup(defOp) + getLatency(defOp);
+  };
+  for (auto *op : order) {
+    unsigned time = 0;
+    for (auto &operand : op->getOpOperands())
+      if (!backEdges.contains(&operand))
+        time = std::max(time, getDeparture(operand.get()));
+    arrival[op] = time;
+  }
+
+  // The results of the circuit leave through the terminator independently of
+  // each other, so it is not a point where paths have to be balanced.
+  SmallVector<std::pair<OpOperand *, unsigned>> slackChannels;
+  for (auto *op : order) {
+    if (op->hasTrait<OpTrait::IsTerminator>())
+      continue;
+    for (auto &operand : op->getOpOperands()) {
+      if (!isUnbufferedChannel(operand.get().getDefiningOp(), op))
+        continue;
+      int64_t slack = int64_t(arrival[op]) - getDeparture(operand.get());
+      if (backEdges.contains(&operand))
+        slack += ii;
+      if (slack > 0)
+        slackChannels.push_back({&operand, llvm::divideCeil(slack, ii)});
+    }
+  }
+  for (auto [operand, slots] : slackChannels)
+    insertBufferOnUse(*operand, builder, slots, BufferTypeEnum::fifo);
+  return success();
+}
+
 static LogicalResult bufferRegion(Region &r, OpBuilder &builder,
-                                  StringRef strategy, unsigned bufferSize) {
+                                  StringRef strategy, unsigned bufferSize,
+                                  unsigned targetII) {
   if (strategy == "cycles")
     bufferCyclesStrategy(r, builder, bufferSize);
   else if (strategy == "all")
     bufferAllStrategy(r, builder, bufferSize);
   else if (strategy == "allFIFO")
     bufferAllFIFOStrategy(r, builder, bufferSize);
+  else if (strategy == "throughput")
+    return bufferThroughputStrategy(r, builder, bufferSize, targetII);
   else
     return r.getParentOp()->emitOpError()
            << "Unknown buffer strategy: " << strategy;
@@ -209,7 +371,8 @@ struct HandshakeInsertBuffersPass
 
     OpBuilder builder(f.getContext());
 
-    if (failed(bufferRegion(f.getBody(), builder, strategy, bufferSize)))
+    if (failed(bufferRegion(f.getBody(), builder, strategy, bufferSize,
+                            targetII)))
       signalPassFailure();
   }
 };
@@ -63,10 +63,10 @@ void PrimitiveDB::foreach (
 //===----------------------------------------------------------------------===//
 // PlacementDB.
 //===----------------------------------------------------------------------===//
-// NOTE: Nothing in this implementation is in any way the most optimal
-// implementation. We put off deciding what the correct data structure is until
-// we have a better handle of the operations it must accelerate. Performance is
-// not an immediate goal.
+// Placements are indexed column-major with both the column and the row
+// dimensions sorted. This makes the queries placement tools issue most often
+// (rectangular walks and nearest free location in a column) proportional to
+// the size of the answer rather than the size of the device.
 //===----------------------------------------------------------------------===//
 
 PlacementDB::PlacementDB(mlir::ModuleOp topMod)
@@ -75,12 +75,32 @@ PlacementDB::PlacementDB(mlir::ModuleOp topMod)
 }
 PlacementDB::PlacementDB(mlir::ModuleOp topMod, const PrimitiveDB &seed)
     : ctxt(topMod->getContext()), topMod(topMod), seeded(false) {
-
-  seed.foreach ([this](PhysLocationAttr loc) { (void)getLeaf(loc); });
+  addSeedPrimitives(seed);
   seeded = true;
   addDesignPlacements();
 }
 
+/// Load all the primitive locations in bulk. The seed DB is unordered, so sort
+/// the locations first and append them to the sorted dimensions in order. This
+/// turns each insertion into an amortized constant time operation.
+void PlacementDB::addSeedPrimitives(const PrimitiveDB &seed) {
+  SmallVector<PhysLocationAttr> locs;
+  seed.foreach ([&locs](PhysLocationAttr loc) { locs.push_back(loc); });
+  llvm::sort(locs, [](PhysLocationAttr a, PhysLocationAttr b) {
+    return std::make_pair(a.getX(), a.getY()) <
+           std::make_pair(b.getX(), b.getY());
+  });
+
+  for (PhysLocationAttr loc : locs) {
+    DimYMap &rows =
+        placements.emplace_hint(placements.end(), loc.getX(), DimYMap())
+            ->second;
+    DimNumMap &nums = rows.emplace_hint(rows.end(), loc.getY(), DimNumMap())
+                          ->second;
+    (void)nums[loc.getNum()][loc.getPrimitiveType().getValue()];
+  }
+}
+
 /// Assign an instance to a primitive. Return null if another instance is
 /// already placed at that location
 PDPhysLocationOp PlacementDB::place(DynamicInstanceOp inst,
@@ -296,51 +316,102 @@ void PlacementDB::movePlacement(DynInstDataOpInterface op,
 
 /// Lookup the instance at a particular location.
 DynInstDataOpInterface PlacementDB::getInstanceAt(PhysLocationAttr loc) {
-  auto innerMap = placements[loc.getX()][loc.getY()][loc.getNum()];
-  auto instF = innerMap.find(loc.getPrimitiveType().getValue());
-  if (instF == innerMap.end())
-    return {};
-  if (!instF->getSecond().locOp)
+  PlacementCell *leaf = findLeaf(loc);
+  if (!leaf)
     return {};
-  return instF->getSecond().locOp;
+  return leaf->locOp;
 }
 
 PhysLocationAttr PlacementDB::getNearestFreeInColumn(PrimitiveType prim,
                                                      uint64_t columnNum,
                                                      uint64_t nearestToY) {
-  // Simplest possible algorithm.
-  PhysLocationAttr nearest = {};
-  walkPlacements(
-      [&nearest, nearestToY](PhysLocationAttr loc, Operation *locOp) {
-        if (locOp)
-          return;
-        if (!nearest) {
-          nearest = loc;
-          return;
-        }
-        int64_t curDist =
-            std::abs((int64_t)nearestToY - (int64_t)nearest.getY());
-        int64_t replDist = std::abs((int64_t)nearestToY - (int64_t)loc.getY());
-        if (replDist < curDist)
-          nearest = loc;
-      },
-      std::make_tuple(columnNum, columnNum, -1, -1), prim);
-  return nearest;
+  auto colF = placements.find(columnNum);
+  if (colF == placements.end())
+    return {};
+  DimYMap &rows = colF->second;
+
+  // Find a free slot of type 'prim' in a row, preferring the lowest slot
+  // number to keep the result deterministic.
+  auto findFree = [&](DimYMap::iterator rowF) -> PhysLocationAttr {
+    std::optional<size_t> freeNum;
+    for (auto &numF : rowF->second) {
+      auto devF = numF.second.find(prim);
+      if (devF == numF.second.end() || devF->second.locOp)
+        continue;
+      if (!freeNum || numF.first < *freeNum)
+        freeNum = numF.first;
+    }
+    if (!freeNum)
+      return {};
+    return PhysLocationAttr::get(ctxt, PrimitiveTypeAttr::get(ctxt, prim),
+                                 columnNum, rowF->first, *freeNum);
+  };
+
+  // Probe outwards from 'nearestToY', alternating between the closest
+  // remaining row above and below. 'up' points at the next candidate at or
+  // above 'nearestToY'; 'down' points one past the next candidate below.
+  auto up = rows.lower_bound(nearestToY);
+  auto down = up;
+  while (up != rows.end() || down != rows.begin()) {
+    bool takeDown = down != rows.begin();
+    if (takeDown && up != rows.end()) {
+      uint64_t downDist = nearestToY - std::prev(down)->first;
+      uint64_t upDist = up->first - nearestToY;
+      takeDown = downDist <= upDist;
+    }
+    if (takeDown) {
+      --down;
+      if (PhysLocationAttr loc = findFree(down))
+        return loc;
+    } else {
+      if (PhysLocationAttr loc = findFree(up))
+        return loc;
+      ++up;
+    }
+  }
+  return {};
 }
 
 PlacementDB::PlacementCell *PlacementDB::getLeaf(PhysLocationAttr loc) {
+  if (seeded)
+    return findLeaf(loc);
   PrimitiveType primType = loc.getPrimitiveType().getValue();
+  return &placements[loc.getX()][loc.getY()][loc.getNum()][primType];
+}
 
-  DimNumMap &nums = placements[loc.getX()][loc.getY()];
-  if (!seeded)
-    return &nums[loc.getNum()][primType];
-  if (!nums.count(loc.getNum()))
+PlacementDB::PlacementCell *PlacementDB::findLeaf(PhysLocationAttr loc) {
+  auto colF = placements.find(loc.getX());
+  if (colF == placements.end())
     return {};
-
-  DimDevType &primitives = nums[loc.getNum()];
-  if (primitives.count(primType) == 0)
+  auto rowF = colF->second.find(loc.getY());
+  if (rowF == colF->second.end())
     return {};
-  return &primitives[primType];
+  auto numF = rowF->second.find(loc.getNum());
+  if (numF == rowF->second.end())
+    return {};
+  auto devF = numF->second.find(loc.getPrimitiveType().getValue());
+  if (devF == numF->second.end())
+    return {};
+  return &devF->second;
+}
+
+/// Visit the entries of the sorted 'map' with keys in [min, max] (inclusive)
+/// in the order specified by 'direction'. No direction means ascending.
+template <typename MapTy, typename CallbackTy>
+static void walkSortedRange(MapTy &map, uint64_t min, uint64_t max,
+                            std::optional<PlacementDB::Direction> direction,
+                            CallbackTy callback) {
+  if (min > max)
+    return;
+  auto begin = map.lower_bound(min);
+  auto end = map.upper_bound(max);
+  if (direction == PlacementDB::Direction::DESC) {
+    for (auto &entry : llvm::reverse(llvm::make_range(begin, end)))
+      callback(entry);
+    return;
+  }
+  for (auto &entry : llvm::make_range(begin, end))
+    callback(entry);
 }
 
 /// Walker for placements.
@@ -355,66 +426,44 @@ void PlacementDB::walkPlacements(
   uint64_t ymax = std::get<3>(bounds) < 0 ? std::numeric_limits<uint64_t>::max()
                                           : (uint64_t)std::get<3>(bounds);
 
-  // TODO: Since the data structures we're using aren't sorted, the best we can
-  // do is iterate and filter. If a specific order is requested, we sort the
-  // keys by that as we go. Once we get to performance, we'll figure out the
-  // right data structure.
-
-  auto maybeSort = [](auto &container, auto direction) {
-    if (!direction.has_value())
-      return;
-    if (*direction == Direction::NONE)
-      return;
+  auto colOrder =
+      llvm::transformOptional(walkOrder, [](auto wo) { return wo.columns; });
+  auto rowOrder =
+      llvm::transformOptional(walkOrder, [](auto wo) { return wo.rows; });
 
-    llvm::sort(container, [direction](auto colA, auto colB) {
-      if (*direction == Direction::ASC)
-        return colA.first < colB.first;
-
-      return colA.first > colB.first;
-    });
-  };
+  // Collect the locations and their occupants first, since the callback may
+  // add, move, or remove placements and thereby invalidate iterators into the
+  // DB.
+  SmallVector<std::pair<PhysLocationAttr, DynInstDataOpInterface>> locs;
 
   // X loop.
-  SmallVector<std::pair<size_t, DimYMap>> cols(placements.begin(),
-                                               placements.end());
-  maybeSort(cols, llvm::transformOptional(walkOrder,
-                                          [](auto wo) { return wo.columns; }));
-  for (const auto &colF : cols) {
+  walkSortedRange(placements, xmin, xmax, colOrder, [&](auto &colF) {
     size_t x = colF.first;
-    if (x < xmin || x > xmax)
-      continue;
-    DimYMap yMap = colF.second;
 
     // Y loop.
-    SmallVector<std::pair<size_t, DimNumMap>> rows(yMap.begin(), yMap.end());
-    maybeSort(rows, llvm::transformOptional(walkOrder,
-                                            [](auto wo) { return wo.rows; }));
-    for (const auto &rowF : rows) {
+    walkSortedRange(colF.second, ymin, ymax, rowOrder, [&](auto &rowF) {
       size_t y = rowF.first;
-      if (y < ymin || y > ymax)
-        continue;
-      DimNumMap numMap = rowF.second;
 
       // Num loop.
-      for (auto &numF : numMap) {
+      for (auto &numF : rowF.second) {
         size_t num = numF.getFirst();
-        DimDevType devMap = numF.getSecond();
 
         // DevType loop.
-        for (auto &devF : devMap) {
+        for (auto &devF : numF.getSecond()) {
           PrimitiveType devtype = devF.getFirst();
           if (primType && devtype != *primType)
             continue;
-          PlacementCell &inst = devF.getSecond();
-
-          // Marshall and run the callback.
           PhysLocationAttr loc = PhysLocationAttr::get(
               ctxt, PrimitiveTypeAttr::get(ctxt, devtype), x, y, num);
-          callback(loc, inst.locOp);
+          locs.push_back({loc, devF.getSecond().locOp});
         }
       }
-    }
-  }
+    });
+  });
+
+  // Marshall and run the callback.
+  for (auto [loc, locOp] : locs)
+    callback(loc, locOp);
 }
 
 /// Walk the region placement information.
@@ -54,6 +54,11 @@ static OperationOp getLastOp(InstanceOp instOp, StringRef options) {
   return graphOp.lookupSymbol<OperationOp>(lastOpName);
 }
 
+// Determine whether the incremental variant of a scheduler was requested.
+static bool isIncremental(StringRef options) {
+  return llvm::is_contained(llvm::split(options, ','), "incremental");
+}
+
 // Determine desired cycle time (only relevant for `ChainingProblem` instances).
 static std::optional<float> getCycleTime(StringRef options) {
   for (StringRef option : llvm::split(options, ',')) {
@@ -98,6 +103,21 @@ static InstanceOp scheduleProblemTWithSimplex(InstanceOp instOp,
   return saveProblem(prob, builder);
 }
 
+// Schedule the basic problem with the incremental simplex scheduler. A single
+// call solves the problem from scratch; the re-optimization after changes to
+// the problem is exercised by `-test-incremental-simplex-scheduler`.
+static InstanceOp scheduleProblemWithIncrementalSimplex(InstanceOp instOp,
+                                                        Operation *lastOp,
+                                                        OpBuilder &builder) {
+  auto prob = loadProblem<Problem>(instOp);
+  if (failed(prob.check()))
+    return {};
+  IncrementalSimplexScheduler scheduler(prob, lastOp);
+  if (failed(scheduler.schedule()) || failed(prob.verify()))
+    return {};
+  return saveProblem(prob, builder);
+}
+
 static InstanceOp scheduleChainingProblemWithSimplex(InstanceOp instOp,
                                                      Operation *lastOp,
                                                      float cycleTime,
@@ -134,8 +154,11 @@ static InstanceOp scheduleWithSimplex(InstanceOp instOp, StringRef options,
   }
 
   auto problemName = instOp.getProblemName();
-  if (problemName == "Problem")
+  if (problemName == "Problem") {
+    if (isIncremental(options))
+      return scheduleProblemWithIncrementalSimplex(instOp, lastOp, builder);
     return scheduleProblemTWithSimplex<Problem>(instOp, lastOp, builder);
+  }
   if (problemName == "CyclicProblem")
     return scheduleProblemTWithSimplex<CyclicProblem>(instOp, lastOp, builder);
   if (problemName == "SharedOperatorsProblem")
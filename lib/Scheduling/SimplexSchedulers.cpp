@@ -154,6 +154,7 @@ protected:
                                  Problem::Dependence dep);
   virtual void fillAdditionalConstraintRow(SmallVector<int> &row,
                                            Problem::Dependence dep);
+  SmallVector<int> &addRow();
   void buildTableau();
 
   int getParametricConstant(unsigned row);
@@ -175,6 +176,10 @@ protected:
   void moveBy(unsigned startTimeVariable, unsigned amount);
   unsigned getStartTime(unsigned startTimeVariable);
 
+  void addConstraintRow(Problem::Dependence dep, unsigned slackVariable);
+  LogicalResult removeConstraintRow(unsigned slackVariable);
+  void shiftConstraint(unsigned slackVariable, int amount);
+
   void dumpTableau();
 
 public:
@@ -356,9 +361,25 @@ void SimplexSchedulerBase::fillAdditionalConstraintRow(
   (void)dep;
 }
 
+SmallVector<int> &SimplexSchedulerBase::addRow() {
+  // Grow both the tableau and the implicit column vector.
+  implicitBasicVariableColumnVector.push_back(0);
+  return tableau.emplace_back(nColumns, 0);
+}
+
 void SimplexSchedulerBase::buildTableau() {
   auto &prob = getProblem();
 
+  // Start from a clean slate, as the incremental scheduler may rebuild the
+  // tableau for a changed problem.
+  tableau.clear();
+  implicitBasicVariableColumnVector.clear();
+  nonBasicVariables.clear();
+  basicVariables.clear();
+  startTimeVariables.clear();
+  startTimeLocations.clear();
+  frozenVariables.clear();
+
   // The initial tableau is constructed so that operations' start time variables
   // are out of basis, whereas all slack variables are in basis. We will number
   // them accordingly.
@@ -375,12 +396,6 @@ void SimplexSchedulerBase::buildTableau() {
   // one column for each parameter (1,S,T), and for all operations
   nColumns = nParameters + nonBasicVariables.size();
 
-  // Helper to grow both the tableau and the implicit column vector.
-  auto addRow = [&]() -> SmallVector<int> & {
-    implicitBasicVariableColumnVector.push_back(0);
-    return tableau.emplace_back(nColumns, 0);
-  };
-
   // Set up the objective rows.
   nObjectives = 0;
   bool hasMoreObjectives;
@@ -772,6 +787,134 @@ unsigned SimplexSchedulerBase::getStartTime(unsigned startTimeVariable) {
   return getParametricConstant(-startTimeLocations[startTimeVariable]);
 }
 
+/// Add the constraint row modeling \p dep to an already solved tableau, with
+/// \p slackVariable in basis. The row is first filled in as it would appear in
+/// the initial tableau, and then expressed in terms of the current basis by
+/// substituting the rows of the start time variables that are in basis.
+/// Afterwards, the tableau is still dual feasible, but the new row may violate
+/// primal feasibility, which is restored by `solveTableau`.
+void SimplexSchedulerBase::addConstraintRow(Problem::Dependence dep,
+                                            unsigned slackVariable) {
+  unsigned nStartTimeVariables = startTimeLocations.size();
+
+  // Temporarily pretend that all start time variables are out of basis, in
+  // their initial columns, to reuse the subclass-specific row filling.
+  SmallVector<int> initialLocations;
+  for (unsigned stv = 0; stv < nStartTimeVariables; ++stv)
+    initialLocations.push_back(firstNonBasicVariableColumn + stv);
+  SmallVector<int> initialRow(nParameters + nStartTimeVariables, 0);
+  std::swap(startTimeLocations, initialLocations);
+  fillConstraintRow(initialRow, dep);
+  std::swap(startTimeLocations, initialLocations);
+
+  auto &row = addRow();
+  for (unsigned col = 0; col < nParameters; ++col)
+    row[col] = initialRow[col];
+
+  for (unsigned stv = 0; stv < nStartTimeVariables; ++stv) {
+    int coeff = initialRow[firstNonBasicVariableColumn + stv];
+    if (coeff == 0)
+      continue;
+
+    if (!isInBasis(stv)) {
+      row[startTimeLocations[stv]] += coeff;
+      // Frozen variables are offset by their time step (cf. `scheduleAt`).
+      auto it = frozenVariables.find(stv);
+      if (it != frozenVariables.end())
+        row[parameter1Column] -= coeff * (int)it->second;
+      continue;
+    }
+
+    // A basic variable's row reads `stv + sum(a_j * x_j) = b`, hence we
+    // substitute `stv` with `b - sum(a_j * x_j)`.
+    auto &basicRow = tableau[-startTimeLocations[stv]];
+    for (unsigned col = 0; col < nColumns; ++col)
+      row[col] -= coeff * basicRow[col];
+  }
+
+  basicVariables.push_back(slackVariable);
+  ++nRows;
+}
+
+/// Remove the constraint row associated with \p slackVariable from a solved
+/// tableau. If the slack variable is currently out of basis, it is first
+/// pivoted into basis in a way that maintains primal feasibility. Then, its row
+/// is dropped, and dual feasibility (i.e. optimality) is restored with primal
+/// pivot steps.
+LogicalResult
+SimplexSchedulerBase::removeConstraintRow(unsigned slackVariable) {
+  auto *colIt = llvm::find(nonBasicVariables, slackVariable);
+  if (colIt != nonBasicVariables.end()) {
+    unsigned pivotColumn =
+        firstNonBasicVariableColumn + (colIt - nonBasicVariables.begin());
+
+    // Prefer the regular ratio test on the positive entries. If there are
+    // none, pivot on the negative entry with the smallest parametric constant;
+    // this only decreases the constants of rows with a negative entry as well,
+    // which keeps them non-negative. The pivot row itself is dropped below.
+    auto pivotRow = findPrimalPivotRow(pivotColumn);
+    if (!pivotRow) {
+      int minConst = std::numeric_limits<int>::max();
+      for (unsigned row = firstConstraintRow; row < nRows; ++row) {
+        if (tableau[row][pivotColumn] >= 0)
+          continue;
+        int rowConst = getParametricConstant(row);
+        if (rowConst < minConst) {
+          minConst = rowConst;
+          pivotRow = row;
+        }
+      }
+    }
+
+    // The slack variable's column is a column of the inverted basis matrix,
+    // and hence cannot be all-zero.
+    assert(pivotRow && "slack variable column is empty");
+    pivot(*pivotRow, pivotColumn);
+  }
+
+  auto *rowIt = llvm::find(basicVariables, slackVariable);
+  assert(rowIt != basicVariables.end() && "unknown slack variable");
+  unsigned row = firstConstraintRow + (rowIt - basicVariables.begin());
+
+  tableau.erase(tableau.begin() + row);
+  implicitBasicVariableColumnVector.erase(
+      implicitBasicVariableColumnVector.begin() + row);
+  basicVariables.erase(rowIt);
+  --nRows;
+
+  // Basic start time variables below the removed row move up by one row.
+  for (int &loc : startTimeLocations)
+    if (loc < 0 && -loc > (int)row)
+      ++loc;
+
+  return restoreDualFeasibility();
+}
+
+/// Add \p amount to the constant term of the constraint associated with
+/// \p slackVariable, as it appeared in the initial tableau. In the current
+/// tableau, the change is scaled by the slack variable's column of the inverted
+/// basis matrix, which is either a unit vector (if the slack variable is in
+/// basis) or its explicitly stored column. If the slack variable is out of
+/// basis, the constant terms of the objective rows change as well, i.e. the
+/// objective value is updated. Only constant terms change, so the reduced costs
+/// are unaffected and the tableau stays dual feasible.
+void SimplexSchedulerBase::shiftConstraint(unsigned slackVariable,
+                                           int amount) {
+  auto *rowIt = llvm::find(basicVariables, slackVariable);
+  if (rowIt != basicVariables.end()) {
+    unsigned row = firstConstraintRow + (rowIt - basicVariables.begin());
+    tableau[row][parameter1Column] += amount;
+    return;
+  }
+
+  auto *colIt = llvm::find(nonBasicVariables, slackVariable);
+  assert(colIt != nonBasicVariables.end() && "unknown slack variable");
+  unsigned column =
+      firstNonBasicVariableColumn + (colIt - nonBasicVariables.begin());
+  translate(column, /* factor1= */ -amount, /* factorS= */ 0,
+            /* factorT= */ 0);
+}
+
 void SimplexSchedulerBase::dumpTableau() {
   for (unsigned j = 0; j < nColumns; ++j)
     dbgs() << "====";
@@ -833,6 +976,150 @@ LogicalResult SimplexScheduler::schedule() {
   return success();
 }
 
+//===----------------------------------------------------------------------===//
+// IncrementalSimplexScheduler
+//===----------------------------------------------------------------------===//
+
+/// This class extends the `SimplexScheduler` with the ability to apply changes
+/// of the problem's dependences and operator latencies to a solved tableau, and
+/// to re-optimize from the previous basis instead of starting from scratch.
+class scheduling::IncrementalSimplexScheduler::Impl : public SimplexScheduler {
+public:
+  Impl(Problem &prob, Operation *lastOp) : SimplexScheduler(prob, lastOp) {}
+  LogicalResult schedule() override;
+
+private:
+  bool needsRebuild();
+  LogicalResult rebuild();
+  LogicalResult update();
+
+  /// The slack variable of a dependence's constraint row, and the latency that
+  /// is currently modeled in the tableau.
+  struct Constraint {
+    unsigned slackVariable;
+    unsigned latency;
+  };
+  DenseMap<Problem::Dependence, Constraint> constraints;
+
+  /// The next unused variable number for new slack variables.
+  unsigned nextVariable = 0;
+
+  /// Whether the tableau holds the optimal solution for a previous version of
+  /// the problem.
+  bool isSolved = false;
+};
+
+static unsigned getSourceLatency(Problem &prob, Problem::Dependence dep) {
+  return *prob.getLatency(*prob.getLinkedOperatorType(dep.getSource()));
+}
+
+bool scheduling::IncrementalSimplexScheduler::Impl::needsRebuild() {
+  if (!isSolved)
+    return true;
+
+  // The start time variables correspond to the tableau's columns, so any change
+  // to the set of operations invalidates the tableau.
+  auto &ops = getProblem().getOperations();
+  return ops.size() != startTimeVariables.size() ||
+         llvm::any_of(ops, [&](Operation *op) {
+           return !startTimeVariables.count(op);
+         });
+}
+
+LogicalResult scheduling::IncrementalSimplexScheduler::Impl::rebuild() {
+  auto &prob = getProblem();
+  parameterS = 0;
+  parameterT = 0;
+  buildTableau();
+
+  // `buildTableau` numbers the slack variables in the order of the dependences,
+  // following the start time variables.
+  constraints.clear();
+  nextVariable = startTimeLocations.size();
+  for (auto *op : prob.getOperations())
+    for (auto &dep : prob.getDependences(op))
+      constraints[dep] = {nextVariable++, getSourceLatency(prob, dep)};
+
+  LLVM_DEBUG(dbgs() << "Initial tableau:\n"; dumpTableau());
+
+  return solveTableau();
+}
+
+LogicalResult scheduling::IncrementalSimplexScheduler::Impl::update() {
+  auto &prob = getProblem();
+
+  // Determine which constraints were added, removed, or changed since the last
+  // invocation.
+  DenseSet<Problem::Dependence> live;
+  SmallVector<Problem::Dependence> added, removed;
+  SmallVector<std::pair<unsigned, int>> shifted;
+  for (auto *op : prob.getOperations()) {
+    for (auto &dep : prob.getDependences(op)) {
+      live.insert(dep);
+      auto it = constraints.find(dep);
+      if (it == constraints.end()) {
+        added.push_back(dep);
+        continue;
+      }
+      unsigned latency = getSourceLatency(prob, dep);
+      if (latency != it->second.latency) {
+        // Note that the latency is negated in the tableau.
+        shifted.emplace_back(it->second.slackVariable,
+                             (int)it->second.latency - (int)latency);
+        it->second.latency = latency;
+      }
+    }
+  }
+  for (auto &it : constraints)
+    if (!live.contains(it.first))
+      removed.push_back(it.first);
+
+  LLVM_DEBUG(dbgs() << "Updating tableau: " << added.size() << " added, "
+                    << removed.size() << " removed, " << shifted.size()
+                    << " changed constraints\n");
+
+  // Removing constraints maintains primal feasibility, and the tableau is
+  // re-optimized with primal pivot steps after each removal.
+  for (auto dep : removed) {
+    if (failed(removeConstraintRow(constraints[dep].slackVariable)))
+      return failure();
+    constraints.erase(dep);
+  }
+
+  // Changing latencies and adding constraints maintains dual feasibility, so
+  // optimality is restored with dual pivot steps, starting from the previous
+  // basis.
+  for (auto [slackVariable, amount] : shifted)
+    shiftConstraint(slackVariable, amount);
+  for (auto dep : added) {
+    addConstraintRow(dep, nextVariable);
+    constraints[dep] = {nextVariable++, getSourceLatency(prob, dep)};
+  }
+
+  return solveTableau();
+}
+
+LogicalResult scheduling::IncrementalSimplexScheduler::Impl::schedule() {
+  auto &prob = getProblem();
+  if (failed(checkLastOp()))
+    return failure();
+
+  isSolved = succeeded(needsRebuild() ? rebuild() : update());
+  if (!isSolved)
+    return prob.getContainingOp()->emitError() << "problem is infeasible";
+
+  assert(parameterT == 0);
+  LLVM_DEBUG(
+      dbgs() << "Final tableau:\n"; dumpTableau();
+      dbgs() << "Optimal solution found with start time of last operation = "
+             << -getParametricConstant(0) << '\n');
+
+  for (auto *op : prob.getOperations())
+    prob.setStartTime(op, getStartTime(startTimeVariables[op]));
+
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // CyclicSimplexScheduler
 //===----------------------------------------------------------------------===//
@@ -1336,6 +1623,17 @@ LogicalResult scheduling::scheduleSimplex(Problem &prob, Operation *lastOp) {
   return simplex.schedule();
 }
 
+scheduling::IncrementalSimplexScheduler::IncrementalSimplexScheduler(
+    Problem &prob, Operation *lastOp)
+    : impl(std::make_unique<Impl>(prob, lastOp)) {}
+
+scheduling::IncrementalSimplexScheduler::~IncrementalSimplexScheduler() =
+    default;
+
+LogicalResult scheduling::IncrementalSimplexScheduler::schedule() {
+  return impl->schedule();
+}
+
 LogicalResult scheduling::scheduleSimplex(CyclicProblem &prob,
                                           Operation *lastOp) {
   CyclicSimplexScheduler simplex(prob, lastOp);
@@ -14,6 +14,19 @@ using namespace circt;
 using namespace igraph;
 
 void InstanceRecord::erase() {
+  // Point the index of the parent at the next record of the same instance, if
+  // there is one.
+  if (auto *op = instance.getOperation()) {
+    auto &index = parent->instanceIndex;
+    auto it = index.find(op);
+    if (it != index.end() && it->second == this) {
+      auto next = std::next(InstanceGraphNode::InstanceList::iterator(this));
+      if (next != parent->instances.end() && next->instance == instance)
+        it->second = &*next;
+      else
+        index.erase(it);
+    }
+  }
   // Update the prev node to point to the next node.
   if (prevUse)
     prevUse->nextUse = nextUse;
@@ -29,6 +42,18 @@ InstanceRecord *InstanceGraphNode::addInstance(InstanceOpInterface instance,
                                                InstanceGraphNode *target) {
   auto *instanceRecord = new InstanceRecord(this, instance, target);
   target->recordUse(instanceRecord);
+  // Keep the records of an instance next to each other, such that all of them
+  // can be found through the index.
+  if (auto *op = instance.getOperation()) {
+    auto [it, inserted] = instanceIndex.try_emplace(op, instanceRecord);
+    if (!inserted) {
+      auto pos = std::next(InstanceList::iterator(it->second));
+      while (pos != instances.end() && pos->instance == instance)
+        ++pos;
+      instances.insert(pos, instanceRecord);
+      return instanceRecord;
+    }
+  }
   instances.push_back(instanceRecord);
   return instanceRecord;
 }
@@ -77,6 +102,7 @@ InstanceGraph::InstanceGraph(Operation *parent) : parent(parent) {
     auto name = module.getModuleNameAttr();
     auto *currentNode = getOrAddNode(name);
     currentNode->module = module;
+    moduleNames[module] = name;
     for (auto instanceOp : instances) {
       // Add an edge to indicate that this module instantiates the target.
       for (auto targetNameAttr : instanceOp.getReferencedModuleNamesAttr()) {
@@ -88,11 +114,16 @@ InstanceGraph::InstanceGraph(Operation *parent) : parent(parent) {
 }
 
 InstanceGraphNode *InstanceGraph::addModule(ModuleOpInterface module) {
-  assert(!nodeMap.count(module.getModuleNameAttr()) && "module already added");
-  auto *node = new InstanceGraphNode();
+  // Instances may have referred to the module before it was added, in which
+  // case there already is a node without a module.
+  auto *&node = nodeMap[module.getModuleNameAttr()];
+  assert((!node || !node->module) && "module already added");
+  if (!node) {
+    node = new InstanceGraphNode();
+    nodes.push_back(node);
+  }
   node->module = module;
-  nodeMap[module.getModuleNameAttr()] = node;
-  nodes.push_back(node);
+  moduleNames[module] = module.getModuleNameAttr();
   return node;
 }
 
@@ -103,6 +134,7 @@ void InstanceGraph::erase(InstanceGraphNode *node) {
   for (auto *instance : llvm::make_early_inc_range(*node))
     instance->erase();
   nodeMap.erase(node->getModule().getModuleNameAttr());
+  moduleNames.erase(node->getModule());
   nodes.erase(node);
 }
 
@@ -116,6 +148,15 @@ InstanceGraphNode *InstanceGraph::lookup(ModuleOpInterface op) {
   return lookup(cast<ModuleOpInterface>(op).getModuleNameAttr());
 }
 
+InstanceGraphNode *InstanceGraph::lookupOrNull(ModuleOpInterface op) {
+  if (!op || op->getParentOp() != parent)
+    return nullptr;
+  auto *node = nodeMap.lookup(op.getModuleNameAttr());
+  if (!node || node->getModule() != op)
+    return nullptr;
+  return node;
+}
+
 void InstanceGraph::replaceInstance(InstanceOpInterface inst,
                                     InstanceOpInterface newInst) {
   assert(inst.getReferencedModuleNamesAttr() ==
@@ -123,6 +164,7 @@ void InstanceGraph::replaceInstance(InstanceOpInterface inst,
          "Both instances must be targeting the same modules");
 
   // Replace all edges between the module of the instance and all targets.
+  InstanceGraphNode *parentNode = nullptr;
   for (Attribute targetNameAttr : inst.getReferencedModuleNamesAttr()) {
     // Find the instance record of this instance.
     auto *node = lookup(cast<StringAttr>(targetNameAttr));
@@ -131,9 +173,69 @@ void InstanceGraph::replaceInstance(InstanceOpInterface inst,
         // We can just replace the instance op in the InstanceRecord without
         // updating any instance lists.
         record->instance = newInst;
+        parentNode = record->getParent();
       }
     }
   }
+
+  // The records stay in place, so the first one is still the first one.
+  if (!parentNode)
+    return;
+  auto &index = parentNode->instanceIndex;
+  if (auto *first = index.lookup(inst)) {
+    index.erase(inst);
+    index[newInst] = first;
+  }
+}
+
+void InstanceGraph::addInstance(InstanceOpInterface inst) {
+  auto *node = lookupOrNull(inst->getParentOfType<ModuleOpInterface>());
+  if (!node || node->instanceIndex.contains(inst))
+    return;
+  for (auto targetNameAttr : inst.getReferencedModuleNamesAttr())
+    node->addInstance(inst, getOrAddNode(cast<StringAttr>(targetNameAttr)));
+}
+
+void InstanceGraph::removeInstance(InstanceOpInterface inst,
+                                   ModuleOpInterface module) {
+  auto *node = lookupOrNull(module);
+  if (!node)
+    return;
+  auto *first = node->instanceIndex.lookup(inst);
+  if (!first)
+    return;
+  // Erasing a record moves the index on to the next record of the instance.
+  auto it = InstanceGraphNode::InstanceList::iterator(first);
+  while (it != node->instances.end() && it->instance == inst)
+    (it++)->erase();
+}
+
+void InstanceGraph::renameModule(ModuleOpInterface module) {
+  auto it = moduleNames.find(module);
+  if (it == moduleNames.end())
+    return;
+  auto oldName = it->second;
+  auto newName = module.getModuleNameAttr();
+  if (oldName == newName)
+    return;
+  it->second = newName;
+  auto *node = nodeMap.lookup(oldName);
+  nodeMap.erase(oldName);
+
+  // Instances which already refer to the new name have been recorded on a
+  // placeholder node without a module. Move them over to the renamed module.
+  auto *&slot = nodeMap[newName];
+  if (auto *placeholder = slot) {
+    assert(!placeholder->module && "module renamed to an existing module");
+    for (auto *record : llvm::make_early_inc_range(placeholder->uses())) {
+      auto *parentNode = record->getParent();
+      auto inst = record->getInstance();
+      record->erase();
+      parentNode->addInstance(inst, node);
+    }
+    nodes.erase(placeholder);
+  }
+  slot = node;
 }
 
 bool InstanceGraph::isAncestor(
@@ -225,6 +327,85 @@ InstanceGraph::getInferredTopLevelNodes() {
   return {inferredTopLevelNodes};
 }
 
+/// Get the module containing a block, if any.
+static ModuleOpInterface getEnclosingModule(Block *block) {
+  auto *op = block->getParentOp();
+  if (!op)
+    return {};
+  if (auto module = dyn_cast<ModuleOpInterface>(op))
+    return module;
+  return op->getParentOfType<ModuleOpInterface>();
+}
+
+void InstanceGraphListener::notifyOperationInserted(
+    Operation *op, mlir::OpBuilder::InsertPoint previous) {
+  // A moved instance is removed from its old module and added to its new one.
+  if (auto inst = dyn_cast<InstanceOpInterface>(op)) {
+    if (previous.isSet())
+      instanceGraph.removeInstance(inst,
+                                   getEnclosingModule(previous.getBlock()));
+    instanceGraph.addInstance(inst);
+    return;
+  }
+
+  // Builders notify about the ops nested in a cloned module before the module
+  // itself is inserted, so its instances are added together with the module.
+  // A clone which still carries the name of the original module is added
+  // once it is renamed.
+  if (auto module = dyn_cast<ModuleOpInterface>(op)) {
+    if (previous.isSet() || op->getParentOp() != instanceGraph.getParent())
+      return;
+    auto *node = instanceGraph.nodeMap.lookup(module.getModuleNameAttr());
+    if (node && node->getModule()) {
+      unnamedClones.insert(op);
+      return;
+    }
+    addModule(module);
+  }
+}
+
+void InstanceGraphListener::addModule(ModuleOpInterface module) {
+  instanceGraph.addModule(module);
+  module.walk(
+      [&](InstanceOpInterface inst) { instanceGraph.addInstance(inst); });
+}
+
+void InstanceGraphListener::notifyOperationModified(Operation *op) {
+  // The modules referenced by the instance may have changed.
+  if (auto inst = dyn_cast<InstanceOpInterface>(op)) {
+    instanceGraph.removeInstance(inst,
+                                 op->getParentOfType<ModuleOpInterface>());
+    instanceGraph.addInstance(inst);
+    return;
+  }
+
+  // The module may have been renamed.
+  if (auto module = dyn_cast<ModuleOpInterface>(op)) {
+    if (!unnamedClones.contains(op)) {
+      instanceGraph.renameModule(module);
+      return;
+    }
+    auto *node = instanceGraph.nodeMap.lookup(module.getModuleNameAttr());
+    if (node && node->getModule())
+      return;
+    unnamedClones.erase(op);
+    addModule(module);
+  }
+}
+
+void InstanceGraphListener::notifyOperationErased(Operation *op) {
+  if (auto inst = dyn_cast<InstanceOpInterface>(op)) {
+    instanceGraph.removeInstance(inst,
+                                 op->getParentOfType<ModuleOpInterface>());
+    return;
+  }
+  if (auto module = dyn_cast<ModuleOpInterface>(op)) {
+    unnamedClones.erase(op);
+    if (auto *node = instanceGraph.lookupOrNull(module))
+      instanceGraph.erase(node);
+  }
+}
+
 static InstancePath empty{};
 
 ArrayRef<InstancePath>
@@ -248,15 +429,20 @@ InstancePathCache::getAbsolutePaths(ModuleOpInterface op,
     return cached->second;
 
   // For each instance, collect the instance paths to its parent and append the
-  // instance itself to each.
+  // instance itself to each. Only the paths to modules that instantiate other
+  // modules are extended later on, so only those reserve room to do so in
+  // place. The paths to leaf modules, which are the vast majority, are
+  // allocated tightly.
+  bool reserve = node->begin() != node->end();
   SmallVector<InstancePath, 8> extendedPaths;
   for (auto *inst : node->uses()) {
     if (auto module = inst->getParent()->getModule()) {
       auto instPaths = getAbsolutePaths(module);
       extendedPaths.reserve(instPaths.size());
       for (auto path : instPaths) {
-        extendedPaths.push_back(appendInstance(
-            path, cast<InstanceOpInterface>(*inst->getInstance())));
+        extendedPaths.push_back(
+            extendPath(path, cast<InstanceOpInterface>(*inst->getInstance()),
+                       /*atFront=*/false, reserve));
       }
     } else {
       extendedPaths.emplace_back(empty);
@@ -304,22 +490,54 @@ void InstancePath::print(llvm::raw_ostream &into) const {
   }
 }
 
+InstancePath InstancePathCache::extendPath(InstancePath path,
+                                           InstanceOpInterface inst,
+                                           bool atFront, bool reserve) {
+  size_t n = path.size() + 1;
+  auto &space = atFront ? spaceBefore : spaceAfter;
+
+  // Grow into the free slot next to the path if no other path claimed it yet.
+  // The paths sharing the storage only ever see the slots before their end
+  // and after their start, so writing the slot does not change any of them.
+  const auto *edge = atFront ? path.path.begin() : path.path.end();
+  if (auto it = space.find(edge); it != space.end()) {
+    size_t numFree = it->second;
+    space.erase(it);
+    auto *slot = const_cast<InstanceOpInterface *>(atFront ? edge - 1 : edge);
+    *slot = inst;
+    if (numFree > 1)
+      space.insert({atFront ? slot : slot + 1, numFree - 1});
+    return InstancePath(ArrayRef(atFront ? slot : path.path.data(), n));
+  }
+
+  // Otherwise copy the path into new storage. Reserving as many free slots as
+  // the path is long makes growing a path one level at a time copy it only a
+  // logarithmic number of times, rather than once per level.
+  size_t numFree = reserve ? n : 0;
+  auto *storage = allocator.Allocate<InstanceOpInterface>(n + numFree);
+  if (atFront) {
+    auto *newPath = storage + numFree;
+    newPath[0] = inst;
+    std::copy(path.begin(), path.end(), newPath + 1);
+    if (numFree)
+      space.insert({newPath, numFree});
+    return InstancePath(ArrayRef(newPath, n));
+  }
+  std::copy(path.begin(), path.end(), storage);
+  storage[n - 1] = inst;
+  if (numFree)
+    space.insert({storage + n, numFree});
+  return InstancePath(ArrayRef(storage, n));
+}
+
 InstancePath InstancePathCache::appendInstance(InstancePath path,
                                                InstanceOpInterface inst) {
-  size_t n = path.size() + 1;
-  auto *newPath = allocator.Allocate<InstanceOpInterface>(n);
-  std::copy(path.begin(), path.end(), newPath);
-  newPath[path.size()] = inst;
-  return InstancePath(ArrayRef(newPath, n));
+  return extendPath(path, inst, /*atFront=*/false, /*reserve=*/false);
 }
 
 InstancePath InstancePathCache::prependInstance(InstanceOpInterface inst,
                                                 InstancePath path) {
-  size_t n = path.size() + 1;
-  auto *newPath = allocator.Allocate<InstanceOpInterface>(n);
-  std::copy(path.begin(), path.end(), newPath + 1);
-  newPath[0] = inst;
-  return InstancePath(ArrayRef(newPath, n));
+  return extendPath(path, inst, /*atFront=*/true, /*reserve=*/false);
 }
 
 void InstancePathCache::replaceInstance(InstanceOpInterface oldOp,
@@ -0,0 +1,993 @@
+//===- CIRCTServer.cpp - Incremental CIRCT document server ----------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "CIRCTServer.h"
+#include "circt/Support/InstanceGraphInterface.h"
+#include "mlir/AsmParser/AsmParser.h"
+#include "mlir/AsmParser/AsmParserState.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Threading.h"
+#include "mlir/IR/Verifier.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/SourceMgr.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <optional>
+
+using namespace mlir;
+using namespace circt;
+
+using mlir::lsp::DocumentSymbol;
+using mlir::lsp::Hover;
+using mlir::lsp::Position;
+using mlir::lsp::Range;
+using mlir::lsp::URIForFile;
+
+//===----------------------------------------------------------------------===//
+// Document Splitting
+//===----------------------------------------------------------------------===//
+//
+// Documents are split into chunks along the top-level operations nested in
+// container operations like `builtin.module` and `firrtl.circuit`. Splitting is
+// purely textual: a chunk starts on a line that begins a new operation at the
+// nesting depth of the innermost container body, and extends until the
+// brackets opened on that line are closed again. Each chunk is parsed on its
+// own, wrapped in copies of its container operations' headers.
+//
+// Attribute and type alias definitions like `#loc = loc(...)` and `!t = i32`
+// are not operations and may only appear at the top level of a document, but
+// any chunk may use them. They are therefore collected separately and prepended
+// to every chunk when it is parsed.
+//
+//===----------------------------------------------------------------------===//
+
+/// Return the change in bracket nesting depth caused by a line of IR, ignoring
+/// brackets in string literals and comments. Angle brackets are only counted if
+/// `countAngles` is set, since operations commonly contain `->` and comparison
+/// predicates, whereas a type or attribute may span multiple lines inside them.
+static int getNestingDelta(StringRef line, bool countAngles = false) {
+  int delta = 0;
+  for (size_t i = 0, e = line.size(); i < e; ++i) {
+    char c = line[i];
+    if (c == '"') {
+      for (++i; i < e && line[i] != '"'; ++i)
+        if (line[i] == '\\')
+          ++i;
+      continue;
+    }
+    if (c == '/' && i + 1 < e && line[i + 1] == '/')
+      break;
+    if (c == '{' || c == '(' || c == '[')
+      ++delta;
+    else if (c == '}' || c == ')' || c == ']')
+      --delta;
+    else if (countAngles && c == '<')
+      ++delta;
+    else if (countAngles && c == '>' && (i == 0 || line[i - 1] != '-'))
+      --delta;
+  }
+  return delta;
+}
+
+/// Return true if `line` starts an operation with the given name.
+static bool startsWithOp(StringRef line, StringRef opName) {
+  if (!line.consume_front(opName))
+    return false;
+  return line.empty() || line.front() == ' ' || line.front() == '{';
+}
+
+/// Return true if `line` starts a builtin module.
+static bool isBuiltinModule(StringRef line) {
+  return startsWithOp(line, "module") || startsWithOp(line, "builtin.module");
+}
+
+/// Return true if `line` starts an operation whose body contains the top-level
+/// operations a document is split into.
+static bool isContainerOp(StringRef line) {
+  return isBuiltinModule(line) || startsWithOp(line, "firrtl.circuit");
+}
+
+namespace {
+/// A top-level operation found while splitting a document.
+struct ChunkSpan {
+  /// The text of the operation, including the trailing newline.
+  StringRef text;
+  /// The document line the operation starts on.
+  unsigned startLine;
+  /// The headers of the enclosing container operations, used to parse the
+  /// operation in its proper context, and the number of containers.
+  std::string header;
+  unsigned wrapperDepth = 0;
+  /// A hash of the text and header, used to find reusable chunks.
+  llvm::hash_code hash;
+};
+
+/// The attribute and type alias definitions of a document.
+struct AliasDefinitions {
+  /// The text of all definitions, each one ending in a newline.
+  std::string text;
+  /// The document line of every line of `text`.
+  std::vector<unsigned> lines;
+};
+} // namespace
+
+/// Return true if `line` starts an attribute or type alias definition.
+static bool isAliasDefinition(StringRef line) {
+  return line.starts_with("#") || line.starts_with("!");
+}
+
+/// Split `contents` into its top-level operations and alias definitions.
+static void splitDocument(StringRef contents, std::vector<ChunkSpan> &spans,
+                          AliasDefinitions &aliases) {
+  // The headers of the containers enclosing the current line, together with
+  // the nesting depth of their bodies.
+  SmallVector<std::pair<StringRef, int>, 2> containers;
+  enum class State { Idle, InHeader, InChunk, InAlias } state = State::Idle;
+  size_t startOffset = 0;
+  unsigned startLine = 0;
+  int startDepth = 0;
+  int depth = 0;
+
+  auto finishChunk = [&](size_t endOffset) {
+    ChunkSpan span;
+    span.text = contents.slice(startOffset, endOffset);
+    span.startLine = startLine;
+    // Wrap everything in a builtin module if the containers don't already
+    // start with one, which mirrors the implicit module the parser creates.
+    if (containers.empty() || !isBuiltinModule(containers[0].first.trim())) {
+      span.header = "module {\n";
+      ++span.wrapperDepth;
+    }
+    for (auto &container : containers) {
+      span.header += container.first;
+      if (!container.first.ends_with("\n"))
+        span.header += '\n';
+      ++span.wrapperDepth;
+    }
+    span.hash = llvm::hash_combine(span.header, span.text);
+    spans.push_back(std::move(span));
+  };
+
+  auto finishAlias = [&](size_t endOffset) {
+    StringRef text = contents.slice(startOffset, endOffset);
+    unsigned numLines = text.count('\n') + (text.ends_with("\n") ? 0 : 1);
+    for (unsigned i = 0; i < numLines; ++i)
+      aliases.lines.push_back(startLine + i);
+    aliases.text += text;
+    if (!text.ends_with("\n"))
+      aliases.text += '\n';
+  };
+
+  size_t offset = 0;
+  for (unsigned lineNo = 0;; ++lineNo) {
+    size_t eol = contents.find('\n', offset);
+    size_t next = eol == StringRef::npos ? contents.size() : eol + 1;
+    StringRef line = contents.slice(offset, next);
+    StringRef trimmed = line.trim();
+
+    // Check whether this line starts a new operation.
+    int bodyDepth = containers.empty() ? 0 : containers.back().second;
+    if (state == State::Idle && depth == bodyDepth && !trimmed.empty() &&
+        !trimmed.starts_with("//") && !trimmed.starts_with("}")) {
+      // Stop at the file metadata dictionary, which is not an operation.
+      if (trimmed.starts_with("{-#"))
+        break;
+      if (containers.empty() && isAliasDefinition(trimmed))
+        state = State::InAlias;
+      else if (isContainerOp(trimmed))
+        state = State::InHeader;
+      else
+        state = State::InChunk;
+      startOffset = offset;
+      startLine = lineNo;
+      startDepth = depth;
+    }
+
+    depth += getNestingDelta(line, state == State::InAlias);
+    while (!containers.empty() && depth < containers.back().second)
+      containers.pop_back();
+
+    if (state == State::InHeader) {
+      // The container's body starts once the header opened a bracket. A
+      // container that is closed on the same line is empty.
+      if (depth > startDepth)
+        containers.push_back({contents.slice(startOffset, next), depth});
+      state = State::Idle;
+    } else if (state == State::InChunk && depth <= startDepth) {
+      finishChunk(next);
+      state = State::Idle;
+    } else if (state == State::InAlias && depth <= startDepth) {
+      finishAlias(next);
+      state = State::Idle;
+    }
+
+    if (eol == StringRef::npos)
+      break;
+    offset = next;
+  }
+
+  // Keep an unterminated operation at the end of the document, which is
+  // common while the user is typing.
+  if (state == State::InChunk)
+    finishChunk(contents.size());
+  else if (state == State::InAlias)
+    finishAlias(contents.size());
+}
+
+//===----------------------------------------------------------------------===//
+// Symbol Scanning
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// The role of a symbol name token in the text of a chunk.
+enum class TokenKind {
+  /// The symbol defined by the chunk's top-level operation.
+  Definition,
+  /// A reference to a top-level symbol.
+  Reference,
+  /// An inner symbol defined in the chunk, such as `sym @x`.
+  InnerDefinition,
+  /// A reference to an inner symbol, such as the `@x` in `@Foo::@x`.
+  InnerReference,
+};
+
+/// A symbol name token in the text of a chunk.
+struct SymbolToken {
+  TokenKind kind;
+  /// The name of the symbol, without the `@` and quotes.
+  StringRef name;
+  /// For inner symbol references, the name of the surrounding module.
+  StringRef parent;
+  /// The position of the token relative to the start of the chunk.
+  unsigned line;
+  unsigned column;
+  unsigned length;
+};
+} // namespace
+
+static bool isIdentifierChar(char c) {
+  return llvm::isAlnum(c) || c == '_' || c == '$' || c == '.' || c == '-';
+}
+
+/// Collect all symbol name tokens in `text`.
+static void scanSymbolTokens(StringRef text,
+                             SmallVectorImpl<SymbolToken> &tokens) {
+  unsigned line = 0;
+  size_t lineStart = 0;
+  // Whether we are in the `[...]` list following a `sym` keyword, and whether
+  // the next token directly follows a `sym` keyword.
+  bool inSymList = false;
+  bool afterSym = false;
+
+  for (size_t i = 0, e = text.size(); i < e; ++i) {
+    char c = text[i];
+    if (c == '\n') {
+      ++line;
+      lineStart = i + 1;
+      continue;
+    }
+    if (c == '"') {
+      for (++i; i < e && text[i] != '"' && text[i] != '\n'; ++i)
+        if (text[i] == '\\')
+          ++i;
+      continue;
+    }
+    if (c == '/' && i + 1 < e && text[i + 1] == '/') {
+      while (i + 1 < e && text[i + 1] != '\n')
+        ++i;
+      continue;
+    }
+    if (c == ']') {
+      inSymList = false;
+      continue;
+    }
+    if (c == 's' && text.substr(i).starts_with("sym ") &&
+        (i == 0 || !isIdentifierChar(text[i - 1]))) {
+      size_t j = text.find_first_not_of(' ', i + 3);
+      if (j != StringRef::npos && text[j] == '[')
+        inSymList = true;
+      else
+        afterSym = true;
+      i += 2;
+      continue;
+    }
+    if (c != '@')
+      continue;
+
+    // Lex the symbol name, which is either a string or an identifier.
+    size_t start = i + 1, end = start;
+    StringRef name;
+    if (end < e && text[end] == '"') {
+      end = text.find('"', start + 1);
+      if (end == StringRef::npos)
+        break;
+      name = text.slice(start + 1, end);
+      ++end;
+    } else {
+      while (end < e && isIdentifierChar(text[end]))
+        ++end;
+      name = text.slice(start, end);
+    }
+    if (name.empty()) {
+      afterSym = false;
+      continue;
+    }
+
+    SymbolToken token;
+    token.kind = TokenKind::Reference;
+    token.name = name;
+    token.line = line;
+    token.column = i - lineStart;
+    token.length = end - i;
+    if (afterSym || (inSymList && i > 0 && text[i - 1] == '<')) {
+      token.kind = TokenKind::InnerDefinition;
+    } else if (i >= 2 && text.substr(i - 2, 2) == "::" && !tokens.empty() &&
+               tokens.back().line == line &&
+               tokens.back().column + tokens.back().length + 2 ==
+                   token.column) {
+      token.kind = TokenKind::InnerReference;
+      token.parent = tokens.back().name;
+    }
+    afterSym = false;
+    tokens.push_back(token);
+    i = end - 1;
+  }
+
+  // The first symbol on the first line of the chunk is the symbol defined by
+  // the chunk's operation, as long as it precedes the operation's operands,
+  // attributes, and regions. This covers `hw.module @Foo(`, `firrtl.module
+  // private @Foo(`, `hw.hierpath private @xmr [`, and similar.
+  if (tokens.empty() || tokens.front().line != 0 ||
+      tokens.front().kind != TokenKind::Reference)
+    return;
+  StringRef firstLine = text.take_until([](char c) { return c == '\n'; });
+  size_t bodyStart = firstLine.find_first_of("({[\"=");
+  if (bodyStart == StringRef::npos || tokens.front().column < bodyStart)
+    tokens.front().kind = TokenKind::Definition;
+}
+
+//===----------------------------------------------------------------------===//
+// Chunk
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// A top-level operation of a document that is parsed independently of the
+/// rest of the document. Chunks are reused across edits as long as their text,
+/// their enclosing containers, and the document's alias definitions do not
+/// change; only their position in the document is updated.
+struct Chunk {
+  Chunk(const ChunkSpan &span, std::shared_ptr<const std::string> aliases,
+        unsigned id);
+
+  /// Parse and verify the chunk, and extract its instances.
+  void parse(MLIRContext &context);
+  /// Record a diagnostic emitted while parsing or verifying the chunk.
+  void addDiagnostic(Diagnostic &diag);
+
+  /// Convert a position in the document to a location in the parsed buffer.
+  SMLoc getSMLoc(const Position &pos);
+  /// Convert a range in the parsed buffer to a range in the document.
+  Range getRange(SMRange range);
+  /// Return the document range of a symbol token.
+  Range getRange(const SymbolToken &token) const;
+  /// Return the document range of the entire chunk.
+  Range getRange() const;
+
+  /// Return the symbol token at the given document position, if any.
+  const SymbolToken *findToken(const Position &pos) const;
+
+  /// The text of the operation and the headers of its enclosing containers.
+  std::string text;
+  std::string header;
+  /// The alias definitions of the document, shared by all its chunks.
+  std::shared_ptr<const std::string> aliases;
+  /// The number of lines in `text`, the number of lines preceding it in the
+  /// parsed buffer, of which the alias definitions make up the first
+  /// `aliasLines`, and the number of containers that wrap the chunk when it is
+  /// parsed.
+  unsigned numLines;
+  unsigned headerLines = 0;
+  unsigned aliasLines = 0;
+  unsigned wrapperDepth = 0;
+  /// A hash of the text and header, used to find reusable chunks.
+  llvm::hash_code hash;
+  /// The length of the last line of the text.
+  unsigned lastLineLength;
+
+  /// The document line the chunk starts on.
+  unsigned startLine;
+
+  /// The name of the buffer the chunk is parsed from.
+  std::string bufferName;
+  llvm::SourceMgr sourceMgr;
+  Block parsedIR;
+  AsmParserState asmState;
+
+  /// The diagnostics emitted while parsing and verifying the chunk. The line
+  /// numbers are relative to the first line of the chunk.
+  std::vector<mlir::lsp::Diagnostic> diagnostics;
+
+  /// The name of the chunk's top-level operation, and the symbol it defines.
+  std::string opName;
+  StringRef symbolName;
+  /// Whether the top-level operation is a module in the instance graph.
+  bool isModule = false;
+
+  /// The symbol tokens in the text, and the set of all top-level symbols
+  /// referenced or defined in the text to quickly skip chunks.
+  SmallVector<SymbolToken> tokens;
+  llvm::StringSet<> symbolNames;
+  /// The number of instances of each module instantiated in this chunk.
+  llvm::StringMap<unsigned> instances;
+};
+} // namespace
+
+/// The chunk that the diagnostics emitted on the current thread belong to.
+static thread_local Chunk *diagnosticChunk = nullptr;
+
+Chunk::Chunk(const ChunkSpan &span,
+             std::shared_ptr<const std::string> aliases, unsigned id)
+    : text(span.text), header(span.header), aliases(std::move(aliases)),
+      wrapperDepth(span.wrapperDepth), hash(span.hash),
+      startLine(span.startLine) {
+  StringRef textRef(text);
+  numLines = textRef.count('\n') + (textRef.ends_with("\n") ? 0 : 1);
+  aliasLines = StringRef(*this->aliases).count('\n');
+  headerLines = aliasLines + StringRef(header).count('\n');
+  StringRef lastLine = textRef.rtrim('\n');
+  lastLineLength = lastLine.size() - (lastLine.rfind('\n') + 1);
+  bufferName = "chunk-" + std::to_string(id);
+
+  scanSymbolTokens(text, tokens);
+  for (auto &token : tokens) {
+    if (token.kind == TokenKind::Definition)
+      symbolName = token.name;
+    if (token.kind == TokenKind::Definition ||
+        token.kind == TokenKind::Reference)
+      symbolNames.insert(token.name);
+  }
+}
+
+void Chunk::parse(MLIRContext &context) {
+  std::string buffer = *aliases + header + text;
+  for (unsigned i = 0; i < wrapperDepth; ++i)
+    buffer += "\n}";
+  sourceMgr.AddNewSourceBuffer(
+      llvm::MemoryBuffer::getMemBufferCopy(buffer, bufferName), SMLoc());
+
+  // The chunk may refer to symbols in other chunks, so only the chunk's own
+  // operations are verified below, not the symbol tables around them.
+  ParserConfig config(&context, /*verifyAfterParse=*/false);
+  if (failed(parseAsmSourceFile(sourceMgr, &parsedIR, config, &asmState)))
+    return;
+
+  // Descend through the containers to the chunk's operations.
+  Block *block = &parsedIR;
+  for (unsigned i = 0; i < wrapperDepth; ++i) {
+    if (block->empty() || block->front().getNumRegions() == 0 ||
+        block->front().getRegion(0).empty())
+      return;
+    block = &block->front().getRegion(0).front();
+  }
+
+  for (auto &op : *block) {
+    if (opName.empty())
+      opName = op.getName().getStringRef().str();
+    if (isa<igraph::ModuleOpInterface>(op))
+      isModule = true;
+    if (failed(mlir::verify(&op)))
+      continue;
+    op.walk([&](igraph::InstanceOpInterface inst) {
+      for (auto moduleName : inst.getReferencedModuleNames())
+        ++instances[moduleName];
+    });
+  }
+}
+
+SMLoc Chunk::getSMLoc(const Position &pos) {
+  Position bufferPos(pos.line - startLine + headerLines, pos.character);
+  return bufferPos.getAsSMLoc(sourceMgr);
+}
+
+Range Chunk::getRange(SMRange range) {
+  Range result(sourceMgr, range);
+  int shift = (int)startLine - (int)headerLines;
+  result.start.line += shift;
+  result.end.line += shift;
+  return result;
+}
+
+Range Chunk::getRange(const SymbolToken &token) const {
+  return Range(Position(startLine + token.line, token.column),
+               Position(startLine + token.line, token.column + token.length));
+}
+
+Range Chunk::getRange() const {
+  return Range(Position(startLine, 0),
+               Position(startLine + numLines - 1, lastLineLength));
+}
+
+const SymbolToken *Chunk::findToken(const Position &pos) const {
+  if (pos.line < (int)startLine)
+    return nullptr;
+  unsigned line = pos.line - startLine;
+  for (auto &token : tokens)
+    if (token.line == line && token.column <= (unsigned)pos.character &&
+        (unsigned)pos.character < token.column + token.length)
+      return &token;
+  return nullptr;
+}
+
+/// Convert an MLIR diagnostic into an LSP diagnostic, without a position.
+static mlir::lsp::Diagnostic convertDiagnostic(Diagnostic &diag) {
+  mlir::lsp::Diagnostic lspDiag;
+  lspDiag.source = "circt";
+  switch (diag.getSeverity()) {
+  case DiagnosticSeverity::Note:
+    lspDiag.severity = mlir::lsp::DiagnosticSeverity::Hint;
+    break;
+  case DiagnosticSeverity::Warning:
+    lspDiag.severity = mlir::lsp::DiagnosticSeverity::Warning;
+    break;
+  case DiagnosticSeverity::Error:
+    lspDiag.severity = mlir::lsp::DiagnosticSeverity::Error;
+    break;
+  case DiagnosticSeverity::Remark:
+    lspDiag.severity = mlir::lsp::DiagnosticSeverity::Information;
+    break;
+  }
+
+  llvm::raw_string_ostream os(lspDiag.message);
+  diag.print(os);
+  for (auto &note : diag.getNotes()) {
+    os << "\nnote: ";
+    note.print(os);
+  }
+  return lspDiag;
+}
+
+/// Return the zero-based position of a diagnostic in the buffer with the given
+/// name, or `std::nullopt` if it is attached to a location outside of it, such
+/// as a debug location printed in the IR.
+static std::optional<Position> getBufferPosition(Diagnostic &diag,
+                                                 StringRef bufferName) {
+  auto fileLoc = diag.getLocation()->findInstanceOf<FileLineColLoc>();
+  if (!fileLoc || fileLoc.getFilename() != bufferName)
+    return std::nullopt;
+  return Position((int)fileLoc.getLine() - 1,
+                  std::max<int>(fileLoc.getColumn() - 1, 0));
+}
+
+void Chunk::addDiagnostic(Diagnostic &diag) {
+  // Diagnostics outside the chunk's buffer are reported at the start of the
+  // chunk. Diagnostics within the alias definitions are reported once for the
+  // entire document rather than for every chunk; see `parseAliases`.
+  Position pos(0, 0);
+  if (auto bufferPos = getBufferPosition(diag, bufferName)) {
+    if (bufferPos->line < (int)aliasLines)
+      return;
+    pos.line = std::clamp(bufferPos->line - (int)headerLines, 0,
+                          (int)numLines - 1);
+    pos.character = bufferPos->character;
+  }
+  auto lspDiag = convertDiagnostic(diag);
+  lspDiag.range = Range(pos, pos);
+  diagnostics.push_back(std::move(lspDiag));
+}
+
+/// Parse the alias definitions of a document on their own and collect the
+/// diagnostics emitted for them. The line numbers of the diagnostics are
+/// relative to the first line of the definitions.
+static void parseAliases(MLIRContext &context, StringRef aliases,
+                         std::vector<mlir::lsp::Diagnostic> &diagnostics) {
+  if (aliases.empty())
+    return;
+  StringRef bufferName = "aliases";
+  llvm::SourceMgr sourceMgr;
+  sourceMgr.AddNewSourceBuffer(
+      llvm::MemoryBuffer::getMemBufferCopy(aliases, bufferName), SMLoc());
+  ScopedDiagnosticHandler handler(&context, [&](Diagnostic &diag) {
+    auto pos = getBufferPosition(diag, bufferName).value_or(Position(0, 0));
+    auto lspDiag = convertDiagnostic(diag);
+    lspDiag.range = Range(pos, pos);
+    diagnostics.push_back(std::move(lspDiag));
+    return success();
+  });
+  Block block;
+  ParserConfig config(&context, /*verifyAfterParse=*/false);
+  (void)parseAsmSourceFile(sourceMgr, &block, config);
+}
+
+//===----------------------------------------------------------------------===//
+// Document
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// A document open in the server.
+struct Document {
+  /// Return the chunk containing the given position, if any.
+  Chunk *findChunk(const Position &pos) const;
+
+  /// The chunks in document order.
+  std::vector<std::unique_ptr<Chunk>> chunks;
+  /// The alias definitions that all chunks are parsed with, the document line
+  /// of each of their lines, and the diagnostics emitted for them with line
+  /// numbers relative to the first definition.
+  std::shared_ptr<const std::string> aliases;
+  std::vector<unsigned> aliasLines;
+  std::vector<mlir::lsp::Diagnostic> aliasDiagnostics;
+  /// The chunk defining each top-level symbol.
+  llvm::StringMap<Chunk *> symbols;
+  int64_t version = 0;
+};
+} // namespace
+
+Chunk *Document::findChunk(const Position &pos) const {
+  auto it = llvm::upper_bound(
+      chunks, pos.line, [](int line, const std::unique_ptr<Chunk> &chunk) {
+        return line < (int)chunk->startLine;
+      });
+  if (it == chunks.begin())
+    return nullptr;
+  Chunk *chunk = std::prev(it)->get();
+  if (pos.line >= (int)(chunk->startLine + chunk->numLines))
+    return nullptr;
+  return chunk;
+}
+
+//===----------------------------------------------------------------------===//
+// CIRCTServer::Impl
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// A symbol or inner symbol a token refers to.
+struct SymbolTarget {
+  /// For inner symbols, the module the symbol is defined in.
+  StringRef module;
+  StringRef name;
+  bool isInner;
+};
+} // namespace
+
+struct circt::lsp::CIRCTServer::Impl {
+  Impl(DialectRegistry &registry);
+
+  void update(Document &doc, StringRef contents);
+  SymbolTarget getTarget(const Chunk &chunk, const SymbolToken &token) const;
+  void findDefinitions(const URIForFile &uri, const Document &doc,
+                       const SymbolTarget &target,
+                       std::vector<mlir::lsp::Location> &locations) const;
+  void findReferences(const URIForFile &uri, const Document &doc,
+                      const SymbolTarget &target,
+                      std::vector<mlir::lsp::Location> &locations) const;
+
+  MLIRContext context;
+  llvm::StringMap<std::unique_ptr<Document>> documents;
+  std::atomic<unsigned> nextChunkId = 0;
+};
+
+circt::lsp::CIRCTServer::Impl::Impl(DialectRegistry &registry)
+    : context(registry, MLIRContext::Threading::ENABLED) {
+  context.allowUnregisteredDialects();
+
+  // Route diagnostics to the chunk being parsed on the emitting thread.
+  context.getDiagEngine().registerHandler([](Diagnostic &diag) {
+    if (!diagnosticChunk)
+      return failure();
+    diagnosticChunk->addDiagnostic(diag);
+    return success();
+  });
+}
+
+/// Update a document with new contents. Chunks whose text did not change are
+/// carried over from the previous version of the document, and only the new
+/// chunks are parsed, in parallel. Changing the alias definitions causes all
+/// chunks to be parsed again.
+void circt::lsp::CIRCTServer::Impl::update(Document &doc, StringRef contents) {
+  std::vector<ChunkSpan> spans;
+  AliasDefinitions aliases;
+  splitDocument(contents, spans, aliases);
+
+  bool aliasesChanged = !doc.aliases || *doc.aliases != aliases.text;
+  if (aliasesChanged) {
+    doc.aliases = std::make_shared<const std::string>(std::move(aliases.text));
+    doc.aliasDiagnostics.clear();
+    parseAliases(context, *doc.aliases, doc.aliasDiagnostics);
+  }
+  doc.aliasLines = std::move(aliases.lines);
+
+  DenseMap<llvm::hash_code, SmallVector<std::unique_ptr<Chunk>, 1>> reusable;
+  if (!aliasesChanged)
+    for (auto &chunk : doc.chunks)
+      reusable[chunk->hash].push_back(std::move(chunk));
+  doc.chunks.clear();
+
+  SmallVector<Chunk *> newChunks;
+  for (auto &span : spans) {
+    auto it = reusable.find(span.hash);
+    if (it != reusable.end()) {
+      auto match = llvm::find_if(it->second, [&](auto &old) {
+        return old && old->text == span.text && old->header == span.header;
+      });
+      if (match != it->second.end()) {
+        (*match)->startLine = span.startLine;
+        doc.chunks.push_back(std::move(*match));
+        continue;
+      }
+    }
+    doc.chunks.push_back(
+        std::make_unique<Chunk>(span, doc.aliases, nextChunkId++));
+    newChunks.push_back(doc.chunks.back().get());
+  }
+
+  mlir::parallelForEach(&context, newChunks, [&](Chunk *chunk) {
+    diagnosticChunk = chunk;
+    chunk->parse(context);
+    diagnosticChunk = nullptr;
+  });
+
+  doc.symbols.clear();
+  for (auto &chunk : doc.chunks)
+    if (!chunk->symbolName.empty())
+      doc.symbols.try_emplace(chunk->symbolName, chunk.get());
+}
+
+SymbolTarget
+circt::lsp::CIRCTServer::Impl::getTarget(const Chunk &chunk,
+                                         const SymbolToken &token) const {
+  switch (token.kind) {
+  case TokenKind::Definition:
+  case TokenKind::Reference:
+    return {StringRef(), token.name, false};
+  case TokenKind::InnerDefinition:
+    return {chunk.symbolName, token.name, true};
+  case TokenKind::InnerReference:
+    return {token.parent, token.name, true};
+  }
+  llvm_unreachable("all token kinds handled");
+}
+
+void circt::lsp::CIRCTServer::Impl::findDefinitions(
+    const URIForFile &uri, const Document &doc, const SymbolTarget &target,
+    std::vector<mlir::lsp::Location> &locations) const {
+  auto kind = target.isInner ? TokenKind::InnerDefinition
+                             : TokenKind::Definition;
+  Chunk *chunk = doc.symbols.lookup(target.isInner ? target.module
+                                                   : target.name);
+  if (!chunk)
+    return;
+  for (auto &token : chunk->tokens)
+    if (token.kind == kind && token.name == target.name)
+      locations.push_back(mlir::lsp::Location{uri, chunk->getRange(token)});
+}
+
+void circt::lsp::CIRCTServer::Impl::findReferences(
+    const URIForFile &uri, const Document &doc, const SymbolTarget &target,
+    std::vector<mlir::lsp::Location> &locations) const {
+  for (auto &chunk : doc.chunks) {
+    // Inner symbols are always referenced through their module's name, so the
+    // module's name has to appear somewhere in the chunk.
+    if (!chunk->symbolNames.contains(target.isInner ? target.module
+                                                    : target.name))
+      continue;
+    for (auto &token : chunk->tokens) {
+      if (token.name != target.name)
+        continue;
+      bool matches = false;
+      switch (token.kind) {
+      case TokenKind::Definition:
+      case TokenKind::Reference:
+        matches = !target.isInner;
+        break;
+      case TokenKind::InnerDefinition:
+        matches = target.isInner && chunk->symbolName == target.module;
+        break;
+      case TokenKind::InnerReference:
+        matches = target.isInner && token.parent == target.module;
+        break;
+      }
+      if (matches)
+        locations.push_back(mlir::lsp::Location{uri, chunk->getRange(token)});
+    }
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// SSA Values
+//===----------------------------------------------------------------------===//
+
+/// Return true if the given range contains the given location.
+static bool contains(SMRange range, SMLoc loc) {
+  return range.Start.getPointer() <= loc.getPointer() &&
+         loc.getPointer() < range.End.getPointer();
+}
+
+/// Return the definition of the value or block defined or used at `loc`.
+static const AsmParserState::SMDefinition *
+findValueDefinition(const AsmParserState &asmState, SMLoc loc) {
+  auto isDefOrUse = [&](const AsmParserState::SMDefinition &def) {
+    return contains(def.loc, loc) ||
+           llvm::any_of(def.uses,
+                        [&](SMRange use) { return contains(use, loc); });
+  };
+  for (const auto &op : asmState.getOpDefs())
+    for (const auto &result : op.resultGroups)
+      if (isDefOrUse(result.definition))
+        return &result.definition;
+  for (const auto &block : asmState.getBlockDefs()) {
+    if (isDefOrUse(block.definition))
+      return &block.definition;
+    for (const auto &arg : block.arguments)
+      if (isDefOrUse(arg))
+        return &arg;
+  }
+  return nullptr;
+}
+
+//===----------------------------------------------------------------------===//
+// CIRCTServer
+//===----------------------------------------------------------------------===//
+
+circt::lsp::CIRCTServer::CIRCTServer(DialectRegistry &registry)
+    : impl(std::make_unique<Impl>(registry)) {}
+circt::lsp::CIRCTServer::~CIRCTServer() = default;
+
+void circt::lsp::CIRCTServer::addOrUpdateDocument(
+    const URIForFile &uri, StringRef contents, int64_t version,
+    std::vector<mlir::lsp::Diagnostic> &diagnostics) {
+  auto &doc = impl->documents[uri.file()];
+  if (!doc)
+    doc = std::make_unique<Document>();
+  doc->version = version;
+  impl->update(*doc, contents);
+
+  for (auto diag : doc->aliasDiagnostics) {
+    unsigned line = doc->aliasLines[std::min<size_t>(
+        diag.range.start.line, doc->aliasLines.size() - 1)];
+    diag.range.start.line = line;
+    diag.range.end.line = line;
+    diagnostics.push_back(std::move(diag));
+  }
+  for (auto &chunk : doc->chunks) {
+    for (auto diag : chunk->diagnostics) {
+      diag.range.start.line += chunk->startLine;
+      diag.range.end.line += chunk->startLine;
+      diagnostics.push_back(std::move(diag));
+    }
+  }
+}
+
+std::optional<int64_t>
+circt::lsp::CIRCTServer::removeDocument(const URIForFile &uri) {
+  auto it = impl->documents.find(uri.file());
+  if (it == impl->documents.end())
+    return std::nullopt;
+  int64_t version = it->second->version;
+  impl->documents.erase(it);
+  return version;
+}
+
+void circt::lsp::CIRCTServer::getLocationsOf(
+    const URIForFile &uri, const Position &pos,
+    std::vector<mlir::lsp::Location> &locations) {
+  auto it = impl->documents.find(uri.file());
+  if (it == impl->documents.end())
+    return;
+  Document &doc = *it->second;
+  Chunk *chunk = doc.findChunk(pos);
+  if (!chunk)
+    return;
+
+  if (auto *token = chunk->findToken(pos))
+    return impl->findDefinitions(uri, doc, impl->getTarget(*chunk, *token),
+                                 locations);
+
+  if (auto *def = findValueDefinition(chunk->asmState, chunk->getSMLoc(pos)))
+    locations.push_back(mlir::lsp::Location{uri, chunk->getRange(def->loc)});
+}
+
+void circt::lsp::CIRCTServer::findReferencesOf(
+    const URIForFile &uri, const Position &pos,
+    std::vector<mlir::lsp::Location> &references) {
+  auto it = impl->documents.find(uri.file());
+  if (it == impl->documents.end())
+    return;
+  Document &doc = *it->second;
+  Chunk *chunk = doc.findChunk(pos);
+  if (!chunk)
+    return;
+
+  if (auto *token = chunk->findToken(pos))
+    return impl->findReferences(uri, doc, impl->getTarget(*chunk, *token),
+                                references);
+
+  if (auto *def = findValueDefinition(chunk->asmState, chunk->getSMLoc(pos))) {
+    references.push_back(mlir::lsp::Location{uri, chunk->getRange(def->loc)});
+    for (SMRange use : def->uses)
+      references.push_back(mlir::lsp::Location{uri, chunk->getRange(use)});
+  }
+}
+
+std::optional<Hover> circt::lsp::CIRCTServer::findHover(const URIForFile &uri,
+                                                 const Position &pos) {
+  auto it = impl->documents.find(uri.file());
+  if (it == impl->documents.end())
+    return std::nullopt;
+  Document &doc = *it->second;
+  Chunk *chunk = doc.findChunk(pos);
+  if (!chunk)
+    return std::nullopt;
+  auto *token = chunk->findToken(pos);
+  if (!token)
+    return std::nullopt;
+  auto target = impl->getTarget(*chunk, *token);
+
+  Hover hover(chunk->getRange(*token));
+  hover.contents.kind = mlir::lsp::MarkupKind::Markdown;
+  llvm::raw_string_ostream os(hover.contents.value);
+  if (target.isInner) {
+    std::vector<mlir::lsp::Location> refs;
+    impl->findReferences(uri, doc, target, refs);
+    os << "Inner symbol `@" << target.name << "` of `@" << target.module
+       << "`\n\n" << refs.size() << " occurrences";
+    return hover;
+  }
+
+  Chunk *defChunk = doc.symbols.lookup(target.name);
+  if (!defChunk) {
+    os << "Undefined symbol `@" << target.name << "`";
+    return hover;
+  }
+  os << "**" << defChunk->opName << "** `@" << target.name << "`";
+
+  // Summarize the instance graph around the symbol.
+  if (defChunk->isModule) {
+    unsigned numInstances = 0, numParents = 0;
+    for (auto &other : doc.chunks) {
+      if (unsigned count = other->instances.lookup(target.name)) {
+        numInstances += count;
+        ++numParents;
+      }
+    }
+    os << "\n\nInstantiated " << numInstances << " times in " << numParents
+       << " modules\n\nInstantiates " << defChunk->instances.size()
+       << " distinct modules";
+  }
+  return hover;
+}
+
+void circt::lsp::CIRCTServer::findDocumentSymbols(
+    const URIForFile &uri, std::vector<DocumentSymbol> &symbols) {
+  auto it = impl->documents.find(uri.file());
+  if (it == impl->documents.end())
+    return;
+  for (auto &chunk : it->second->chunks) {
+    if (chunk->symbolName.empty())
+      continue;
+    const SymbolToken *defToken = nullptr;
+    for (auto &token : chunk->tokens)
+      if (token.kind == TokenKind::Definition)
+        defToken = &token;
+    DocumentSymbol symbol("@" + chunk->symbolName,
+                          chunk->isModule ? mlir::lsp::SymbolKind::Module
+                                          : mlir::lsp::SymbolKind::Object,
+                          chunk->getRange(), chunk->getRange(*defToken));
+    for (auto &token : chunk->tokens)
+      if (token.kind == TokenKind::InnerDefinition)
+        symbol.children.emplace_back("@" + token.name,
+                                     mlir::lsp::SymbolKind::Field,
+                                     chunk->getRange(token),
+                                     chunk->getRange(token));
+    symbols.push_back(std::move(symbol));
+  }
+}
@@ -0,0 +1,74 @@
+//===- CIRCTServer.h - Incremental CIRCT document server --------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// NOLINTNEXTLINE(llvm-header-guard)
+#ifndef LIB_TOOLS_CIRCT_LSP_SERVER_CIRCTSERVER_H
+#define LIB_TOOLS_CIRCT_LSP_SERVER_CIRCTSERVER_H
+
+#include "circt/Support/LLVM.h"
+#include "mlir/Tools/lsp-server-support/Protocol.h"
+#include <memory>
+#include <optional>
+
+namespace mlir {
+class DialectRegistry;
+} // namespace mlir
+
+namespace circt {
+namespace lsp {
+
+/// This class implements the language features of the incremental CIRCT
+/// language server. Each document is split into its top-level operations, which
+/// are parsed independently and cached by their text, such that an edit only
+/// reparses the operations it touches. Symbols and inner symbols are indexed
+/// textually per operation, and the instance graph is extracted from the
+/// parsed instance operations.
+class CIRCTServer {
+public:
+  CIRCTServer(mlir::DialectRegistry &registry);
+  ~CIRCTServer();
+
+  /// Add or update the document with the given URI and contents. Any
+  /// diagnostics emitted for the document are collected in `diagnostics`.
+  void addOrUpdateDocument(const mlir::lsp::URIForFile &uri,
+                           StringRef contents, int64_t version,
+                           std::vector<mlir::lsp::Diagnostic> &diagnostics);
+
+  /// Remove the document with the given URI. Returns the version of the
+  /// document, or std::nullopt if the URI did not have a corresponding
+  /// document.
+  std::optional<int64_t> removeDocument(const mlir::lsp::URIForFile &uri);
+
+  /// Return the locations of the definitions of the symbol or value at the
+  /// given position.
+  void getLocationsOf(const mlir::lsp::URIForFile &uri,
+                      const mlir::lsp::Position &pos,
+                      std::vector<mlir::lsp::Location> &locations);
+
+  /// Find all references of the symbol or value at the given position.
+  void findReferencesOf(const mlir::lsp::URIForFile &uri,
+                        const mlir::lsp::Position &pos,
+                        std::vector<mlir::lsp::Location> &references);
+
+  /// Find a hover description for the given position.
+  std::optional<mlir::lsp::Hover>
+  findHover(const mlir::lsp::URIForFile &uri, const mlir::lsp::Position &pos);
+
+  /// Find all of the document symbols within the given file.
+  void findDocumentSymbols(const mlir::lsp::URIForFile &uri,
+                           std::vector<mlir::lsp::DocumentSymbol> &symbols);
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl;
+};
+
+} // namespace lsp
+} // namespace circt
+
+#endif // LIB_TOOLS_CIRCT_LSP_SERVER_CIRCTSERVER_H
@@ -0,0 +1,33 @@
+//===- LSPServer.h - CIRCT Language Server ----------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// NOLINTNEXTLINE(llvm-header-guard)
+#ifndef LIB_TOOLS_CIRCT_LSP_SERVER_LSPSERVER_H
+#define LIB_TOOLS_CIRCT_LSP_SERVER_LSPSERVER_H
+
+#include "mlir/Support/LogicalResult.h"
+
+namespace mlir {
+namespace lsp {
+class JSONTransport;
+} // namespace lsp
+} // namespace mlir
+
+namespace circt {
+namespace lsp {
+class CIRCTServer;
+
+/// Run the main loop of the LSP server using the given CIRCT server and
+/// transport.
+mlir::LogicalResult runCIRCTLSPServer(CIRCTServer &server,
+                                      mlir::lsp::JSONTransport &transport);
+
+} // namespace lsp
+} // namespace circt
+
+#endif // LIB_TOOLS_CIRCT_LSP_SERVER_LSPSERVER_H
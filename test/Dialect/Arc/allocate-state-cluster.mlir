@@ -0,0 +1,52 @@
+// RUN: circt-opt %s --arc-allocate-state=cluster-by-access=true | FileCheck %s
+
+// Ports go first, followed by the states of the first clock domain, the states
+// shared between both domains, the states of the second domain, and finally the
+// states not accessed during evaluation.
+
+// CHECK-LABEL: arc.model @Cluster
+arc.model @Cluster io !hw.modty<input x : i1, output y : i8> {
+^bb0(%arg0: !arc.storage):
+  // CHECK-NEXT: ([[PTR:%.+]]: !arc.storage<25>):
+  %cold = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i1>
+  %b = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i8>
+  %x = arc.root_input "x", %arg0 : (!arc.storage) -> !arc.state<i1>
+  %c = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i32>
+  %d = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i8>
+  %e = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i16>
+  %y = arc.root_output "y", %arg0 : (!arc.storage) -> !arc.state<i8>
+  %unused = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i64>
+  // CHECK-NEXT: arc.alloc_state [[PTR]] {offset = 24 : i32}
+  // CHECK-SAME: -> !arc.state<i1>
+  // CHECK-NEXT: arc.alloc_state [[PTR]] {offset = 11 : i32}
+  // CHECK-SAME: -> !arc.state<i8>
+  // CHECK-NEXT: arc.root_input "x", [[PTR]] {offset = 0 : i32}
+  // CHECK-NEXT: arc.alloc_state [[PTR]] {offset = 4 : i32}
+  // CHECK-SAME: -> !arc.state<i32>
+  // CHECK-NEXT: arc.alloc_state [[PTR]] {offset = 10 : i32}
+  // CHECK-SAME: -> !arc.state<i8>
+  // CHECK-NEXT: arc.alloc_state [[PTR]] {offset = 8 : i32}
+  // CHECK-SAME: -> !arc.state<i16>
+  // CHECK-NEXT: arc.root_output "y", [[PTR]] {offset = 1 : i32}
+  // CHECK-NEXT: arc.alloc_state [[PTR]] {offset = 16 : i32}
+  // CHECK-SAME: -> !arc.state<i64>
+
+  arc.initial {
+    %false = hw.constant false
+    arc.state_write %cold = %false : <i1>
+  }
+  %clk = arc.state_read %x : <i1>
+  scf.if %clk {
+    %0 = arc.state_read %c : <i32>
+    arc.state_write %c = %0 : <i32>
+    %1 = arc.state_read %e : <i16>
+    arc.state_write %e = %1 : <i16>
+    %2 = comb.extract %0 from 0 : (i32) -> i8
+    arc.state_write %d = %2 : <i8>
+  }
+  scf.if %clk {
+    %0 = arc.state_read %d : <i8>
+    arc.state_write %b = %0 : <i8>
+    arc.state_write %y = %0 : <i8>
+  }
+}
@@ -0,0 +1,23 @@
+// RUN: circt-opt %s --arc-allocate-state=large-memory-bytes=1024 | FileCheck %s
+
+// Large memories go after all other allocations, each on its own pages.
+
+// CHECK-LABEL: arc.model @LargeMemories
+arc.model @LargeMemories io !hw.modty<input x : i1> {
+^bb0(%arg0: !arc.storage):
+  // CHECK-NEXT: ([[PTR:%.+]]: !arc.storage<9392>):
+  %0 = arc.alloc_memory %arg0 : (!arc.storage) -> !arc.memory<512 x i32, i9>
+  %1 = arc.root_input "x", %arg0 : (!arc.storage) -> !arc.state<i1>
+  %2 = arc.alloc_memory %arg0 : (!arc.storage) -> !arc.memory<4 x i8, i2>
+  %3 = arc.alloc_memory %arg0 : (!arc.storage) -> !arc.memory<300 x i32, i9>
+  %4 = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i16>
+  // CHECK-NEXT: arc.alloc_memory [[PTR]] {offset = 4096 : i32, stride = 4 : i32}
+  // CHECK-SAME: -> !arc.memory<512 x i32, i9>
+  // CHECK-NEXT: arc.root_input "x", [[PTR]] {offset = 0 : i32}
+  // CHECK-NEXT: arc.alloc_memory [[PTR]] {offset = 4 : i32, stride = 1 : i32}
+  // CHECK-SAME: -> !arc.memory<4 x i8, i2>
+  // CHECK-NEXT: arc.alloc_memory [[PTR]] {offset = 8192 : i32, stride = 4 : i32}
+  // CHECK-SAME: -> !arc.memory<300 x i32, i9>
+  // CHECK-NEXT: arc.alloc_state [[PTR]] {offset = 8 : i32}
+  // CHECK-SAME: -> !arc.state<i16>
+}
@@ -183,3 +183,48 @@ arc.define @sub2(%arg0: i4, %arg1: i4) -> i4 {
   %0 = comb.add %arg0, %arg1 : i4
   arc.output %0 : i4
 }
+
+//--- profile
+// RUN: circt-opt %t/profile --arc-inline="hot-arcs=Hot cold-arcs=Cold,TrivialCold" | FileCheck %t/profile
+
+// Hot arcs are inlined at all uses, cold arcs stay outlined unless trivial.
+// CHECK-LABEL: func.func @Profile
+func.func @Profile(%arg0: i4, %arg1: i4) -> (i4, i4, i4, i4) {
+  // CHECK-NEXT: comb.add
+  // CHECK-NEXT: comb.mul
+  // CHECK-NEXT: comb.xor
+  // CHECK-NEXT: comb.and
+  // CHECK-NEXT: comb.add
+  // CHECK-NEXT: comb.mul
+  // CHECK-NEXT: comb.xor
+  // CHECK-NEXT: comb.and
+  // CHECK-NEXT: arc.call @Cold(%arg0, %arg1)
+  // CHECK-NEXT: comb.or
+  // CHECK-NEXT: return
+  %0 = arc.call @Hot(%arg0, %arg1) : (i4, i4) -> i4
+  %1 = arc.call @Hot(%arg1, %arg0) : (i4, i4) -> i4
+  %2 = arc.call @Cold(%arg0, %arg1) : (i4, i4) -> i4
+  %3 = arc.call @TrivialCold(%arg0, %arg1) : (i4, i4) -> i4
+  return %0, %1, %2, %3 : i4, i4, i4, i4
+}
+// CHECK-NOT: arc.define @Hot
+arc.define @Hot(%arg0: i4, %arg1: i4) -> i4 {
+  %0 = comb.add %arg0, %arg1 : i4
+  %1 = comb.mul %0, %arg0 : i4
+  %2 = comb.xor %1, %arg1 : i4
+  %3 = comb.and %2, %0 : i4
+  arc.output %3 : i4
+}
+// CHECK-LABEL: arc.define @Cold
+arc.define @Cold(%arg0: i4, %arg1: i4) -> i4 {
+  %0 = comb.add %arg0, %arg1 : i4
+  %1 = comb.mul %0, %arg0 : i4
+  %2 = comb.xor %1, %arg1 : i4
+  %3 = comb.and %2, %0 : i4
+  arc.output %3 : i4
+}
+// CHECK-NOT: arc.define @TrivialCold
+arc.define @TrivialCold(%arg0: i4, %arg1: i4) -> i4 {
+  %0 = comb.or %arg0, %arg1 : i4
+  arc.output %0 : i4
+}
@@ -0,0 +1,87 @@
+// RUN: circt-opt %s --arc-insert-activity-guards=min-ops=2 | FileCheck %s
+
+// CHECK-LABEL: arc.model @Guarded
+arc.model @Guarded io !hw.modty<input a : i8, input b : i8, output y : i8> {
+^bb0(%arg0: !arc.storage):
+  // CHECK-NEXT: ([[STORAGE:%.+]]: !arc.storage):
+  // CHECK-NEXT: [[SHADOWA:%.+]] = arc.alloc_state [[STORAGE]] : (!arc.storage) -> !arc.state<i8>
+  // CHECK-NEXT: [[SHADOWB:%.+]] = arc.alloc_state [[STORAGE]] : (!arc.storage) -> !arc.state<i8>
+  // CHECK-NEXT: [[DIDRUN:%.+]] = arc.alloc_state [[STORAGE]] : (!arc.storage) -> !arc.state<i1>
+  // CHECK-NEXT: [[A:%.+]] = arc.root_input "a"
+  // CHECK-NEXT: [[B:%.+]] = arc.root_input "b"
+  // CHECK-NEXT: [[Y:%.+]] = arc.root_output "y"
+  %a = arc.root_input "a", %arg0 : (!arc.storage) -> !arc.state<i8>
+  %b = arc.root_input "b", %arg0 : (!arc.storage) -> !arc.state<i8>
+  %y = arc.root_output "y", %arg0 : (!arc.storage) -> !arc.state<i8>
+  // CHECK-NEXT: [[A0:%.+]] = arc.state_read [[A]] : <i8>
+  // CHECK-NEXT: [[B0:%.+]] = arc.state_read [[B]] : <i8>
+  %0 = arc.state_read %a : <i8>
+  %1 = arc.state_read %b : <i8>
+  %2 = comb.add %0, %1 : i8
+  %3 = comb.mul %2, %0 : i8
+  arc.state_write %y = %3 : <i8>
+  // CHECK-NEXT: [[TRUE:%.+]] = hw.constant true
+  // CHECK-NEXT: [[OLDA:%.+]] = arc.state_read [[SHADOWA]] : <i8>
+  // CHECK-NEXT: [[CHANGEDA:%.+]] = comb.icmp bin ne [[A0]], [[OLDA]] : i8
+  // CHECK-NEXT: [[OLDB:%.+]] = arc.state_read [[SHADOWB]] : <i8>
+  // CHECK-NEXT: [[CHANGEDB:%.+]] = comb.icmp bin ne [[B0]], [[OLDB]] : i8
+  // CHECK-NEXT: [[RAN:%.+]] = arc.state_read [[DIDRUN]] : <i1>
+  // CHECK-NEXT: [[FIRST:%.+]] = comb.xor bin [[RAN]], [[TRUE]] : i1
+  // CHECK-NEXT: [[COND:%.+]] = comb.or bin [[CHANGEDA]], [[CHANGEDB]], [[FIRST]] : i1
+  // CHECK-NEXT: scf.if [[COND]] {
+  // CHECK-NEXT:   [[ADD:%.+]] = comb.add [[A0]], [[B0]] : i8
+  // CHECK-NEXT:   [[MUL:%.+]] = comb.mul [[ADD]], [[A0]] : i8
+  // CHECK-NEXT:   arc.state_write [[Y]] = [[MUL]] : <i8>
+  // CHECK-NEXT:   arc.state_write [[SHADOWA]] = [[A0]] : <i8>
+  // CHECK-NEXT:   arc.state_write [[SHADOWB]] = [[B0]] : <i8>
+  // CHECK-NEXT:   arc.state_write [[DIDRUN]] = [[TRUE]] : <i1>
+  // CHECK-NEXT: }
+  // CHECK-NEXT: }
+}
+
+// States written in multiple places must be updated every time.
+// CHECK-LABEL: arc.model @MultipleWrites
+arc.model @MultipleWrites io !hw.modty<input a : i8, input b : i8, output y : i8> {
+^bb0(%arg0: !arc.storage):
+  // CHECK-NOT: scf.if
+  %a = arc.root_input "a", %arg0 : (!arc.storage) -> !arc.state<i8>
+  %b = arc.root_input "b", %arg0 : (!arc.storage) -> !arc.state<i8>
+  %y = arc.root_output "y", %arg0 : (!arc.storage) -> !arc.state<i8>
+  %0 = arc.state_read %a : <i8>
+  %1 = arc.state_read %b : <i8>
+  %2 = comb.add %0, %1 : i8
+  %3 = comb.mul %2, %0 : i8
+  arc.state_write %y = %3 : <i8>
+  arc.state_write %y = %1 : <i8>
+  // CHECK: }
+}
+
+// Values also used outside of a region become its inputs.
+// CHECK-LABEL: arc.model @SharedValues
+arc.model @SharedValues io !hw.modty<input a : i8, input b : i8, output y : i8> {
+^bb0(%arg0: !arc.storage):
+  %a = arc.root_input "a", %arg0 : (!arc.storage) -> !arc.state<i8>
+  %b = arc.root_input "b", %arg0 : (!arc.storage) -> !arc.state<i8>
+  %y = arc.root_output "y", %arg0 : (!arc.storage) -> !arc.state<i8>
+  %s = arc.alloc_state %arg0 : (!arc.storage) -> !arc.state<i8>
+  // CHECK: [[A0:%.+]] = arc.state_read
+  // CHECK: [[B0:%.+]] = arc.state_read
+  %0 = arc.state_read %a : <i8>
+  %1 = arc.state_read %b : <i8>
+  // CHECK-NEXT: [[ADD:%.+]] = comb.add [[A0]], [[B0]]
+  // CHECK-NEXT: arc.state_write {{%.+}} = [[ADD]]
+  // CHECK-NEXT: arc.state_write {{%.+}} = [[B0]]
+  %2 = comb.add %0, %1 : i8
+  arc.state_write %s = %2 : <i8>
+  arc.state_write %s = %1 : <i8>
+  %3 = comb.mul %2, %0 : i8
+  %4 = comb.xor %3, %1 : i8
+  arc.state_write %y = %4 : <i8>
+  // CHECK: comb.icmp bin ne [[ADD]]
+  // CHECK: comb.icmp bin ne [[A0]]
+  // CHECK: comb.icmp bin ne [[B0]]
+  // CHECK: scf.if
+  // CHECK-NEXT: [[MUL:%.+]] = comb.mul [[ADD]], [[A0]]
+  // CHECK-NEXT: [[XOR:%.+]] = comb.xor [[MUL]], [[B0]]
+  // CHECK-NEXT: arc.state_write {{%.+}} = [[XOR]]
+}
@@ -0,0 +1,50 @@
+// RUN: circt-opt %s --arc-insert-profiling | FileCheck %s
+
+arc.define @Add(%arg0: i8, %arg1: i8) -> i8 {
+  %0 = comb.add %arg0, %arg1 : i8
+  arc.output %0 : i8
+}
+
+// CHECK-LABEL: arc.model @Profiled
+arc.model @Profiled io !hw.modty<input a : i8, input clk : i1, output y : i8> {
+^bb0(%arg0: !arc.storage):
+  // CHECK-DAG: [[DOMAIN_CYCLES:%.+]] = arc.alloc_state {{%.+}} {name = "profile/domains/0/cycles"}
+  // CHECK-DAG: [[DOMAIN_CALLS:%.+]] = arc.alloc_state {{%.+}} {name = "profile/domains/0/calls"}
+  // CHECK-DAG: [[ARC_CYCLES:%.+]] = arc.alloc_state {{%.+}} {name = "profile/arcs/Add/cycles"}
+  // CHECK-DAG: [[ARC_CALLS:%.+]] = arc.alloc_state {{%.+}} {name = "profile/arcs/Add/calls"}
+  // CHECK-DAG: [[EVAL_CYCLES:%.+]] = arc.alloc_state {{%.+}} {name = "profile/eval/cycles"}
+  // CHECK-DAG: [[EVAL_CALLS:%.+]] = arc.alloc_state {{%.+}} {name = "profile/eval/calls"}
+  // CHECK: [[EVAL_START:%.+]] = func.call @_arc_env_read_cycle_counter() : () -> i64
+  %a = arc.root_input "a", %arg0 : (!arc.storage) -> !arc.state<i8>
+  %clk = arc.root_input "clk", %arg0 : (!arc.storage) -> !arc.state<i1>
+  %y = arc.root_output "y", %arg0 : (!arc.storage) -> !arc.state<i8>
+  %0 = arc.state_read %clk : <i1>
+  // CHECK: [[DOMAIN_START:%.+]] = func.call @_arc_env_read_cycle_counter()
+  // CHECK-NEXT: scf.if
+  scf.if %0 {
+    %1 = arc.state_read %a : <i8>
+    // CHECK: [[ARC_START:%.+]] = func.call @_arc_env_read_cycle_counter()
+    // CHECK-NEXT: arc.call @Add
+    // CHECK-NEXT: [[ARC_STOP:%.+]] = func.call @_arc_env_read_cycle_counter()
+    // CHECK-NEXT: [[ELAPSED:%.+]] = comb.sub bin [[ARC_STOP]], [[ARC_START]] : i64
+    // CHECK-NEXT: [[OLD:%.+]] = arc.state_read [[ARC_CYCLES]] : <i64>
+    // CHECK-NEXT: [[NEW:%.+]] = comb.add bin [[OLD]], [[ELAPSED]] : i64
+    // CHECK-NEXT: arc.state_write [[ARC_CYCLES]] = [[NEW]] : <i64>
+    // CHECK-NEXT: [[ONE:%.+]] = hw.constant 1 : i64
+    // CHECK-NEXT: [[OLD:%.+]] = arc.state_read [[ARC_CALLS]] : <i64>
+    // CHECK-NEXT: [[NEW:%.+]] = comb.add bin [[OLD]], [[ONE]] : i64
+    // CHECK-NEXT: arc.state_write [[ARC_CALLS]] = [[NEW]] : <i64>
+    %2 = arc.call @Add(%1, %1) : (i8, i8) -> i8
+    arc.state_write %y = %2 : <i8>
+  }
+  // CHECK: }
+  // CHECK-NEXT: [[DOMAIN_STOP:%.+]] = func.call @_arc_env_read_cycle_counter()
+  // CHECK-NEXT: comb.sub bin [[DOMAIN_STOP]], [[DOMAIN_START]]
+  // CHECK: arc.state_write [[DOMAIN_CALLS]]
+  // CHECK-NEXT: [[EVAL_STOP:%.+]] = func.call @_arc_env_read_cycle_counter()
+  // CHECK-NEXT: comb.sub bin [[EVAL_STOP]], [[EVAL_START]]
+  // CHECK: arc.state_write [[EVAL_CALLS]]
+  // CHECK-NEXT: }
+}
+
+// CHECK: func.func private @_arc_env_read_cycle_counter() -> i64
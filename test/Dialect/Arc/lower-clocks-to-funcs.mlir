@@ -1,4 +1,5 @@
 // RUN: circt-opt %s --arc-lower-clocks-to-funcs --verify-diagnostics | FileCheck %s
+// RUN: circt-opt %s --arc-lower-clocks-to-funcs=cold-domains=1,7 | FileCheck %s --check-prefix=COLD
 
 // CHECK-LABEL: func.func @Trivial_initial(%arg0: !arc.storage<42>) {
 // CHECK-NEXT:    [[TMP:%.+]] = hw.constant 9002
@@ -36,5 +37,48 @@ arc.model @Trivial io !hw.modty<> {
   }
 }
 
+// Clock domains stay in the model unless they are cold.
+// CHECK-NOT: func.func @Domains_domain
+// CHECK-LABEL: arc.model @Domains
+
+// COLD-NOT: func.func @Domains_domain0
+// COLD-LABEL: func.func @Domains_domain1(%arg0: !arc.storage<42>, %arg1: i42) {
+// COLD-NEXT:    [[TMP:%.+]] = hw.constant 9005
+// COLD-NEXT:    [[STATE:%.+]] = arc.storage.get %arg0[0]
+// COLD-NEXT:    arc.state_write [[STATE]] = %arg1
+// COLD-NEXT:    call @DummyB([[TMP]]) {e}
+// COLD-NEXT:    return
+// COLD-NEXT:  }
+// COLD-NOT: func.func @Domains_domain
+
+// COLD-LABEL: arc.model @Domains
+// COLD:         [[VALUE:%.+]] = call @DummyA()
+// COLD:         scf.if {{%.+}} {
+// COLD-NEXT:      call @DummyB({{%.+}}) {d}
+// COLD-NEXT:    }
+// COLD-NEXT:    scf.if {{%.+}} {
+// COLD-NEXT:      call @Domains_domain1(%arg0, [[VALUE]]) : (!arc.storage<42>, i42) -> ()
+// COLD-NEXT:    }
+// COLD-NEXT:    call @DummyB([[VALUE]]) {f}
+
+arc.model @Domains io !hw.modty<> {
+^bb0(%arg0: !arc.storage<42>):
+  %0 = hw.constant 9004 : i42
+  %1 = hw.constant 9005 : i42
+  %2 = func.call @DummyA() : () -> i42
+  %clk0 = func.call @DummyC() : () -> i1
+  %clk1 = func.call @DummyC() : () -> i1
+  scf.if %clk0 {
+    func.call @DummyB(%0) {d} : (i42) -> ()
+  }
+  scf.if %clk1 {
+    %3 = arc.storage.get %arg0[0] : !arc.storage<42> -> !arc.state<i42>
+    arc.state_write %3 = %2 : <i42>
+    func.call @DummyB(%1) {e} : (i42) -> ()
+  }
+  func.call @DummyB(%2) {f} : (i42) -> ()
+}
+
 func.func private @DummyA() -> i42
 func.func private @DummyB(i42) -> ()
+func.func private @DummyC() -> i1
@@ -18,10 +18,9 @@ module attributes { dlti.dl_spec = #dlti.dl_spec<
     // CHECK: %[[format_str2_ptr:.*]] = llvm.mlir.addressof @[[format_str2]] : !llvm.ptr
     // CHECK: %[[format_str_ptr:.*]] = llvm.mlir.addressof @[[format_str]] : !llvm.ptr
     // CHECK-DAG: %[[c:.*]] = llvm.mlir.constant(24 : i8)
-    // CHECK-DAG: %[[zero:.*]] = llvm.mlir.constant(0 : i8)
     // CHECK-DAG: %[[size:.*]] = llvm.mlir.constant(3 : i64)
-    // CHECK-DAG: %[[state:.*]] = llvm.call @malloc(%[[size:.*]]) :
-    // CHECK: "llvm.intr.memset"(%[[state]], %[[zero]], %[[size]]) <{isVolatile = false}>
+    // CHECK-DAG: %[[one:.*]] = llvm.mlir.constant(1 : i64)
+    // CHECK: %[[state:.*]] = llvm.call @calloc(%[[size]], %[[one]]) :
     arc.sim.instantiate @id as %model {
       // CHECK-NEXT: llvm.store %[[c]], %[[state]] : i8
       arc.sim.set_input %model, "i" = %c : i8, !arc.sim.instance<@id>
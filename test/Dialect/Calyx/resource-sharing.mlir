@@ -0,0 +1,139 @@
+// RUN: circt-opt -pass-pipeline='builtin.module(calyx.component(calyx-resource-sharing))' %s | FileCheck %s
+
+module attributes {calyx.entrypoint = "main"} {
+  // CHECK-LABEL: calyx.component @main
+  calyx.component @main(%go: i1 {go}, %clk: i1 {clk}, %reset: i1 {reset}) -> (%done: i1 {done}) {
+    %r.in, %r.write_en, %r.clk, %r.reset, %r.out, %r.done = calyx.register @r : i32, i1, i1, i1, i32, i1
+    %c.in, %c.write_en, %c.clk, %c.reset, %c.out, %c.done = calyx.register @c : i1, i1, i1, i1, i1, i1
+    // CHECK:     calyx.std_mult_pipe @m0
+    // CHECK-NOT: calyx.std_mult_pipe @m1
+    // CHECK:     calyx.std_mult_pipe @m2
+    // CHECK-NOT: calyx.std_mult_pipe @m3
+    // CHECK:     calyx.std_mult_pipe @m4
+    %m0.clk, %m0.reset, %m0.go, %m0.left, %m0.right, %m0.out, %m0.done = calyx.std_mult_pipe @m0 : i1, i1, i1, i32, i32, i32, i1
+    %m1.clk, %m1.reset, %m1.go, %m1.left, %m1.right, %m1.out, %m1.done = calyx.std_mult_pipe @m1 : i1, i1, i1, i32, i32, i32, i1
+    %m2.clk, %m2.reset, %m2.go, %m2.left, %m2.right, %m2.out, %m2.done = calyx.std_mult_pipe @m2 : i1, i1, i1, i32, i32, i32, i1
+    %m3.clk, %m3.reset, %m3.go, %m3.left, %m3.right, %m3.out, %m3.done = calyx.std_mult_pipe @m3 : i1, i1, i1, i32, i32, i32, i1
+    // Cells of a different width are not merged.
+    %m4.clk, %m4.reset, %m4.go, %m4.left, %m4.right, %m4.out, %m4.done = calyx.std_mult_pipe @m4 : i1, i1, i1, i16, i16, i16, i1
+    %c1_i1 = hw.constant 1 : i1
+    %c4_i32 = hw.constant 4 : i32
+    %c4_i16 = hw.constant 4 : i16
+    calyx.wires {
+      // CHECK-LABEL: calyx.group @A
+      // CHECK:         calyx.assign %m0.left = %c4_i32
+      calyx.group @A {
+        calyx.assign %m0.left = %c4_i32 : i32
+        calyx.assign %m0.right = %c4_i32 : i32
+        calyx.assign %m0.go = %c1_i1 : i1
+        calyx.assign %r.in = %m0.out : i32
+        calyx.assign %r.write_en = %m0.done : i1
+        calyx.group_done %r.done : i1
+      }
+      // Runs after @A, so it can reuse @m0.
+      // CHECK-LABEL: calyx.group @B
+      // CHECK:         calyx.assign %m0.left = %r.out
+      // CHECK:         calyx.assign %r.in = %m0.out
+      calyx.group @B {
+        calyx.assign %m1.left = %r.out : i32
+        calyx.assign %m1.right = %c4_i32 : i32
+        calyx.assign %m1.go = %c1_i1 : i1
+        calyx.assign %r.in = %m1.out : i32
+        calyx.assign %r.write_en = %m1.done : i1
+        calyx.group_done %r.done : i1
+      }
+      // Runs in parallel with @B, so it needs a cell of its own.
+      // CHECK-LABEL: calyx.group @C
+      // CHECK:         calyx.assign %m2.left = %c4_i32
+      calyx.group @C {
+        calyx.assign %m2.left = %c4_i32 : i32
+        calyx.assign %m2.right = %c4_i32 : i32
+        calyx.assign %m2.go = %c1_i1 : i1
+        calyx.assign %c.in = %m2.done : i1
+        calyx.assign %c.write_en = %m2.done : i1
+        calyx.group_done %c.done : i1
+      }
+      // Exclusive with @A through the `calyx.if`, so it can reuse @m0.
+      // CHECK-LABEL: calyx.group @D
+      // CHECK:         calyx.assign %m0.left = %c4_i32
+      calyx.group @D {
+        calyx.assign %m3.left = %c4_i32 : i32
+        calyx.assign %m3.right = %c4_i32 : i32
+        calyx.assign %m3.go = %c1_i1 : i1
+        calyx.assign %r.in = %m3.out : i32
+        calyx.assign %r.write_en = %m3.done : i1
+        calyx.group_done %r.done : i1
+      }
+      // CHECK-LABEL: calyx.group @E
+      // CHECK:         calyx.assign %m4.left = %c4_i16
+      calyx.group @E {
+        calyx.assign %m4.left = %c4_i16 : i16
+        calyx.assign %m4.right = %c4_i16 : i16
+        calyx.assign %m4.go = %c1_i1 : i1
+        calyx.assign %c.in = %m4.done : i1
+        calyx.assign %c.write_en = %m4.done : i1
+        calyx.group_done %c.done : i1
+      }
+    }
+    calyx.control {
+      calyx.seq {
+        calyx.if %c.out {
+          calyx.enable @A
+        } else {
+          calyx.enable @D
+        }
+        calyx.par {
+          calyx.enable @B
+          calyx.enable @C
+        }
+        calyx.enable @E
+      }
+    }
+  }
+
+  // The result of @x is still read by @B after @C ran, so sharing @x with @y
+  // would let @C overwrite it.
+  // CHECK-LABEL: calyx.component @liveOut
+  calyx.component @liveOut(%go: i1 {go}, %clk: i1 {clk}, %reset: i1 {reset}) -> (%done: i1 {done}) {
+    %r.in, %r.write_en, %r.clk, %r.reset, %r.out, %r.done = calyx.register @r : i32, i1, i1, i1, i32, i1
+    %s.in, %s.write_en, %s.clk, %s.reset, %s.out, %s.done = calyx.register @s : i32, i1, i1, i1, i32, i1
+    // CHECK: calyx.std_mult_pipe @x
+    // CHECK: calyx.std_mult_pipe @y
+    %x.clk, %x.reset, %x.go, %x.left, %x.right, %x.out, %x.done = calyx.std_mult_pipe @x : i1, i1, i1, i32, i32, i32, i1
+    %y.clk, %y.reset, %y.go, %y.left, %y.right, %y.out, %y.done = calyx.std_mult_pipe @y : i1, i1, i1, i32, i32, i32, i1
+    %c1_i1 = hw.constant 1 : i1
+    %c4_i32 = hw.constant 4 : i32
+    calyx.wires {
+      calyx.group @A {
+        calyx.assign %x.left = %c4_i32 : i32
+        calyx.assign %x.right = %c4_i32 : i32
+        calyx.assign %x.go = %c1_i1 : i1
+        calyx.group_done %x.done : i1
+      }
+      // CHECK-LABEL: calyx.group @C
+      // CHECK:         calyx.assign %y.left = %c4_i32
+      calyx.group @C {
+        calyx.assign %y.left = %c4_i32 : i32
+        calyx.assign %y.right = %c4_i32 : i32
+        calyx.assign %y.go = %c1_i1 : i1
+        calyx.assign %s.in = %y.out : i32
+        calyx.assign %s.write_en = %y.done : i1
+        calyx.group_done %s.done : i1
+      }
+      // CHECK-LABEL: calyx.group @B
+      // CHECK:         calyx.assign %r.in = %x.out
+      calyx.group @B {
+        calyx.assign %r.in = %x.out : i32
+        calyx.assign %r.write_en = %c1_i1 : i1
+        calyx.group_done %r.done : i1
+      }
+    }
+    calyx.control {
+      calyx.seq {
+        calyx.enable @A
+        calyx.enable @C
+        calyx.enable @B
+      }
+    }
+  }
+}
@@ -0,0 +1,61 @@
+// RUN: circt-opt -handshake-insert-buffers=strategy=throughput %s --split-input-file | FileCheck %s
+// RUN: circt-opt -handshake-insert-buffers="strategy=throughput target-ii=3" %s --split-input-file | FileCheck %s --check-prefix=II3
+// RUN: circt-opt -handshake-insert-buffers="strategy=throughput target-ii=2" %s --split-input-file --verify-diagnostics > /dev/null
+
+// The short path of the reconvergent fork has to hold the tokens that arrive
+// while the sequential buffer on the long path is still busy. The results
+// leave the circuit independently and are not balanced.
+
+// CHECK-LABEL: handshake.func @reconvergent(
+// CHECK-SAME:      %[[ARG0:.+]]: i32, %[[ARG1:.+]]: none
+// CHECK-NEXT:    %[[FORK:.+]]:2 = fork [2] %[[ARG0]] : i32
+// CHECK-NEXT:    %[[SHORT:.+]] = buffer [3] fifo %[[FORK]]#1 : i32
+// CHECK-NEXT:    %[[LONG:.+]] = buffer [3] seq %[[FORK]]#0 : i32
+// CHECK-NEXT:    %[[SUM:.+]] = arith.addi %[[LONG]], %[[SHORT]] : i32
+// CHECK-NEXT:    return %[[SUM]], %[[ARG1]] : i32, none
+
+// With a new token entering only every third cycle, one slot suffices.
+
+// II3-LABEL: handshake.func @reconvergent(
+// II3:         buffer [1] fifo
+// II3:         buffer [3] seq
+// II3-NOT:     buffer
+handshake.func @reconvergent(%arg0: i32, %arg1: none, ...) -> (i32, none) {
+  %0:2 = fork [2] %arg0 : i32
+  %1 = buffer [3] seq %0#0 : i32
+  %2 = arith.addi %1, %0#1 : i32
+  return %2, %arg1 : i32, none
+}
+
+// -----
+
+// The loop through the merge holds six cycles of sequential buffers, which
+// limits the initiation interval to six. The channel closing the loop is a
+// back edge and needs no buffer, while the short path into the addition waits
+// for one token.
+
+// CHECK-LABEL: handshake.func @loop(
+// CHECK-SAME:      %[[ARG0:.+]]: i32, %[[ARG1:.+]]: none
+// CHECK-NEXT:    %[[MERGE:.+]] = merge %[[ARG0]], %[[SUM:.+]] : i32
+// CHECK-NEXT:    %[[STAGE:.+]] = buffer [4] seq %[[MERGE]] : i32
+// CHECK-NEXT:    %[[FORK:.+]]:3 = fork [3] %[[STAGE]] : i32
+// CHECK-NEXT:    %[[SHORT:.+]] = buffer [1] fifo %[[FORK]]#1 : i32
+// CHECK-NEXT:    %[[LONG:.+]] = buffer [2] seq %[[FORK]]#0 : i32
+// CHECK-NEXT:    %[[SUM]] = arith.addi %[[LONG]], %[[SHORT]] : i32
+// CHECK-NEXT:    return %[[FORK]]#2, %[[ARG1]] : i32, none
+
+// II3-LABEL: handshake.func @loop(
+// II3:         buffer [4] seq
+// II3:         buffer [1] fifo
+// II3:         buffer [2] seq
+// II3-NOT:     buffer
+
+// expected-warning @below {{cannot reach target initiation interval 2; the longest cycle of the circuit limits it to 6}}
+handshake.func @loop(%arg0: i32, %arg1: none, ...) -> (i32, none) {
+  %0 = merge %arg0, %4 : i32
+  %1 = buffer [4] seq %0 : i32
+  %2:3 = fork [3] %1 : i32
+  %3 = buffer [2] seq %2#0 : i32
+  %4 = arith.addi %3, %2#1 : i32
+  return %2#2, %arg1 : i32, none
+}
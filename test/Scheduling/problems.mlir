@@ -1,6 +1,8 @@
 // RUN: circt-opt %s -ssp-roundtrip=verify
 // RUN: circt-opt %s -ssp-schedule=scheduler=asap | FileCheck %s -check-prefixes=CHECK,ASAP
 // RUN: circt-opt %s -ssp-schedule=scheduler=simplex | FileCheck %s -check-prefixes=CHECK,SIMPLEX
+// RUN: circt-opt %s -ssp-schedule="scheduler=simplex options=incremental" | FileCheck %s -check-prefixes=CHECK,SIMPLEX
+// RUN: circt-opt %s -test-incremental-simplex-scheduler | FileCheck %s -check-prefixes=CHECK,SIMPLEX
 // RUN: %if or-tools %{ circt-opt %s -ssp-schedule=scheduler=lp | FileCheck %s -check-prefixes=CHECK,LINEAR %}
 
 // CHECK-LABEL: unit_latencies
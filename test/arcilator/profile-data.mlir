@@ -0,0 +1,52 @@
+// RUN: rm -rf %t && split-file %s %t
+// RUN: arcilator %t/top.mlir --until-before=llvm-lowering | FileCheck %s
+// RUN: arcilator %t/top.mlir --until-before=llvm-lowering --profile-data=%t/busy.prof | FileCheck %s
+// RUN: arcilator %t/top.mlir --until-before=llvm-lowering --profile-data=%t/idle.prof | FileCheck %s --check-prefix=IDLE
+// RUN: not arcilator %t/top.mlir --until-before=llvm-lowering --profile-data=%t/guarded.prof 2>&1 | FileCheck %s --check-prefix=GUARDED
+
+// Without a profile, or if both clocks tick all the time, both clock domains
+// stay in the model.
+// CHECK-NOT: func.func @Top_domain
+// CHECK-LABEL: arc.model @Top
+// CHECK-NOT: call @Top_domain
+
+// A clock domain that rarely executes is moved into its own function.
+// IDLE-NOT: func.func @Top_domain0
+// IDLE-LABEL: func.func @Top_domain1(
+// IDLE: arc.state_write
+// IDLE-NOT: func.func @Top_domain
+// IDLE-LABEL: arc.model @Top
+// IDLE: scf.if
+// IDLE-NEXT: call @Top_domain1(
+
+// A profile recorded with different options, here with activity guards that add
+// domains, numbers the domains differently and is rejected.
+// GUARDED: error: profile describes 3 clock domains, but the model has 2
+
+//--- top.mlir
+hw.module @Top(in %clk0 : !seq.clock, in %clk1 : !seq.clock, in %a : i4, out x : i4, out y : i4) {
+  %0 = comb.add %a, %a : i4
+  %r0 = seq.compreg %0, %clk0 : i4
+  %1 = comb.mul %a, %a : i4
+  %r1 = seq.compreg %1, %clk1 : i4
+  hw.output %r0, %r1 : i4, i4
+}
+
+//--- busy.prof
+cycles calls cycles/call %eval name
+100000 1000 100 100 profile/eval
+40000 1000 40 40 profile/domains/0
+40000 1000 40 40 profile/domains/1
+
+//--- idle.prof
+cycles calls cycles/call %eval name
+100000 1000 100 100 profile/eval
+40000 1000 40 40 profile/domains/0
+400 5 80 0.4 profile/domains/1
+
+//--- guarded.prof
+cycles calls cycles/call %eval name
+100000 1000 100 100 profile/eval
+40000 1000 40 40 profile/domains/0
+40000 1000 40 40 profile/domains/1
+400 5 80 0.4 profile/domains/2
@@ -0,0 +1,119 @@
+// RUN: rm -rf %t && split-file %s %t && mkdir %t/shadow
+// RUN: circt-verilog --ir-moore --cache-dir %t/cache -I%t/shadow -I%t/inc %t/top.sv %t/foo.sv %t/bar.sv %t/warn.sv | FileCheck %s --check-prefix=CHECK-FIRST
+// RUN: ls %t/cache | FileCheck %s --check-prefix=CHECK-FILES
+// RUN: ls %t/cache | FileCheck %s --check-prefix=CHECK-NO-WARN-FILE
+
+// Replace the cached bodies with recognizable ones to check that they are
+// reused.
+// RUN: cp %t/fake-foo.mlir %t/cache/Foo-*.mlirbc
+// RUN: cp %t/fake-bar.mlir %t/cache/Bar-*.mlirbc
+// RUN: circt-verilog --ir-moore --cache-dir %t/cache -I%t/shadow -I%t/inc %t/top.sv %t/foo.sv %t/bar.sv %t/warn.sv | FileCheck %s --check-prefix=CHECK-HIT
+
+// Bodies whose conversion emitted warnings are not cached, such that the
+// warnings are reported again.
+// RUN: circt-verilog --ir-moore --cache-dir %t/cache -I%t/shadow -I%t/inc %t/top.sv %t/foo.sv %t/bar.sv %t/warn.sv 2>&1 >/dev/null | FileCheck %s --check-prefix=CHECK-WARN
+
+// Changing a source file only invalidates the modules defined in it.
+// RUN: cp %t/foo2.sv %t/foo.sv
+// RUN: circt-verilog --ir-moore --cache-dir %t/cache -I%t/shadow -I%t/inc %t/top.sv %t/foo.sv %t/bar.sv %t/warn.sv | FileCheck %s --check-prefix=CHECK-EDIT
+
+// A new file shadowing an included one invalidates the modules including it.
+// RUN: cp %t/inc2.svh %t/shadow/inc.svh
+// RUN: circt-verilog --ir-moore --cache-dir %t/cache -I%t/shadow -I%t/inc %t/top.sv %t/foo.sv %t/bar.sv %t/warn.sv | FileCheck %s --check-prefix=CHECK-SHADOW
+
+// Changing the macro environment does not reuse any entry.
+// RUN: circt-verilog --ir-moore --cache-dir %t/cache -I%t/shadow -I%t/inc -DFOO_VALUE=7 %t/top.sv %t/foo.sv %t/bar.sv %t/warn.sv | FileCheck %s --check-prefix=CHECK-DEFINE
+// REQUIRES: slang
+
+// CHECK-FILES-DAG: Bar-{{[0-9a-f]+}}.mlirbc
+// CHECK-FILES-DAG: Foo-{{[0-9a-f]+}}.mlirbc
+// CHECK-FILES-DAG: Top-{{[0-9a-f]+}}.mlirbc
+
+// CHECK-NO-WARN-FILE-NOT: Warn-
+
+// CHECK-WARN: warning: unreachable code
+
+// CHECK-FIRST-LABEL: moore.module private @Foo(
+// CHECK-FIRST:         moore.constant 1 : i8
+// CHECK-FIRST-LABEL: moore.module private @Bar(
+// CHECK-FIRST:         moore.constant 3 : i8
+
+// CHECK-HIT-LABEL: moore.module private @Foo(
+// CHECK-HIT:         moore.constant 42 : i8
+// CHECK-HIT-LABEL: moore.module private @Bar(
+// CHECK-HIT:         moore.constant 43 : i8
+
+// CHECK-EDIT-LABEL: moore.module private @Foo(
+// CHECK-EDIT:         moore.constant 2 : i8
+// CHECK-EDIT-LABEL: moore.module private @Bar(
+// CHECK-EDIT:         moore.constant 43 : i8
+
+// CHECK-SHADOW-LABEL: moore.module private @Foo(
+// CHECK-SHADOW:         moore.constant 2 : i8
+// CHECK-SHADOW-LABEL: moore.module private @Bar(
+// CHECK-SHADOW:         moore.constant 5 : i8
+
+// CHECK-DEFINE-LABEL: moore.module private @Foo(
+// CHECK-DEFINE:         moore.constant 7 :
+// CHECK-DEFINE-LABEL: moore.module private @Bar(
+// CHECK-DEFINE:         moore.constant 5 : i8
+
+//--- top.sv
+module Top(output bit [7:0] x, output bit [7:0] y, output bit [7:0] z);
+  Foo foo(x);
+  Bar bar(y);
+  Warn warn(z);
+endmodule
+
+//--- foo.sv
+`ifndef FOO_VALUE
+`define FOO_VALUE 8'd1
+`endif
+module Foo(output bit [7:0] a);
+  assign a = `FOO_VALUE;
+endmodule
+
+//--- foo2.sv
+`ifndef FOO_VALUE
+`define FOO_VALUE 8'd2
+`endif
+module Foo(output bit [7:0] a);
+  assign a = `FOO_VALUE;
+endmodule
+
+//--- bar.sv
+`include "inc.svh"
+module Bar(output bit [7:0] b);
+  assign b = `BAR_VALUE;
+endmodule
+
+//--- warn.sv
+module Warn(output bit [7:0] c);
+  function automatic bit [7:0] f();
+    return 8'd9;
+    return 8'd10;
+  endfunction
+  assign c = f();
+endmodule
+
+//--- inc/inc.svh
+`define BAR_VALUE 8'd3
+
+//--- inc2.svh
+`define BAR_VALUE 8'd5
+
+//--- fake-foo.mlir
+module {
+  moore.module @Foo(out a : !moore.i8) {
+    %0 = moore.constant 42 : i8
+    moore.output %0 : !moore.i8
+  }
+}
+
+//--- fake-bar.mlir
+module {
+  moore.module @Bar(out b : !moore.i8) {
+    %0 = moore.constant 43 : i8
+    moore.output %0 : !moore.i8
+  }
+}
@@ -60,8 +60,9 @@ tool_dirs = [
 tools = [
     'arcilator', 'circt-as', 'circt-capi-ir-test', 'circt-capi-om-test',
     'circt-capi-firrtl-test', 'circt-capi-firtool-test', 'circt-dis',
-    'circt-lec', 'circt-reduce', 'circt-synth', 'circt-test', 'circt-translate',
-    'firtool', 'hlstool', 'om-linker', 'ibistool'
+    'circt-lec', 'circt-lsp-server', 'circt-reduce', 'circt-synth',
+    'circt-test', 'circt-translate', 'firtool', 'hlstool', 'om-linker',
+    'ibistool'
 ]
 
 if "CIRCT_OPT_CHECK_IR_ROUNDTRIP" in os.environ:
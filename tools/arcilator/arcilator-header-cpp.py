@@ -296,16 +296,37 @@ for model in models:
   print()
   print(f"class {model.name} {{")
   print("public:")
-  print(f"  std::vector<uint8_t> storage;")
+  print(f"  StateStorage storage;")
   print(f"  {model.name}View view;")
   print()
   print(
-      f"  {model.name}() : storage({model.name}Layout::numStateBytes, 0), view(&storage[0]) {{"
+      f"  {model.name}() : storage({model.name}Layout::numStateBytes), view(&storage[0]) {{"
   )
   if model.initialFnSym:
     print(f"    {model.initialFnSym}(&storage[0]);")
   print("  }")
   print(f"  void eval() {{ {model.name}_eval(&storage[0]); }}")
+
+  print("  Snapshot snapshot() const {")
+  print("    return Snapshot(&storage[0], storage.size());")
+  print("  }")
+  print("  Snapshot snapshot(const Snapshot &base) const {")
+  print("    return Snapshot(&storage[0], storage.size(), base);")
+  print("  }")
+  print("  bool restore(const Snapshot &snapshot) {")
+  print("    if (snapshot.size() != storage.size())")
+  print("      return false;")
+  print("    snapshot.restore(&storage[0]);")
+  print("    return true;")
+  print("  }")
+  print("  bool saveCheckpoint(std::basic_ostream<char> &os) const {")
+  print(f"    return snapshot().write(os, {model.name}Layout::name);")
+  print("  }")
+  print("  bool loadCheckpoint(std::basic_istream<char> &is) {")
+  print("    Snapshot snapshot;")
+  print(f"    return snapshot.read(is, {model.name}Layout::name, storage.size()) &&")
+  print("           restore(snapshot);")
+  print("  }")
   print(
       f"  ValueChangeDump<{model.name}Layout> vcd(std::basic_ostream<char> &os) {{"
   )
@@ -314,6 +335,9 @@ for model in models:
   print("    vcd.writeDumpvars();")
   print("    return vcd;")
   print("  }")
+  print("  void writeProfile(std::basic_ostream<char> &os) const {")
+  print(f"    ::writeProfile<{model.name}Layout>(os, &storage[0]);")
+  print("  }")
   print("};")
 
   # Generate a port name macro.
@@ -1,14 +1,31 @@
 // NOLINTBEGIN
 #pragma once
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <cstdarg>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <functional>
+#include <istream>
+#include <memory>
+#include <new>
 #include <ostream>
+#include <string>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
 // Sanity checks for binary compatibility
 #ifdef __BYTE_ORDER__
 #if (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
@@ -60,6 +77,27 @@ ARC_ENV_DECL_GET_PRINT_STREAM(id) {
 }
 #endif // ARC_NO_DEFAULT_GET_PRINT_STREAM
 
+// Called by models compiled with `--profile` around the code they measure. The
+// default reads the time stamp counter where available. Define
+// ARC_NO_DEFAULT_READ_CYCLE_COUNTER to provide a different source, such as a
+// perf_event counter on Linux.
+#define ARC_ENV_DECL_READ_CYCLE_COUNTER()                                      \
+  ARC_EXPORT uint64_t _arc_env_read_cycle_counter()
+
+#ifndef ARC_NO_DEFAULT_READ_CYCLE_COUNTER
+ARC_ENV_DECL_READ_CYCLE_COUNTER() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t value;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+  return value;
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+#endif // ARC_NO_DEFAULT_READ_CYCLE_COUNTER
+
 // ----------------
 
 struct Signal {
@@ -92,6 +130,261 @@ struct Memory {
   } words[Depth];
 };
 
+// The storage of a model. Large storage is mapped directly from the operating
+// system, which only backs the pages that are actually written with host
+// memory. The untouched parts of a sparsely accessed memory then cost nothing,
+// provided the model was compiled with `--large-memory-bytes` such that large
+// memories do not share pages with other states. Small storage comes from the
+// heap.
+class StateStorage {
+public:
+  // Storage of at least this many bytes is mapped rather than allocated.
+  static constexpr size_t mapThreshold = size_t(1) << 20;
+
+  explicit StateStorage(size_t numBytes) : numBytes(numBytes) {
+#if defined(__unix__) || defined(__APPLE__)
+    if (numBytes >= mapThreshold) {
+      int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+      flags |= MAP_NORESERVE;
+#endif
+      void *ptr = mmap(nullptr, numBytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+      if (ptr != MAP_FAILED) {
+        bytes = static_cast<uint8_t *>(ptr);
+        mapped = true;
+        return;
+      }
+    }
+#endif
+    bytes =
+        static_cast<uint8_t *>(std::calloc(std::max<size_t>(numBytes, 1), 1));
+    if (!bytes)
+      throw std::bad_alloc();
+  }
+
+  ~StateStorage() {
+#if defined(__unix__) || defined(__APPLE__)
+    if (mapped) {
+      munmap(bytes, numBytes);
+      return;
+    }
+#endif
+    std::free(bytes);
+  }
+
+  StateStorage(const StateStorage &) = delete;
+  StateStorage &operator=(const StateStorage &) = delete;
+
+  uint8_t *data() { return bytes; }
+  const uint8_t *data() const { return bytes; }
+  size_t size() const { return numBytes; }
+  uint8_t &operator[](size_t i) { return bytes[i]; }
+  const uint8_t &operator[](size_t i) const { return bytes[i]; }
+
+private:
+  uint8_t *bytes = nullptr;
+  size_t numBytes;
+  bool mapped = false;
+};
+
+// A copy of the entire storage of a model, including its memories. The storage
+// is split into pages. A snapshot taken relative to an earlier one shares all
+// pages that did not change since then, and pages that are all zero are not
+// stored at all. Snapshots are immutable and cheap to copy, so a model can be
+// brought into an interesting state once and then be forked many times by
+// restoring the same snapshot into different instances.
+class Snapshot {
+public:
+  static constexpr size_t pageSize = 4096;
+  static constexpr uint32_t fileVersion = 1;
+
+  Snapshot() = default;
+
+  // Capture `numBytes` of model storage.
+  Snapshot(const uint8_t *state, size_t numBytes)
+      : Snapshot(state, numBytes, Snapshot()) {}
+
+  // Capture `numBytes` of model storage, sharing unchanged pages with `base`.
+  Snapshot(const uint8_t *state, size_t numBytes, const Snapshot &base)
+      : numBytes(numBytes) {
+    pages.reserve(getNumPages());
+    bool sameSize = base.numBytes == numBytes;
+    for (size_t i = 0; i < getNumPages(); ++i) {
+      const uint8_t *data = state + i * pageSize;
+      size_t n = getPageBytes(i);
+      if (sameSize && pageEquals(base.pages[i], data, n))
+        pages.push_back(base.pages[i]);
+      else if (pageEquals(nullptr, data, n))
+        pages.push_back(nullptr);
+      else
+        pages.push_back(std::make_shared<Page>(data, data + n));
+    }
+  }
+
+  // The number of bytes of model storage captured by this snapshot.
+  size_t size() const { return numBytes; }
+
+  // Copy the snapshot back into `size()` bytes of model storage. Pages that
+  // are already zero are left alone, such that restoring into fresh storage
+  // does not touch the untouched parts of sparse memories.
+  void restore(uint8_t *state) const {
+    for (size_t i = 0; i < pages.size(); ++i) {
+      uint8_t *data = state + i * pageSize;
+      size_t n = getPageBytes(i);
+      if (pages[i])
+        std::copy(pages[i]->begin(), pages[i]->end(), data);
+      else if (!pageEquals(nullptr, data, n))
+        std::fill(data, data + n, 0);
+    }
+  }
+
+  // Serialize the snapshot of the model called `name`. Only the pages that
+  // are not all zero are written.
+  bool write(std::basic_ostream<char> &os, const char *name) const {
+    uint32_t nameLength = strlen(name);
+    uint64_t numStoredPages =
+        std::count_if(pages.begin(), pages.end(),
+                      [](const std::shared_ptr<const Page> &p) { return !!p; });
+    os.write(fileMagic, sizeof(fileMagic));
+    writeInt(os, fileVersion);
+    writeInt(os, nameLength);
+    os.write(name, nameLength);
+    writeInt(os, uint64_t(numBytes));
+    writeInt(os, uint32_t(pageSize));
+    writeInt(os, numStoredPages);
+    for (size_t i = 0; i < pages.size(); ++i) {
+      if (!pages[i])
+        continue;
+      writeInt(os, uint64_t(i));
+      os.write((const char *)pages[i]->data(), pages[i]->size());
+    }
+    return bool(os);
+  }
+
+  // Deserialize a snapshot of `numBytes` of storage of the model called
+  // `name`. Returns false if the stream is malformed or holds a snapshot of a
+  // different model or storage size. The header is checked before anything is
+  // allocated, such that a corrupt file cannot request huge amounts of memory.
+  bool read(std::basic_istream<char> &is, const char *name, size_t numBytes) {
+    char magic[sizeof(fileMagic)];
+    uint32_t version, nameLength, filePageSize;
+    uint64_t fileNumBytes, numStoredPages;
+    is.read(magic, sizeof(magic));
+    if (!is || !std::equal(magic, magic + sizeof(magic), fileMagic))
+      return false;
+    if (!readInt(is, version) || version != fileVersion)
+      return false;
+    if (!readInt(is, nameLength) || nameLength != strlen(name))
+      return false;
+    std::string fileName(nameLength, '\0');
+    is.read(&fileName[0], nameLength);
+    if (!is || fileName != name)
+      return false;
+    if (!readInt(is, fileNumBytes) || fileNumBytes != numBytes ||
+        !readInt(is, filePageSize) || filePageSize != pageSize)
+      return false;
+
+    Snapshot result;
+    result.numBytes = numBytes;
+    if (!readInt(is, numStoredPages) || numStoredPages > result.getNumPages())
+      return false;
+    result.pages.resize(result.getNumPages());
+    for (uint64_t j = 0; j < numStoredPages; ++j) {
+      uint64_t i;
+      if (!readInt(is, i) || i >= result.pages.size() || result.pages[i])
+        return false;
+      auto page = std::make_shared<Page>(result.getPageBytes(i));
+      is.read((char *)page->data(), page->size());
+      if (!is)
+        return false;
+      result.pages[i] = std::move(page);
+    }
+    *this = std::move(result);
+    return true;
+  }
+
+private:
+  using Page = std::vector<uint8_t>;
+  static constexpr char fileMagic[8] = {'A', 'R', 'C', 'S', 'N', 'A', 'P', 0};
+
+  size_t getNumPages() const { return (numBytes + pageSize - 1) / pageSize; }
+  size_t getPageBytes(size_t i) const {
+    return std::min(pageSize, numBytes - i * pageSize);
+  }
+
+  // Check whether `page` holds the `n` bytes at `data`. A null page is all
+  // zeros.
+  static bool pageEquals(const std::shared_ptr<const Page> &page,
+                         const uint8_t *data, size_t n) {
+    if (!page)
+      return std::all_of(data, data + n, [](uint8_t b) { return b == 0; });
+    return page->size() == n && std::equal(data, data + n, page->begin());
+  }
+
+  template <typename T>
+  static void writeInt(std::basic_ostream<char> &os, T value) {
+    os.write((const char *)&value, sizeof(T));
+  }
+  template <typename T>
+  static bool readInt(std::basic_istream<char> &is, T &value) {
+    is.read((char *)&value, sizeof(T));
+    return bool(is);
+  }
+
+  size_t numBytes = 0;
+  std::vector<std::shared_ptr<const Page>> pages;
+};
+
+// Print the measurements of a model compiled with `--profile`, sorted by the
+// number of cycles spent. Every scope of the hierarchy with a `cycles` and a
+// `calls` state, such as `profile/arcs/<arc>`, is one entry of the profile.
+template <class ModelLayout>
+void writeProfile(std::basic_ostream<char> &os, const uint8_t *state) {
+  struct Entry {
+    std::string name;
+    uint64_t cycles;
+    uint64_t calls;
+  };
+  std::vector<Entry> entries;
+  auto read = [&](const Signal &signal) {
+    uint64_t value;
+    std::memcpy(&value, state + signal.offset, sizeof(value));
+    return value;
+  };
+  std::function<void(const Hierarchy &, const std::string &)> collect =
+      [&](const Hierarchy &hierarchy, const std::string &prefix) {
+        const Signal *cycles = nullptr, *calls = nullptr;
+        for (unsigned i = 0; i < hierarchy.numStates; ++i) {
+          if (std::strcmp(hierarchy.states[i].name, "cycles") == 0)
+            cycles = &hierarchy.states[i];
+          else if (std::strcmp(hierarchy.states[i].name, "calls") == 0)
+            calls = &hierarchy.states[i];
+        }
+        if (cycles && calls && cycles->numBits == 64 && calls->numBits == 64)
+          entries.push_back(Entry{prefix, read(*cycles), read(*calls)});
+        for (unsigned i = 0; i < hierarchy.numChildren; ++i)
+          collect(hierarchy.children[i],
+                  prefix + "/" + hierarchy.children[i].name);
+      };
+  for (unsigned i = 0; i < ModelLayout::hierarchy.numChildren; ++i)
+    collect(ModelLayout::hierarchy.children[i],
+            ModelLayout::hierarchy.children[i].name);
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) { return a.cycles > b.cycles; });
+  uint64_t total = 0;
+  for (auto &entry : entries)
+    if (entry.name == "profile/eval")
+      total = entry.cycles;
+  os << "cycles calls cycles/call %eval name\n";
+  for (auto &entry : entries) {
+    os << entry.cycles << " " << entry.calls << " "
+       << (entry.calls ? entry.cycles / entry.calls : 0) << " "
+       << (total ? 100.0 * entry.cycles / total : 0.0) << " " << entry.name
+       << "\n";
+  }
+}
+
 template <class ModelLayout>
 class ValueChangeDump {
 public:
@@ -67,6 +67,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
@@ -74,8 +75,23 @@
 
 #ifdef ARCILATOR_ENABLE_JIT
 #include "arcilator-jit-env.h"
+#include "mlir/IR/Threading.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Object/ArchiveWriter.h"
+#include "llvm/Support/SHA256.h"
+#include "llvm/Support/SmallVectorMemoryBuffer.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/TargetParser/Host.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 #endif
 
+#include <atomic>
 #include <optional>
 
 using namespace mlir;
@@ -151,6 +167,29 @@ static llvm::cl::opt<bool>
                    llvm::cl::desc("Optimize arcs into lookup tables"),
                    llvm::cl::init(true), llvm::cl::cat(mainCategory));
 
+static llvm::cl::opt<bool> shouldClusterState(
+    "cluster-state",
+    llvm::cl::desc("Lay out states by the clock domains accessing them"),
+    llvm::cl::init(false), llvm::cl::cat(mainCategory));
+
+static llvm::cl::opt<unsigned> largeMemoryBytes(
+    "large-memory-bytes",
+    llvm::cl::desc("Place memories of at least this many bytes on their own "
+                   "pages, such that the untouched parts of sparsely accessed "
+                   "memories occupy no host memory (0 to disable)"),
+    llvm::cl::init(0), llvm::cl::cat(mainCategory));
+
+static llvm::cl::opt<bool> shouldGuardActivity(
+    "activity-guards",
+    llvm::cl::desc("Skip logic whose input states have not changed since "
+                   "its last evaluation"),
+    llvm::cl::init(false), llvm::cl::cat(mainCategory));
+
+static llvm::cl::opt<bool> shouldProfile(
+    "profile",
+    llvm::cl::desc("Count the cycles spent in each arc and clock domain"),
+    llvm::cl::init(false), llvm::cl::cat(mainCategory));
+
 static llvm::cl::opt<bool>
     printDebugInfo("print-debug-info",
                    llvm::cl::desc("Print debug information"),
@@ -184,6 +223,13 @@ static llvm::cl::opt<unsigned> splitFuncsThreshold(
         "Split large MLIR functions that occur above the given size threshold"),
     llvm::cl::ValueOptional, llvm::cl::cat(mainCategory));
 
+static llvm::cl::opt<std::string> profileData(
+    "profile-data",
+    llvm::cl::desc("Profile of a previous simulation of a model compiled with "
+                   "--profile, used to guide inlining and the outlining of "
+                   "clock domains"),
+    llvm::cl::init(""), llvm::cl::cat(mainCategory));
+
 // Options to control early-out from pipeline.
 enum Until {
   UntilPreprocessing,
@@ -210,11 +256,21 @@ static llvm::cl::opt<Until> runUntilAfter(
     runUntilValues, llvm::cl::init(UntilEnd), llvm::cl::cat(mainCategory));
 
 // Options to control the output format.
-enum OutputFormat { OutputMLIR, OutputLLVM, OutputRunJIT, OutputDisabled };
+enum OutputFormat {
+  OutputMLIR,
+  OutputLLVM,
+  OutputObject,
+  OutputRunJIT,
+  OutputDisabled
+};
 static llvm::cl::opt<OutputFormat> outputFormat(
     llvm::cl::desc("Specify output format"),
     llvm::cl::values(clEnumValN(OutputMLIR, "emit-mlir", "Emit MLIR dialects"),
                      clEnumValN(OutputLLVM, "emit-llvm", "Emit LLVM"),
+                     clEnumValN(OutputObject, "emit-object",
+                                "Emit a native object file for the host, or "
+                                "an archive of object files if the code is "
+                                "split into multiple partitions"),
                      clEnumValN(OutputRunJIT, "run",
                                 "Run the simulation and emit its output"),
                      clEnumValN(OutputDisabled, "disable-output",
@@ -231,6 +287,18 @@ static llvm::cl::list<std::string> sharedLibs{
     "shared-libs", llvm::cl::desc("Libraries to link dynamically"),
     llvm::cl::MiscFlags::CommaSeparated, llvm::cl::cat(mainCategory)};
 
+static llvm::cl::opt<unsigned> codegenPartitions(
+    "codegen-partitions",
+    llvm::cl::desc("Split the LLVM IR into this many modules and generate "
+                   "native code for them in parallel"),
+    llvm::cl::init(1), llvm::cl::cat(mainCategory));
+
+static llvm::cl::opt<std::string> objectCacheDir(
+    "object-cache-dir",
+    llvm::cl::desc("Directory in which to cache native object files, keyed by "
+                   "the hash of their LLVM IR"),
+    llvm::cl::init(""), llvm::cl::cat(mainCategory));
+
 //===----------------------------------------------------------------------===//
 // Main Tool Logic
 //===----------------------------------------------------------------------===//
@@ -239,9 +307,90 @@ static bool untilReached(Until until) {
   return until >= runUntilBefore || until > runUntilAfter;
 }
 
+namespace {
+/// The arcs and clock domains classified by the profile of a previous
+/// simulation.
+struct ArcProfile {
+  std::vector<std::string> hotArcs;
+  std::vector<std::string> coldArcs;
+  std::vector<unsigned> coldDomains;
+  unsigned numDomains = 0;
+};
+} // namespace
+
+/// Load a profile as written by the runtime's `writeProfile`. Arcs executed in
+/// fewer than 1% of the model evaluations are cold. Of the remaining arcs, the
+/// most expensive ones that together account for 90% of the cycles spent in
+/// arcs are hot. Clock domains executed in fewer than 1% of the model
+/// evaluations are cold as well.
+static LogicalResult loadProfile(StringRef path, ArcProfile &profile) {
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (!buffer) {
+    llvm::errs() << "unable to open profile " << path << ": "
+                 << buffer.getError().message() << "\n";
+    return failure();
+  }
+
+  struct Entry {
+    StringRef name;
+    uint64_t cycles;
+    uint64_t calls;
+  };
+  SmallVector<Entry> arcs;
+  SmallVector<std::pair<unsigned, uint64_t>> domains;
+  uint64_t numEvals = 0;
+  SmallVector<StringRef> lines;
+  (*buffer)->getBuffer().split(lines, '\n', -1, false);
+  for (auto line : llvm::drop_begin(lines)) {
+    SmallVector<StringRef, 5> fields;
+    line.split(fields, ' ', -1, false);
+    Entry entry;
+    if (fields.size() != 5 || fields[0].getAsInteger(10, entry.cycles) ||
+        fields[1].getAsInteger(10, entry.calls)) {
+      llvm::errs() << "malformed profile " << path << ": `" << line << "`\n";
+      return failure();
+    }
+    entry.name = fields[4];
+    if (entry.name == "profile/eval")
+      numEvals = entry.calls;
+    else if (entry.name.consume_front("profile/arcs/"))
+      arcs.push_back(entry);
+    else if (entry.name.consume_front("profile/domains/")) {
+      unsigned index;
+      if (!entry.name.getAsInteger(10, index))
+        domains.push_back({index, entry.calls});
+    }
+  }
+
+  profile.numDomains = domains.size();
+  for (auto [index, calls] : domains)
+    if (calls * 100 < numEvals)
+      profile.coldDomains.push_back(index);
+
+  uint64_t hotCycles = 0;
+  for (auto &arc : arcs) {
+    if (arc.calls * 100 < numEvals)
+      profile.coldArcs.push_back(arc.name.str());
+    else
+      hotCycles += arc.cycles;
+  }
+  llvm::sort(arcs, [](auto &a, auto &b) { return a.cycles > b.cycles; });
+  uint64_t cycles = 0;
+  for (auto &arc : arcs) {
+    if (arc.calls * 100 < numEvals)
+      continue;
+    if (cycles * 10 >= hotCycles * 9)
+      break;
+    cycles += arc.cycles;
+    profile.hotArcs.push_back(arc.name.str());
+  }
+  return success();
+}
+
 /// Populate a pass manager with the arc simulator pipeline for the given
 /// command line options. This pipeline lowers modules to the Arc dialect.
-static void populateHwModuleToArcPipeline(PassManager &pm) {
+static void populateHwModuleToArcPipeline(PassManager &pm,
+                                          const ArcProfile &profile) {
   if (verbosePassExecutions)
     pm.addInstrumentation(
         std::make_unique<VerbosePassInstrumentation<mlir::ModuleOp>>(
@@ -328,20 +477,38 @@ static void populateHwModuleToArcPipeline(PassManager &pm) {
   // TODO: InlineArcs seems to not properly handle scf.if operations, thus the
   // following is commented out
   // pm.addPass(arc::createMuxToControlFlowPass());
-  if (shouldInline)
-    pm.addPass(arc::createInlineArcsPass());
+  if (shouldInline) {
+    arc::InlineArcsOptions opts;
+    opts.hotArcs = profile.hotArcs;
+    opts.coldArcs = profile.coldArcs;
+    pm.addPass(arc::createInlineArcsPass(opts));
+  }
 
   pm.addPass(arc::createMergeIfsPass());
   pm.addPass(createCSEPass());
   pm.addPass(arc::createArcCanonicalizerPass());
+  if (shouldGuardActivity)
+    pm.nest<arc::ModelOp>().addPass(arc::createInsertActivityGuardsPass());
+  if (shouldProfile)
+    pm.addPass(arc::createInsertProfilingPass());
 
   // Allocate states.
   if (untilReached(UntilStateAlloc))
     return;
   pm.addPass(arc::createLowerArcsToFuncsPass());
-  pm.nest<arc::ModelOp>().addPass(arc::createAllocateStatePass());
-  pm.addPass(arc::createLowerClocksToFuncsPass()); // no CSE between state alloc
-                                                   // and clock func lowering
+  {
+    arc::AllocateStateOptions opts;
+    opts.clusterByAccess = shouldClusterState;
+    opts.largeMemoryBytes = largeMemoryBytes;
+    pm.nest<arc::ModelOp>().addPass(arc::createAllocateStatePass(opts));
+  }
+  // No CSE between state alloc and clock func lowering.
+  {
+    arc::LowerClocksToFuncsOptions opts;
+    opts.coldDomains = profile.coldDomains;
+    opts.numDomains = profile.numDomains;
+    pm.addPass(arc::createLowerClocksToFuncsPass(opts));
+  }
   if (splitFuncsThreshold.getNumOccurrences()) {
     pm.addPass(arc::createSplitFuncs({splitFuncsThreshold}));
   }
@@ -361,6 +528,277 @@ static void populateArcToLLVMPipeline(PassManager &pm) {
   pm.addPass(arc::createArcCanonicalizerPass());
 }
 
+#ifdef ARCILATOR_ENABLE_JIT
+//===----------------------------------------------------------------------===//
+// Native Code Generation
+//===----------------------------------------------------------------------===//
+
+/// Report an LLVM error and return failure.
+static LogicalResult reportError(const Twine &message, llvm::Error error) {
+  llvm::errs() << message << ": " << llvm::toString(std::move(error)) << "\n";
+  return failure();
+}
+
+/// Create a target machine for the host that produces position-independent
+/// code, such that the objects can be both loaded into the JIT and linked into
+/// executables.
+static llvm::Expected<std::unique_ptr<llvm::TargetMachine>>
+createHostTargetMachine() {
+  auto builder = llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!builder)
+    return builder.takeError();
+  builder->setCodeGenOptLevel(llvm::CodeGenOptLevel::Aggressive);
+  builder->setRelocationModel(llvm::Reloc::PIC_);
+  return builder->createTargetMachine();
+}
+
+/// Compile an LLVM module given as bitcode to a native object file. If an
+/// object cache directory is set, the object is looked up by and stored under
+/// the hash of the bitcode, the host, and the tool version, and `fromCache` is
+/// set if it was found. This is called from multiple threads and only uses its
+/// own LLVM context.
+static llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>>
+compileBitcode(StringRef bitcode, StringRef name, bool &fromCache) {
+  SmallString<128> cachePath;
+  if (!objectCacheDir.empty()) {
+    auto triple = llvm::sys::getProcessTriple();
+    llvm::SHA256 hasher;
+    for (StringRef str : {StringRef(getCirctVersion()), StringRef(triple),
+                          llvm::sys::getHostCPUName(), bitcode}) {
+      hasher.update(std::to_string(str.size()));
+      hasher.update(":");
+      hasher.update(str);
+    }
+    cachePath = objectCacheDir;
+    llvm::sys::path::append(
+        cachePath, llvm::toHex(hasher.final(), /*LowerCase=*/true) + ".o");
+    if (auto buffer = llvm::MemoryBuffer::getFile(cachePath)) {
+      fromCache = true;
+      return std::move(*buffer);
+    }
+  }
+
+  llvm::LLVMContext llvmContext;
+  auto llvmModule =
+      llvm::parseBitcodeFile(llvm::MemoryBufferRef(bitcode, name), llvmContext);
+  if (!llvmModule)
+    return llvmModule.takeError();
+  auto targetMachine = createHostTargetMachine();
+  if (!targetMachine)
+    return targetMachine.takeError();
+
+  SmallVector<char, 0> object;
+  {
+    llvm::raw_svector_ostream os(object);
+    llvm::legacy::PassManager pm;
+    if ((*targetMachine)
+            ->addPassesToEmitFile(pm, os, nullptr,
+                                  llvm::CodeGenFileType::ObjectFile))
+      return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                     "target cannot emit object files");
+    pm.run(**llvmModule);
+  }
+
+  // A failure to populate the cache only costs time in the next run. The
+  // object is written to a temporary file first, such that concurrent runs
+  // never observe a partial entry.
+  if (!cachePath.empty() &&
+      !llvm::sys::fs::create_directories(objectCacheDir))
+    llvm::consumeError(
+        llvm::writeToOutput(cachePath, [&](raw_ostream &os) -> llvm::Error {
+          os << StringRef(object.data(), object.size());
+          return llvm::Error::success();
+        }));
+
+  return std::make_unique<llvm::SmallVectorMemoryBuffer>(
+      std::move(object), name, /*RequiresNullTerminator=*/false);
+}
+
+/// Static constructors and destructors in object files are only run by JIT
+/// platforms backed by the ORC runtime, which arcilator does not use. Move the
+/// ones of a module into the `arcStaticCtors` and `arcStaticDtors` functions,
+/// which `runObjects` calls around the simulation instead.
+static constexpr llvm::StringLiteral arcStaticCtors = "_arc_static_ctors";
+static constexpr llvm::StringLiteral arcStaticDtors = "_arc_static_dtors";
+
+static void lowerStaticInitializers(llvm::Module &module) {
+  auto lower = [&](StringRef arrayName, StringRef funcName, auto elements,
+                   bool highestFirst) {
+    SmallVector<std::pair<unsigned, llvm::Function *>> funcs;
+    for (auto element : elements)
+      if (element.Func)
+        funcs.push_back({element.Priority, element.Func});
+    std::stable_sort(funcs.begin(), funcs.end(), [&](auto &a, auto &b) {
+      return highestFirst ? a.first > b.first : a.first < b.first;
+    });
+    if (auto *array = module.getNamedGlobal(arrayName))
+      array->eraseFromParent();
+
+    auto &context = module.getContext();
+    auto *func = llvm::Function::Create(
+        llvm::FunctionType::get(llvm::Type::getVoidTy(context), false),
+        llvm::GlobalValue::ExternalLinkage, funcName, module);
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(context, "", func));
+    for (auto [priority, callee] : funcs)
+      builder.CreateCall(callee);
+    builder.CreateRetVoid();
+  };
+  lower("llvm.global_ctors", arcStaticCtors, llvm::orc::getConstructors(module),
+        /*highestFirst=*/false);
+  lower("llvm.global_dtors", arcStaticDtors, llvm::orc::getDestructors(module),
+        /*highestFirst=*/true);
+}
+
+/// Translate a module to LLVM IR, optimize it as a whole, split it into
+/// `codegenPartitions` modules, and generate native code for them in parallel.
+/// Optimizing before splitting keeps inlining across partition boundaries,
+/// while the code generation, which dominates for large models, scales with
+/// the number of threads.
+static LogicalResult compileToObjects(
+    ModuleOp module, TimingScope &ts,
+    SmallVectorImpl<std::unique_ptr<llvm::MemoryBuffer>> &objects) {
+  auto targetMachine = createHostTargetMachine();
+  if (!targetMachine)
+    return reportError("failed to create target machine",
+                       targetMachine.takeError());
+
+  llvm::LLVMContext llvmContext;
+  std::unique_ptr<llvm::Module> llvmModule;
+  {
+    auto timer = ts.nest("Translate to LLVM IR");
+    llvmModule = mlir::translateModuleToLLVMIR(module, llvmContext);
+    if (!llvmModule)
+      return failure();
+    mlir::ExecutionEngine::setupTargetTripleAndDataLayout(
+        llvmModule.get(), targetMachine->get());
+  }
+
+  {
+    auto timer = ts.nest("Optimize LLVM IR");
+    auto transformer = mlir::makeOptimizingTransformer(
+        /*optLevel=*/3, /*sizeLevel=*/0, targetMachine->get());
+    if (auto error = transformer(llvmModule.get()))
+      return reportError("failed to optimize LLVM IR", std::move(error));
+  }
+  if (outputFormat == OutputRunJIT)
+    lowerStaticInitializers(*llvmModule);
+
+  SmallVector<SmallString<0>> bitcodes;
+  {
+    auto timer = ts.nest("Split LLVM IR");
+    llvm::SplitModule(*llvmModule, std::max(1u, unsigned(codegenPartitions)),
+                      [&](std::unique_ptr<llvm::Module> part) {
+                        llvm::raw_svector_ostream os(bitcodes.emplace_back());
+                        llvm::WriteBitcodeToFile(*part, os);
+                      });
+  }
+
+  auto timer = ts.nest("Generate native code");
+  objects.resize(bitcodes.size());
+  std::atomic<unsigned> numCached = 0;
+  auto result = failableParallelForEachN(
+      module.getContext(), 0, bitcodes.size(), [&](size_t i) {
+        auto name = "part" + std::to_string(i) + ".o";
+        bool fromCache = false;
+        auto object = compileBitcode(bitcodes[i], name, fromCache);
+        if (!object) {
+          mlir::emitError(module.getLoc(), "native code generation failed: ")
+              << llvm::toString(object.takeError());
+          return failure();
+        }
+        objects[i] = std::move(*object);
+        if (fromCache)
+          ++numCached;
+        return success();
+      });
+  if (succeeded(result) && verbosePassExecutions && !objectCacheDir.empty())
+    llvm::errs() << "[arcilator] Loaded " << numCached.load() << " of "
+                 << objects.size() << " objects from the cache\n";
+  return result;
+}
+
+/// Load the given object files into a JIT and call the simulation entry point.
+/// Symbols not defined by the objects are resolved in the arcilator process,
+/// which provides the runtime environment, and in the shared libraries.
+static LogicalResult
+runObjects(SmallVectorImpl<std::unique_ptr<llvm::MemoryBuffer>> &objects) {
+  auto jit = llvm::orc::LLJITBuilder().create();
+  if (!jit)
+    return reportError("failed to create JIT", jit.takeError());
+
+  auto &mainDylib = (*jit)->getMainJITDylib();
+  char globalPrefix = (*jit)->getDataLayout().getGlobalPrefix();
+  auto processSymbols =
+      llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+          globalPrefix);
+  if (!processSymbols)
+    return reportError("failed to resolve process symbols",
+                       processSymbols.takeError());
+  mainDylib.addGenerator(std::move(*processSymbols));
+  for (auto &lib : sharedLibs) {
+    auto libSymbols = llvm::orc::DynamicLibrarySearchGenerator::Load(
+        lib.c_str(), globalPrefix);
+    if (!libSymbols)
+      return reportError("failed to load '" + lib + "'",
+                         libSymbols.takeError());
+    mainDylib.addGenerator(std::move(*libSymbols));
+  }
+
+  for (auto &object : objects)
+    if (auto error = (*jit)->addObjectFile(std::move(object)))
+      return reportError("failed to load object", std::move(error));
+
+  // Let the JIT platform initialize the loaded code, then run the static
+  // constructors collected by `lowerStaticInitializers`, which the platform
+  // does not know about.
+  if (auto error = (*jit)->initialize(mainDylib))
+    return reportError("failed to initialize JIT", std::move(error));
+  auto lookupFunc = [&](StringRef name) -> llvm::Expected<void (*)()> {
+    auto func = (*jit)->lookup(name);
+    if (!func)
+      return func.takeError();
+    return func->toPtr<void (*)()>();
+  };
+  auto ctors = lookupFunc(arcStaticCtors);
+  if (!ctors)
+    return reportError("failed to run static constructors", ctors.takeError());
+  auto dtors = lookupFunc(arcStaticDtors);
+  if (!dtors)
+    return reportError("failed to run static destructors", dtors.takeError());
+  auto entry = lookupFunc(jitEntryPoint);
+  if (!entry)
+    return reportError("failed to run simulation", entry.takeError());
+
+  (*ctors)();
+  (*entry)();
+  (*dtors)();
+  if (auto error = (*jit)->deinitialize(mainDylib))
+    return reportError("failed to deinitialize JIT", std::move(error));
+  return success();
+}
+
+/// Write the given object files to an output stream. Multiple objects are
+/// bundled in a static archive, which links like a single object file.
+static LogicalResult
+writeObjects(SmallVectorImpl<std::unique_ptr<llvm::MemoryBuffer>> &objects,
+             raw_ostream &os) {
+  if (objects.size() == 1) {
+    os << objects[0]->getBuffer();
+    return success();
+  }
+  std::vector<llvm::NewArchiveMember> members;
+  for (auto &object : objects)
+    members.emplace_back(object->getMemBufferRef());
+  auto archive = llvm::writeArchiveToBuffer(
+      members, llvm::SymtabWritingMode::NormalSymtab,
+      llvm::object::Archive::K_GNU, /*Deterministic=*/true, /*Thin=*/false);
+  if (!archive)
+    return reportError("failed to create archive", archive.takeError());
+  os << (*archive)->getBuffer();
+  return success();
+}
+#endif // ARCILATOR_ENABLE_JIT
+
 static LogicalResult processBuffer(
     MLIRContext &context, TimingScope &ts, llvm::SourceMgr &sourceMgr,
     std::optional<std::unique_ptr<llvm::ToolOutputFile>> &outputFile) {
@@ -378,7 +816,10 @@ static LogicalResult processBuffer(
   pmArc.enableTiming(ts);
   if (failed(applyPassManagerCLOptions(pmArc)))
     return failure();
-  populateHwModuleToArcPipeline(pmArc);
+  ArcProfile profile;
+  if (!profileData.empty() && failed(loadProfile(profileData, profile)))
+    return failure();
+  populateHwModuleToArcPipeline(pmArc, profile);
 
   if (failed(pmArc.run(module.get())))
     return failure();
@@ -452,6 +893,16 @@ static LogicalResult processBuffer(
     auto envDeinit =
         llvm::make_scope_exit([] { arc_jit_runtime_env_deinit(); });
 
+    // Partitioned or cached code generation produces object files that are
+    // loaded into the JIT directly.
+    if (codegenPartitions > 1 || !objectCacheDir.empty()) {
+      SmallVector<std::unique_ptr<llvm::MemoryBuffer>> objects;
+      if (failed(compileToObjects(module.get(), ts, objects)))
+        return failure();
+      auto runTimer = ts.nest("Run simulation");
+      return runObjects(objects);
+    }
+
     SmallVector<StringRef, 4> sharedLibraries(sharedLibs.begin(),
                                               sharedLibs.end());
 
@@ -514,6 +965,17 @@ static LogicalResult processBuffer(
     return success();
   }
 
+#ifdef ARCILATOR_ENABLE_JIT
+  // Handle object file output.
+  if (outputFormat == OutputObject) {
+    SmallVector<std::unique_ptr<llvm::MemoryBuffer>> objects;
+    if (failed(compileToObjects(module.get(), ts, objects)))
+      return failure();
+    auto outputTimer = ts.nest("Write object output");
+    return writeObjects(objects, outputFile.value()->os());
+  }
+#endif // ARCILATOR_ENABLE_JIT
+
   return success();
 }
 
@@ -657,7 +1119,7 @@ int main(int argc, char **argv) {
   llvm::cl::ParseCommandLineOptions(argc, argv,
                                     "MLIR-based circuit simulator\n");
 
-  if (outputFormat == OutputRunJIT) {
+  if (outputFormat == OutputRunJIT || outputFormat == OutputObject) {
 #ifdef ARCILATOR_ENABLE_JIT
     llvm::InitializeNativeTarget();
     llvm::InitializeNativeTargetAsmPrinter();
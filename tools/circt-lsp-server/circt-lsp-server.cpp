@@ -8,14 +8,40 @@
 
 #include "circt/InitAllDialects.h"
 #include "circt/Support/Version.h"
+#include "circt/Tools/circt-lsp-server/CirctLspServerMain.h"
 #include "mlir/IR/Dialect.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/InitAllDialects.h"
 #include "mlir/Tools/mlir-lsp-server/MlirLspServerMain.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
 #include "llvm/Support/PrettyStackTrace.h"
 
 using namespace mlir;
 
+/// Check whether the incremental server is requested with `--incremental` or
+/// `--incremental=<bool>`, removing the option from `args` if the upstream
+/// server, which does not know it, is to be used.
+static bool takeIncrementalOption(llvm::SmallVectorImpl<char *> &args) {
+  bool incremental = false;
+  bool found = false;
+  for (char *arg : llvm::drop_begin(args)) {
+    auto [name, value] = llvm::StringRef(arg).ltrim('-').split('=');
+    if (name != "incremental")
+      continue;
+    found = true;
+    // Accept the same values as boolean `cl::opt`s, leaving any other value
+    // for the incremental server to reject.
+    incremental = !(value == "0" || value.equals_insensitive("false"));
+  }
+  if (found && !incremental)
+    llvm::erase_if(args, [](char *arg) {
+      return llvm::StringRef(arg).ltrim('-').split('=').first == "incremental";
+    });
+  return incremental;
+}
+
 int main(int argc, char **argv) {
   DialectRegistry registry;
 
@@ -25,5 +51,11 @@ int main(int argc, char **argv) {
 
   registerAllDialects(registry);
   circt::registerAllDialects(registry);
-  return failed(MlirLspServerMain(argc, argv, registry));
+
+  // The incremental server only reparses the top-level operations of a document
+  // that changed, which keeps large designs responsive while editing.
+  llvm::SmallVector<char *> args(argv, argv + argc);
+  if (takeIncrementalOption(args))
+    return failed(circt::CirctLspServerMain(argc, argv, registry));
+  return failed(MlirLspServerMain(args.size(), args.data(), registry));
 }
@@ -241,6 +241,17 @@ struct CLOptions {
           "One or more library files, which are separate compilation units "
           "where modules are not automatically instantiated."),
       cl::value_desc("filename"), cl::Prefix, cl::cat(cat)};
+
+  //===--------------------------------------------------------------------===//
+  // Caching
+  //===--------------------------------------------------------------------===//
+
+  cl::opt<std::string> cacheDir{
+      "cache-dir",
+      cl::desc("Cache the MLIR conversion of module bodies in the given "
+               "directory and reuse it as long as their source files are "
+               "unchanged (parsing and elaboration still run in full)"),
+      cl::value_desc("dir"), cl::cat(cat)};
 };
 } // namespace
 
@@ -351,6 +362,8 @@ static LogicalResult executeWithSources(MLIRContext *context,
   options.singleUnit = opts.singleUnit;
   options.libraryFiles = opts.libraryFiles;
 
+  options.cacheDir = opts.cacheDir;
+
   // Open the output file.
   std::string errorMessage;
   auto outputFile = openOutputFile(opts.outputFilename, &errorMessage);
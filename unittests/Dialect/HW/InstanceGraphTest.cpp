@@ -12,6 +12,7 @@
 #include "mlir-c/BuiltinAttributes.h"
 #include "mlir/CAPI/IR.h"
 #include "mlir/CAPI/Support.h"
+#include "mlir/IR/PatternMatch.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "gtest/gtest.h"
 
@@ -41,6 +42,93 @@ TEST(InstanceGraphTest, PostOrderTraversal) {
   ASSERT_EQ(range.end(), it);
 }
 
+TEST(InstanceGraphTest, Listener) {
+  MLIRContext context;
+  ModuleOp circuit = fixtures::createModule(&context);
+  InstanceGraph graph(circuit);
+  igraph::InstanceGraphListener listener(graph);
+  IRRewriter rewriter(&context, &listener);
+  auto loc = circuit.getLoc();
+
+  auto top = cast<HWModuleOp>(*circuit.getBody()->begin());
+  auto cat = cast<HWModuleOp>(*circuit.getBody()->rbegin());
+  auto *topNode = graph.lookup(top);
+  auto *catNode = graph.lookup(cat);
+  ASSERT_EQ(2ull, catNode->getNumUses());
+
+  // New modules and instances are added to the graph.
+  rewriter.setInsertionPointToEnd(circuit.getBody());
+  auto dragon = rewriter.create<HWModuleOp>(
+      loc, StringAttr::get(&context, "Dragon"), ArrayRef<PortInfo>{});
+  rewriter.setInsertionPointToStart(dragon.getBodyBlock());
+  auto breakfast =
+      rewriter.create<InstanceOp>(loc, cat, "breakfast", ArrayRef<Value>{});
+  rewriter.setInsertionPointToStart(top.getBodyBlock());
+  auto dragonInst =
+      rewriter.create<InstanceOp>(loc, dragon, "dragon", ArrayRef<Value>{});
+
+  auto *dragonNode = graph.lookup(dragon);
+  ASSERT_EQ(5, std::distance(graph.begin(), graph.end()));
+  ASSERT_EQ(3ull, catNode->getNumUses());
+  ASSERT_EQ(1ull, dragonNode->getNumUses());
+  EXPECT_EQ(breakfast, (*catNode->usesBegin())->getInstance());
+  EXPECT_EQ(dragonNode, (*catNode->usesBegin())->getParent());
+  EXPECT_EQ(topNode, (*dragonNode->usesBegin())->getParent());
+
+  // Moved instances change their parent.
+  rewriter.moveOpBefore(breakfast, dragonInst);
+  ASSERT_EQ(3ull, catNode->getNumUses());
+  EXPECT_EQ(topNode, (*catNode->usesBegin())->getParent());
+  EXPECT_EQ(dragonNode->begin(), dragonNode->end());
+
+  // Erased instances and modules are removed from the graph.
+  rewriter.eraseOp(breakfast);
+  rewriter.eraseOp(dragonInst);
+  EXPECT_EQ(2ull, catNode->getNumUses());
+  EXPECT_TRUE(dragonNode->noUses());
+  rewriter.eraseOp(dragon);
+  EXPECT_EQ(4, std::distance(graph.begin(), graph.end()));
+}
+
+TEST(InstanceGraphTest, ListenerRenames) {
+  MLIRContext context;
+  ModuleOp circuit = fixtures::createModule(&context);
+  InstanceGraph graph(circuit);
+  igraph::InstanceGraphListener listener(graph);
+  IRRewriter rewriter(&context, &listener);
+
+  auto bear = cast<HWModuleOp>(*std::next(circuit.getBody()->begin(), 2));
+  auto cat = cast<HWModuleOp>(*circuit.getBody()->rbegin());
+  auto *bearNode = graph.lookup(bear);
+  auto *catNode = graph.lookup(cat);
+
+  // Renaming the instances before the module keeps the module's node.
+  auto kitten = FlatSymbolRefAttr::get(&context, "Kitten");
+  for (auto *use : llvm::make_early_inc_range(catNode->uses())) {
+    auto inst = cast<InstanceOp>(*use->getInstance());
+    rewriter.modifyOpInPlace(inst, [&] { inst.setModuleNameAttr(kitten); });
+  }
+  EXPECT_TRUE(catNode->noUses());
+  rewriter.modifyOpInPlace(cat, [&] { cat.setSymNameAttr(kitten.getAttr()); });
+  EXPECT_EQ(catNode, graph.lookup(kitten.getAttr()));
+  EXPECT_EQ(2ull, catNode->getNumUses());
+  EXPECT_EQ(4, std::distance(graph.begin(), graph.end()));
+
+  // A clone is added once it has a name of its own.
+  rewriter.setInsertionPointToEnd(circuit.getBody());
+  auto cub = cast<HWModuleOp>(rewriter.clone(*bear));
+  EXPECT_EQ(bearNode, graph.lookup(cub.getModuleNameAttr()));
+  EXPECT_EQ(2ull, catNode->getNumUses());
+  rewriter.modifyOpInPlace(
+      cub, [&] { cub.setSymNameAttr(StringAttr::get(&context, "Cub")); });
+  auto *cubNode = graph.lookup(cub);
+  EXPECT_NE(bearNode, cubNode);
+  EXPECT_EQ(bear.getOperation(), bearNode->getModule().getOperation());
+  EXPECT_EQ(3ull, catNode->getNumUses());
+  EXPECT_EQ(cubNode, (*catNode->usesBegin())->getParent());
+  EXPECT_EQ(5, std::distance(graph.begin(), graph.end()));
+}
+
 TEST(InstanceGraphCAPITest, PostOrderTraversal) {
   MLIRContext context;
 
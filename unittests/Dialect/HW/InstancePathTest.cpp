@@ -76,4 +76,64 @@ TEST(InstancePathTest, AppendPrependInstance) {
   EXPECT_EQ(kitty, appended[1]);
 }
 
+TEST(InstancePathTest, SharedStorage) {
+  MLIRContext context;
+  ModuleOp circuit = fixtures::createModule(&context);
+  hw::InstanceGraph graph(circuit);
+  igraph::InstancePathCache pathCache(graph);
+
+  auto top = cast<HWModuleOp>(*circuit.getBody()->begin());
+  auto alligator = cast<HWModuleOp>(*std::next(circuit.getBody()->begin()));
+  auto bear = cast<HWModuleOp>(*std::next(circuit.getBody()->begin(), 2));
+  auto cat = cast<HWModuleOp>(*circuit.getBody()->rbegin());
+
+  auto builder =
+      ImplicitLocOpBuilder::atBlockBegin(circuit.getLoc(), top.getBodyBlock());
+  auto kitty = builder.create<InstanceOp>(cat, "kitty", ArrayRef<Value>{});
+  auto tabby = builder.create<InstanceOp>(cat, "tabby", ArrayRef<Value>{});
+
+  // The paths to a module that instantiates others leave room to grow, and the
+  // paths to its children reuse that storage. The paths to leaf modules are
+  // allocated tightly.
+  auto alligatorPaths = pathCache.getAbsolutePaths(alligator);
+  auto bearPaths = pathCache.getAbsolutePaths(bear);
+  auto catPaths = pathCache.getAbsolutePaths(cat);
+  ASSERT_EQ(1ull, alligatorPaths.size());
+  ASSERT_EQ(1ull, bearPaths.size());
+  ASSERT_EQ(2ull, catPaths.size());
+  EXPECT_EQ(alligatorPaths[0].begin(), bearPaths[0].begin());
+  EXPECT_NE(bearPaths[0].begin(), catPaths[0].begin());
+
+  // Further extensions of the same path get their own storage and leave the
+  // paths sharing the old one untouched.
+  auto other = pathCache.appendInstance(alligatorPaths[0], kitty);
+  EXPECT_NE(bearPaths[0].begin(), other.begin());
+  ASSERT_EQ(2ull, bearPaths[0].size());
+  EXPECT_EQ("bear", bearPaths[0][1].getInstanceName());
+  ASSERT_EQ(2ull, other.size());
+  EXPECT_EQ(kitty, other[1]);
+
+  // Paths extended through the public API are allocated tightly, so extending
+  // them again copies them.
+  auto tight = pathCache.appendInstance(other, tabby);
+  auto tighter = pathCache.appendInstance(tight, kitty);
+  EXPECT_NE(other.begin(), tight.begin());
+  EXPECT_NE(tight.begin(), tighter.begin());
+  ASSERT_EQ(4ull, tighter.size());
+  EXPECT_EQ(kitty, tighter[1]);
+  EXPECT_EQ(tabby, tighter[2]);
+  EXPECT_EQ(kitty, tighter[3]);
+
+  // Prepending leaves the paths sharing the old storage untouched, too.
+  igraph::InstancePath empty;
+  auto front = pathCache.prependInstance(kitty, empty);
+  auto front2 = pathCache.prependInstance(tabby, front);
+  auto frontOther = pathCache.prependInstance(kitty, front);
+  ASSERT_EQ(2ull, front2.size());
+  EXPECT_EQ(tabby, front2[0]);
+  EXPECT_EQ(kitty, front2[1]);
+  EXPECT_EQ(kitty, frontOther[0]);
+  EXPECT_EQ(kitty, frontOther[1]);
+}
+
 } // namespace